@@ -0,0 +1,296 @@
+/*----------------------------------------------------------------
+* File:     bench.c
+*----------------------------------------------------------------*/
+/* Benchmark of the factorizations and solvers over a range of sizes,
+   thread counts and variants. Every run factors a fresh copy of the
+   same matrix; the copy is not timed. After the warmup runs, the
+   repeats are timed one by one with CLOCK_MONOTONIC and summarized by
+   the minimum, median and 99th percentile. GFLOP/s is computed from
+   the median, with 2n^3/3 flops per factorization (plus 2n^2 for the
+   solve); the bytes moved are the n x n matrix read and written once,
+   a lower bound on the memory traffic.
+
+   Usage: gauss_bench [-n sizes] [-t threads] [-v variants] [-r repeats]
+   [-w warmup] [-c file.csv] [-j file.json], where sizes, threads and
+   variants are comma-separated lists. */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "gauss_solve.h"
+#include "gauss_tiled.h"
+#include "gauss_kernels.h"
+#include "gauss_mixed.h"
+#include "gauss_recursive.h"
+
+#define MAX_LIST 64
+
+typedef struct {
+  int n, nthreads;
+  double *A;			/* n x n, overwritten */
+  int *P;
+  double *b, *x;
+} bench_args;
+
+typedef struct {
+  const char *name;
+  int solve;			/* Includes the triangular solves */
+  void (*run)(const bench_args *a, const double *A0);
+} bench_variant;
+
+static void run_lu_in_place(const bench_args *a, const double *A0)
+{
+  (void)A0;
+  lu_in_place(a->n, (double (*)[a->n])a->A);
+}
+
+static void run_lu_blocked(const bench_args *a, const double *A0)
+{
+  (void)A0;
+  lu_blocked_in_place(a->n, (double (*)[a->n])a->A, 0);
+}
+
+static void run_plu(const bench_args *a, const double *A0)
+{
+  (void)A0;
+  plu(a->n, (double (*)[a->n])a->A, a->P);
+}
+
+static void run_plu_blocked(const bench_args *a, const double *A0)
+{
+  (void)A0;
+  plu_blocked(a->n, (double (*)[a->n])a->A, a->P, 0);
+}
+
+static void run_plu_recursive(const bench_args *a, const double *A0)
+{
+  (void)A0;
+  plu_recursive(a->n, (double (*)[a->n])a->A, a->P);
+}
+
+static void run_plu_tiled(const bench_args *a, const double *A0)
+{
+  (void)A0;
+  plu_tiled(a->n, (double (*)[a->n])a->A, a->P, 0, a->nthreads);
+}
+
+static void run_gauss_solve(const bench_args *a, const double *A0)
+{
+  (void)A0;
+  gauss_solve_in_place(a->n, (double (*)[a->n])a->A, a->b);
+}
+
+static void run_mixed(const bench_args *a, const double *A0)
+{
+  gauss_solve_mixed(a->n, (const double (*)[a->n])A0, a->b, a->x, 0, NULL);
+}
+
+static const bench_variant variants[] = {
+  { "lu_in_place",          0, run_lu_in_place },
+  { "lu_blocked_in_place",  0, run_lu_blocked },
+  { "plu",                  0, run_plu },
+  { "plu_blocked",          0, run_plu_blocked },
+  { "plu_recursive",        0, run_plu_recursive },
+  { "plu_tiled",            0, run_plu_tiled },
+  { "gauss_solve_in_place", 1, run_gauss_solve },
+  { "gauss_solve_mixed",    1, run_mixed },
+};
+#define NVARIANTS ((int)(sizeof(variants) / sizeof(variants[0])))
+
+static double now(void)
+{
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + 1e-9 * t.tv_nsec;
+}
+
+static int compare_doubles(const void *p, const void *q)
+{
+  const double a = *(const double *)p, b = *(const double *)q;
+  return (a > b) - (a < b);
+}
+
+/* Parse a comma-separated list of positive integers; return the count,
+   or -1 if malformed. */
+static int parse_ints(const char *s, int out[MAX_LIST])
+{
+  int k = 0;
+  while(*s && k < MAX_LIST) {
+    char *end;
+    const long v = strtol(s, &end, 10);
+    if(end == s || v <= 0 || (*end && *end != ',')) {
+      return -1;
+    }
+    out[k++] = v;
+    s = *end ? end + 1 : end;
+  }
+  return k;
+}
+
+/* Select variants by name; return the count, or -1 on an unknown one. */
+static int parse_variants(const char *s, int out[MAX_LIST])
+{
+  int k = 0;
+  char *copy = strdup(s);
+  for(char *tok = strtok(copy, ","); tok && k < MAX_LIST;
+      tok = strtok(NULL, ",")) {
+    int v = 0;
+    while(v < NVARIANTS && strcmp(tok, variants[v].name) != 0) {
+      ++v;
+    }
+    if(v == NVARIANTS) {
+      fprintf(stderr, "gauss_bench: unknown variant %s\n", tok);
+      free(copy);
+      return -1;
+    }
+    out[k++] = v;
+  }
+  free(copy);
+  return k;
+}
+
+/* A well-conditioned matrix that LU without pivoting handles too, so
+   that all variants factor the same matrix. */
+static void fill_matrix(int n, double A[n][n], double b[n])
+{
+  unsigned long long s = 0x9e3779b97f4a7c15ull;
+  for(int i = 0; i < n; ++i) {
+    for(int j = 0; j < n; ++j) {
+      s = s * 6364136223846793005ull + 1442695040888963407ull;
+      A[i][j] = (double)(s >> 11) / 9007199254740992.0 - 0.5;
+    }
+    A[i][i] += n;
+    b[i] = 1;
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  int sizes[MAX_LIST] = { 64, 128, 256, 512, 1024 }, nsizes = 5;
+  int threads[MAX_LIST] = { 1 }, nthreads = 1;
+  int sel[MAX_LIST], nsel = NVARIANTS;
+  int repeats = 10, warmup = 2;
+  const char *csv_path = NULL, *json_path = NULL;
+  for(int v = 0; v < NVARIANTS; ++v) {
+    sel[v] = v;
+  }
+
+  int opt;
+  while((opt = getopt(argc, argv, "n:t:v:r:w:c:j:")) != -1) {
+    int ok = 1;
+    switch(opt) {
+    case 'n': ok = (nsizes = parse_ints(optarg, sizes)) > 0; break;
+    case 't': ok = (nthreads = parse_ints(optarg, threads)) > 0; break;
+    case 'v': ok = (nsel = parse_variants(optarg, sel)) > 0; break;
+    case 'r': ok = (repeats = atoi(optarg)) > 0; break;
+    case 'w': ok = (warmup = atoi(optarg)) >= 0; break;
+    case 'c': csv_path = optarg; break;
+    case 'j': json_path = optarg; break;
+    default: ok = 0;
+    }
+    if(!ok) {
+      fprintf(stderr, "Usage: %s [-n sizes] [-t threads] [-v variants] "
+	      "[-r repeats] [-w warmup] [-c file.csv] [-j file.json]\n",
+	      argv[0]);
+      return 2;
+    }
+  }
+
+  FILE *csv = csv_path ? fopen(csv_path, "w") : NULL;
+  FILE *json = json_path ? fopen(json_path, "w") : NULL;
+  if((csv_path && !csv) || (json_path && !json)) {
+    perror("gauss_bench");
+    return 1;
+  }
+  if(csv) {
+    fprintf(csv, "variant,n,threads,repeats,min_s,median_s,p99_s,gflops,"
+	    "bytes\n");
+  }
+  if(json) {
+    fprintf(json, "{\n  \"compiler\": \"%s\",\n  \"isa\": \"%s\",\n"
+	    "  \"repeats\": %d,\n  \"warmup\": %d,\n  \"results\": [",
+	    __VERSION__, gauss_kernel_isa(), repeats, warmup);
+  }
+  printf("%-22s %6s %3s %12s %12s %12s %9s\n", "variant", "n", "thr",
+	 "min [s]", "median [s]", "p99 [s]", "GFLOP/s");
+
+  double *t = malloc(repeats * sizeof(double));
+  int first = 1;
+  for(int is = 0; is < nsizes; ++is) {
+    const int n = sizes[is];
+    double *A0 = malloc((size_t)n * n * sizeof(double));
+    bench_args a = { n, 1, malloc((size_t)n * n * sizeof(double)),
+		     malloc(n * sizeof(int)), malloc(n * sizeof(double)),
+		     malloc(n * sizeof(double)) };
+    double *b0 = malloc(n * sizeof(double));
+    if(!t || !A0 || !a.A || !a.P || !a.b || !a.x || !b0) {
+      fprintf(stderr, "gauss_bench: out of memory at n = %d\n", n);
+      return 1;
+    }
+    fill_matrix(n, (double (*)[n])A0, b0);
+
+    for(int it = 0; it < nthreads; ++it) {
+      a.nthreads = threads[it];
+      gauss_set_num_threads(threads[it]);
+      for(int iv = 0; iv < nsel; ++iv) {
+	const bench_variant *v = &variants[sel[iv]];
+	for(int r = -warmup; r < repeats; ++r) {
+	  memcpy(a.A, A0, (size_t)n * n * sizeof(double));
+	  memcpy(a.b, b0, n * sizeof(double));
+	  const double t0 = now();
+	  v->run(&a, A0);
+	  const double t1 = now();
+	  if(r >= 0) {
+	    t[r] = t1 - t0;
+	  }
+	}
+	qsort(t, repeats, sizeof(double), compare_doubles);
+	const double median = repeats % 2 ? t[repeats / 2]
+	  : 0.5 * (t[repeats / 2 - 1] + t[repeats / 2]);
+	const int i99 = (99 * repeats + 99) / 100 - 1;
+	const double p99 = t[i99];
+	const double flops = 2.0 * n * n * n / 3
+	  + (v->solve ? 2.0 * n * n : 0);
+	const double gflops = flops / median * 1e-9;
+	const double bytes = 2.0 * sizeof(double) * n * n;
+
+	printf("%-22s %6d %3d %12.6f %12.6f %12.6f %9.3f\n", v->name, n,
+	       threads[it], t[0], median, p99, gflops);
+	if(csv) {
+	  fprintf(csv, "%s,%d,%d,%d,%.9g,%.9g,%.9g,%.6g,%.0f\n", v->name, n,
+		  threads[it], repeats, t[0], median, p99, gflops, bytes);
+	}
+	if(json) {
+	  fprintf(json, "%s\n    {\"variant\": \"%s\", \"n\": %d, "
+		  "\"threads\": %d, \"min_s\": %.9g, \"median_s\": %.9g, "
+		  "\"p99_s\": %.9g, \"gflops\": %.6g, \"bytes\": %.0f}",
+		  first ? "" : ",", v->name, n, threads[it], t[0], median, p99,
+		  gflops, bytes);
+	  first = 0;
+	}
+      }
+    }
+    free(A0);
+    free(a.A);
+    free(a.P);
+    free(a.b);
+    free(a.x);
+    free(b0);
+  }
+  gauss_set_num_threads(0);
+  free(t);
+
+  if(csv) {
+    fclose(csv);
+  }
+  if(json) {
+    fprintf(json, "\n  ]\n}\n");
+    fclose(json);
+  }
+  return 0;
+}
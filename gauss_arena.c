@@ -0,0 +1,205 @@
+/*----------------------------------------------------------------
+* File:     gauss_arena.c
+*----------------------------------------------------------------*/
+/* Pool of aligned matrix buffers. Buffer capacities are powers of two,
+   so a released buffer serves any later request in its size class;
+   each class keeps a free list. A header of one alignment unit in
+   front of the data records the class and links the free list. */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "gauss_solve.h"
+#include "gauss_arena.h"
+
+#define ARENA_MIN_CLASS 12		/* 4 KiB */
+#define ARENA_NCLASSES  48
+#define ARENA_DEFAULT_CACHED ((size_t)256 << 20)
+
+typedef union arena_header {
+  struct {
+    union arena_header *next;	/* Free list */
+    int cls;
+  } h;
+  char pad[ARENA_ALIGN];
+} arena_header;
+
+struct gauss_arena {
+  pthread_mutex_t lock;
+  size_t max_cached, cached;
+  arena_header *free_list[ARENA_NCLASSES];
+};
+
+int gauss_padded_lda(int n)
+{
+  const int line = ARENA_ALIGN / sizeof(double);
+  int lda = (n + line - 1) / line * line;
+  if(lda % (512 / sizeof(double)) == 0) {
+    lda += line;
+  }
+  return lda > 0 ? lda : line;
+}
+
+gauss_arena *gauss_arena_create(size_t max_cached)
+{
+  gauss_arena *a = calloc(1, sizeof(*a));
+  if(!a) {
+    return NULL;
+  }
+  a->max_cached = max_cached ? max_cached : ARENA_DEFAULT_CACHED;
+  pthread_mutex_init(&a->lock, NULL);
+  return a;
+}
+
+void gauss_arena_trim(gauss_arena *a)
+{
+  pthread_mutex_lock(&a->lock);
+  for(int c = 0; c < ARENA_NCLASSES; ++c) {
+    arena_header *b = a->free_list[c];
+    while(b) {
+      arena_header *next = b->h.next;
+      free(b);
+      b = next;
+    }
+    a->free_list[c] = NULL;
+  }
+  a->cached = 0;
+  pthread_mutex_unlock(&a->lock);
+}
+
+void gauss_arena_destroy(gauss_arena *a)
+{
+  if(!a) {
+    return;
+  }
+  gauss_arena_trim(a);
+  pthread_mutex_destroy(&a->lock);
+  free(a);
+}
+
+static gauss_arena *default_arena;
+static pthread_once_t default_once = PTHREAD_ONCE_INIT;
+
+static void default_init(void)
+{
+  default_arena = gauss_arena_create(0);
+}
+
+static gauss_arena *arena_or_default(gauss_arena *a)
+{
+  if(a) {
+    return a;
+  }
+  pthread_once(&default_once, default_init);
+  return default_arena;
+}
+
+static size_t class_bytes(int c)
+{
+  return (size_t)1 << (c + ARENA_MIN_CLASS);
+}
+
+/* A buffer of at least bytes from the free list of its class, or a
+   fresh one (*fresh = 1); NULL if memory is exhausted. */
+static double *arena_get(gauss_arena *a, size_t bytes, int *fresh)
+{
+  int c = 0;
+  while(c < ARENA_NCLASSES && class_bytes(c) < bytes) {
+    ++c;
+  }
+  if(c == ARENA_NCLASSES) {
+    return NULL;
+  }
+
+  pthread_mutex_lock(&a->lock);
+  arena_header *b = a->free_list[c];
+  if(b) {
+    a->free_list[c] = b->h.next;
+    a->cached -= class_bytes(c);
+  }
+  pthread_mutex_unlock(&a->lock);
+
+  *fresh = !b;
+  if(*fresh) {
+    void *p;
+    if(posix_memalign(&p, ARENA_ALIGN, sizeof(arena_header) + class_bytes(c))) {
+      return NULL;
+    }
+    b = p;
+    b->h.cls = c;
+  }
+  return (double *)(b + 1);
+}
+
+double *gauss_arena_alloc(gauss_arena *a, int m, int n, int *lda)
+{
+  a = arena_or_default(a);
+  if(!a || m < 0 || n < 0) {
+    return NULL;
+  }
+  const int ld = gauss_padded_lda(n);
+  int fresh;
+  double *data = arena_get(a, (size_t)m * ld * sizeof(double), &fresh);
+  if(!data) {
+    return NULL;
+  }
+  *lda = ld;
+
+  /* First touch, one row per iteration, with the static schedule the
+     threaded kernels use for their row loops. */
+  const int nt = gauss_get_num_threads();
+  if(fresh && nt > 1) {
+#pragma omp parallel for schedule(static) num_threads(nt) \
+  if((size_t)m * ld > PARALLEL_MIN_WORK)
+    for(int i = 0; i < m; ++i) {
+      memset(data + (size_t)i * ld, 0, ld * sizeof(double));
+    }
+  }
+  return data;
+}
+
+double *gauss_arena_scratch(size_t count)
+{
+  gauss_arena *a = arena_or_default(NULL);
+  int fresh;
+  if(!a || count > SIZE_MAX / sizeof(double)) {
+    return NULL;
+  }
+  return arena_get(a, count * sizeof(double), &fresh);
+}
+
+size_t gauss_arena_cached(gauss_arena *a)
+{
+  a = arena_or_default(a);
+  if(!a) {
+    return 0;
+  }
+  pthread_mutex_lock(&a->lock);
+  const size_t bytes = a->cached;
+  pthread_mutex_unlock(&a->lock);
+  return bytes;
+}
+
+void gauss_arena_release(gauss_arena *a, double *p)
+{
+  if(!p) {
+    return;
+  }
+  a = arena_or_default(a);
+  arena_header *b = (arena_header *)p - 1;
+  const size_t bytes = class_bytes(b->h.cls);
+
+  pthread_mutex_lock(&a->lock);
+  if(a->cached + bytes <= a->max_cached) {
+    b->h.next = a->free_list[b->h.cls];
+    a->free_list[b->h.cls] = b;
+    a->cached += bytes;
+    b = NULL;
+  }
+  pthread_mutex_unlock(&a->lock);
+  free(b);
+}
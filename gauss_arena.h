@@ -0,0 +1,56 @@
+/*----------------------------------------------------------------
+* File:     gauss_arena.h
+*----------------------------------------------------------------*/
+
+#ifndef GAUSS_ARENA_H
+#define GAUSS_ARENA_H
+
+#include <stddef.h>
+
+/* Alignment of every matrix handed out, bytes: one cache line, one
+   AVX-512 register. */
+#define ARENA_ALIGN 64
+
+/* A pool of aligned matrix buffers. Released buffers are kept, up to
+   a cap on the bytes held, and handed out again to later requests of
+   a similar size. All functions are thread-safe. */
+typedef struct gauss_arena gauss_arena;
+
+/* max_cached bytes of released buffers are kept for reuse (0 for the
+   default of 256 MiB). */
+gauss_arena *gauss_arena_create(size_t max_cached);
+void         gauss_arena_destroy(gauss_arena *arena);
+
+/* Leading dimension for a matrix with n columns: n rounded up to a
+   whole number of cache lines, plus one cache line when the row stride
+   would be a multiple of 512 bytes, so that the rows of a matrix with
+   n a power of two do not all map to the same cache sets. */
+int gauss_padded_lda(int n);
+
+/* Storage for an m x n matrix with leading dimension *lda =
+   gauss_padded_lda(n): element (i,j) is p[i * *lda + j], and every
+   row starts on an ARENA_ALIGN boundary. The contents are unspecified.
+   When gauss_get_num_threads() > 1, a fresh (not reused) buffer is
+   first touched row by row by that many threads, split as the threaded
+   kernels split rows, so that on a NUMA machine its pages land near
+   the threads that will use them. arena may be NULL for a process-wide
+   arena. Returns NULL if memory is exhausted. */
+double *gauss_arena_alloc(gauss_arena *arena, int m, int n, int *lda);
+
+/* Storage for count contiguous doubles, aligned to ARENA_ALIGN, from
+   the process-wide arena: the per-call scratch of the solvers, for
+   example an n x n copy of A with count = n * n. Release it with
+   gauss_arena_release(NULL, p). Returns NULL if memory is exhausted. */
+double *gauss_arena_scratch(size_t count);
+
+/* Return p, obtained from gauss_arena_alloc or gauss_arena_scratch on
+   the same arena, to the pool. p may be NULL. */
+void gauss_arena_release(gauss_arena *arena, double *p);
+
+/* Bytes held in released buffers, kept for reuse. */
+size_t gauss_arena_cached(gauss_arena *arena);
+
+/* Free all cached buffers. */
+void gauss_arena_trim(gauss_arena *arena);
+
+#endif
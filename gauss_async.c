@@ -0,0 +1,262 @@
+/*----------------------------------------------------------------
+* File:     gauss_async.c
+*----------------------------------------------------------------*/
+/* One lock protects the queue and the state of every ticket. A ticket
+   is referenced by the caller and by the queue, and is freed when both
+   have let go of it: the caller in gauss_ticket_release, the queue
+   once the request has completed. */
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "gauss_solve.h"
+#include "gauss_batched.h"
+#include "gauss_tiled.h"
+#include "gauss_async.h"
+
+struct gauss_ticket {
+  gauss_queue *Q;
+  int n;
+  double *A, *b;
+  int *P, *own_P;		/* own_P if the caller passed no P */
+  gauss_callback cb;
+  void *arg;
+  int done, status, refs;
+  gauss_ticket *next;
+};
+
+struct gauss_queue {
+  pthread_mutex_t lock;
+  pthread_cond_t work;		/* A request was queued, or stop */
+  pthread_cond_t done;		/* A request completed */
+  gauss_ticket *head, *tail;
+  int stop, nworkers;
+  pthread_t *threads;
+};
+
+static void put_ticket(gauss_ticket *t)
+{
+  if(--t->refs == 0) {
+    free(t->own_P);
+    free(t);
+  }
+}
+
+static int solve_one(const gauss_queue *Q, gauss_ticket *t)
+{
+  const int n = t->n;
+  double (*A)[n] = (double (*)[n])t->A;
+  int status;
+  if(n >= ASYNC_LARGE_N) {
+    status = plu_tiled(n, A, t->P, 0, Q->nworkers);
+  } else {
+    status = plu(n, A, t->P);
+  }
+  if(status == 0) {
+    plu_solve(n, (const double (*)[n])A, t->P, 1, (double (*)[1])t->b);
+  }
+  return status;
+}
+
+/* The requests of the group, all of size n, packed into one batch;
+   one at a time if the batch cannot be allocated. */
+static void solve_group(const gauss_queue *Q, int count, gauss_ticket *t[])
+{
+  const int n = t[0]->n;
+  const size_t nn = (size_t)n * n;
+  double *A = malloc((count * nn + 1) * sizeof(double));
+  int *P = malloc((count * (size_t)n + 1) * sizeof(int));
+  if(!A || !P) {
+    free(A);
+    free(P);
+    for(int s = 0; s < count; ++s) {
+      t[s]->status = solve_one(Q, t[s]);
+    }
+    return;
+  }
+  for(int s = 0; s < count; ++s) {
+    memcpy(A + s * nn, t[s]->A, nn * sizeof(double));
+  }
+  int info[ASYNC_MAX_BATCH];
+  plu_batched(count, n, (double (*)[n][n])A, (int (*)[n])P, info);
+  for(int s = 0; s < count; ++s) {
+    double (*LU)[n] = (double (*)[n])t[s]->A;
+    memcpy(LU, A + s * nn, nn * sizeof(double));
+    memcpy(t[s]->P, P + (size_t)s * n, n * sizeof(int));
+    t[s]->status = info[s];
+    if(t[s]->status == 0) {
+      plu_solve(n, (const double (*)[n])LU, t[s]->P, 1,
+		(double (*)[1])t[s]->b);
+    }
+  }
+  free(A);
+  free(P);
+}
+
+static void *worker_main(void *arg)
+{
+  gauss_queue *Q = arg;
+  gauss_ticket *group[ASYNC_MAX_BATCH];
+  pthread_mutex_lock(&Q->lock);
+  for(;;) {
+    while(!Q->head && !Q->stop) {
+      pthread_cond_wait(&Q->work, &Q->lock);
+    }
+    if(!Q->head) {
+      break;
+    }
+    int count = 1;
+    group[0] = Q->head;
+    Q->head = Q->head->next;
+    if(!Q->head) {
+      Q->tail = NULL;
+    } else if(group[0]->n <= ASYNC_SMALL_N) {
+      /* Take every other queued request of the same size along. */
+      gauss_ticket **link = &Q->head, *last = NULL;
+      while(*link && count < ASYNC_MAX_BATCH) {
+	if((*link)->n == group[0]->n) {
+	  group[count++] = *link;
+	  *link = (*link)->next;
+	} else {
+	  last = *link;
+	  link = &(*link)->next;
+	}
+      }
+      if(!*link) {
+	Q->tail = last;
+      }
+    }
+    pthread_mutex_unlock(&Q->lock);
+
+    if(count > 1) {
+      solve_group(Q, count, group);
+    } else {
+      group[0]->status = solve_one(Q, group[0]);
+    }
+    for(int s = 0; s < count; ++s) {
+      if(group[s]->cb) {
+	group[s]->cb(group[s]->status, group[s]->arg);
+      }
+    }
+
+    pthread_mutex_lock(&Q->lock);
+    for(int s = 0; s < count; ++s) {
+      group[s]->done = 1;
+      put_ticket(group[s]);
+    }
+    pthread_cond_broadcast(&Q->done);
+  }
+  pthread_mutex_unlock(&Q->lock);
+  return NULL;
+}
+
+gauss_queue *gauss_queue_create(int nworkers)
+{
+  if(nworkers <= 0) {
+    nworkers = gauss_get_num_threads();
+  }
+  gauss_queue *Q = calloc(1, sizeof(*Q));
+  if(!Q || !(Q->threads = malloc(nworkers * sizeof(pthread_t)))) {
+    free(Q);
+    return NULL;
+  }
+  pthread_mutex_init(&Q->lock, NULL);
+  pthread_cond_init(&Q->work, NULL);
+  pthread_cond_init(&Q->done, NULL);
+  while(Q->nworkers < nworkers
+	&& pthread_create(&Q->threads[Q->nworkers], NULL, worker_main, Q) == 0) {
+    ++Q->nworkers;
+  }
+  if(Q->nworkers == 0) {
+    gauss_queue_destroy(Q);
+    return NULL;
+  }
+  return Q;
+}
+
+void gauss_queue_destroy(gauss_queue *Q)
+{
+  if(!Q) {
+    return;
+  }
+  pthread_mutex_lock(&Q->lock);
+  Q->stop = 1;
+  pthread_cond_broadcast(&Q->work);
+  pthread_mutex_unlock(&Q->lock);
+  for(int w = 0; w < Q->nworkers; ++w) {
+    pthread_join(Q->threads[w], NULL);
+  }
+  pthread_cond_destroy(&Q->done);
+  pthread_cond_destroy(&Q->work);
+  pthread_mutex_destroy(&Q->lock);
+  free(Q->threads);
+  free(Q);
+}
+
+gauss_ticket *gauss_solve_async(gauss_queue *Q, int n, double A[n][n],
+				int P[], double b[], gauss_callback cb,
+				void *arg)
+{
+  gauss_ticket *t = calloc(1, sizeof(*t));
+  if(!t) {
+    return NULL;
+  }
+  if(!P && !(P = t->own_P = malloc((n + 1) * sizeof(int)))) {
+    free(t);
+    return NULL;
+  }
+  t->Q = Q;
+  t->n = n;
+  t->A = &A[0][0];
+  t->P = P;
+  t->b = b;
+  t->cb = cb;
+  t->arg = arg;
+  t->refs = 2;
+
+  pthread_mutex_lock(&Q->lock);
+  if(Q->tail) {
+    Q->tail->next = t;
+  } else {
+    Q->head = t;
+  }
+  Q->tail = t;
+  pthread_cond_signal(&Q->work);
+  pthread_mutex_unlock(&Q->lock);
+  return t;
+}
+
+int gauss_ticket_wait(gauss_ticket *t)
+{
+  gauss_queue *Q = t->Q;
+  pthread_mutex_lock(&Q->lock);
+  while(!t->done) {
+    pthread_cond_wait(&Q->done, &Q->lock);
+  }
+  const int status = t->status;
+  pthread_mutex_unlock(&Q->lock);
+  return status;
+}
+
+int gauss_ticket_test(gauss_ticket *t, int *status)
+{
+  gauss_queue *Q = t->Q;
+  pthread_mutex_lock(&Q->lock);
+  const int done = t->done;
+  if(done) {
+    *status = t->status;
+  }
+  pthread_mutex_unlock(&Q->lock);
+  return done;
+}
+
+void gauss_ticket_release(gauss_ticket *t)
+{
+  if(t) {
+    gauss_queue *Q = t->Q;
+    pthread_mutex_lock(&Q->lock);
+    put_ticket(t);
+    pthread_mutex_unlock(&Q->lock);
+  }
+}
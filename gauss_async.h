@@ -0,0 +1,55 @@
+/*----------------------------------------------------------------
+* File:     gauss_async.h
+*----------------------------------------------------------------*/
+
+#ifndef GAUSS_ASYNC_H
+#define GAUSS_ASYNC_H
+
+/* Non-blocking solves. Requests are queued to a pool of persistent
+   worker threads and complete in the background; the caller gets a
+   ticket to wait on, a callback, or both. Requests are routed by size:
+   - n <= ASYNC_SMALL_N: every queued request of the same size is taken
+     together, up to ASYNC_MAX_BATCH, and factored with plu_batched, so
+     small requests are coalesced whenever they arrive faster than the
+     workers drain them (an idle queue adds no delay);
+   - n >= ASYNC_LARGE_N: plu_tiled, with as many threads as workers;
+   - otherwise plu, on the worker that took the request. */
+
+#define ASYNC_SMALL_N   32
+#define ASYNC_LARGE_N   512
+#define ASYNC_MAX_BATCH 256
+
+typedef struct gauss_queue  gauss_queue;
+typedef struct gauss_ticket gauss_ticket;
+
+/* Called on the worker thread when a request completes, before
+   gauss_ticket_wait returns; status as for gauss_ticket_wait. */
+typedef void (*gauss_callback)(int status, void *arg);
+
+/* Start nworkers threads (nworkers <= 0 means gauss_get_num_threads()).
+   Returns NULL if out of memory or if no thread could be started. */
+gauss_queue *gauss_queue_create(int nworkers);
+/* Complete every request submitted so far, then stop the workers.
+   Every ticket must have been released before. */
+void         gauss_queue_destroy(gauss_queue *Q);
+
+/* Queue the solve of A x = b with partial pivoting. When it completes,
+   A holds the packed L\U of plu, P (if not NULL) the permutation, and
+   b the solution; until then the caller must not touch them. cb may
+   be NULL. Returns the ticket, or NULL if out of memory (nothing is
+   queued then). */
+gauss_ticket *gauss_solve_async(gauss_queue *Q, int n, double A[n][n],
+				int P[], double b[], gauss_callback cb,
+				void *arg);
+
+/* Block until the request completes. Returns its status: 0, or k+1
+   if U[k][k] is exactly zero (b is then left unchanged). */
+int  gauss_ticket_wait(gauss_ticket *t);
+/* Non-blocking: 1 if the request has completed, with *status set, or
+   0. */
+int  gauss_ticket_test(gauss_ticket *t, int *status);
+/* Give up the ticket; the request itself still completes. It may be
+   called right after submission when only the callback is wanted. */
+void gauss_ticket_release(gauss_ticket *t);
+
+#endif
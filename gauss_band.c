@@ -0,0 +1,127 @@
+/*----------------------------------------------------------------
+* File:     gauss_band.c
+*----------------------------------------------------------------*/
+/* Banded matrices. Band storage is row-major, so the part of a row
+   touched by one elimination step is contiguous and the updates go
+   through the vector kernels. */
+
+#include <math.h>
+#include <string.h>
+
+#include "gauss_solve.h"
+#include "gauss_kernels.h"
+#include "gauss_band.h"
+
+void band_detect(int n, const double A[n][n], int *kl, int *ku)
+{
+  int l = 0, u = 0;
+  for(int i = 0; i < n; ++i) {
+    for(int j = 0; j < i - l; ++j) {
+      if(A[i][j] != 0) {
+	l = i - j;
+	break;
+      }
+    }
+    for(int j = n-1; j > i + u; --j) {
+      if(A[i][j] != 0) {
+	u = j - i;
+	break;
+      }
+    }
+  }
+  *kl = l;
+  *ku = u;
+}
+
+void dense_to_band(int n, const double A[n][n], int kl, int ku,
+		   double AB[n][BAND_WIDTH(kl, ku)])
+{
+  for(int i = 0; i < n; ++i) {
+    memset(AB[i], 0, sizeof(AB[i]));
+    const int j0 = i - kl > 0 ? i - kl : 0;
+    const int j1 = i + ku < n ? i + ku + 1 : n;
+    memcpy(&AB[i][j0 - i + kl], &A[i][j0], (j1 - j0) * sizeof(double));
+  }
+}
+
+int band_plu(int n, int kl, int ku, double AB[n][BAND_WIDTH(kl, ku)],
+	     int ipiv[n])
+{
+  int info = 0;
+  for(int k = 0; k < n; ++k) {
+    const int last = k + kl < n ? k + kl : n - 1;
+    /* Columns k..jend of the rows k..last may be nonzero. */
+    const int jend = k + ku + kl < n ? k + ku + kl : n - 1;
+
+    int max_row = k;
+    for(int i = k+1; i <= last; ++i) {
+      if(fabs(AB[i][k - i + kl]) > fabs(AB[max_row][k - max_row + kl])) {
+	max_row = i;
+      }
+    }
+    ipiv[k] = max_row;
+    if(max_row != k) {
+      for(int j = k; j <= jend; ++j) {
+	SWAP(AB[k][j - k + kl], AB[max_row][j - max_row + kl], double);
+      }
+    }
+
+    /* A zero pivot means a zero column: skip the step, as plu does. */
+    if(AB[k][kl] == 0) {
+      if(info == 0) {
+	info = k+1;
+      }
+      continue;
+    }
+
+    for(int i = k+1; i <= last; ++i) {
+      double *l = &AB[i][k - i + kl];
+      *l /= AB[k][kl];
+      kernel_axpy(jend - k, -*l, &AB[k][kl + 1], l + 1);
+    }
+  }
+  return info;
+}
+
+void band_plu_solve(int n, int kl, int ku,
+		    const double AB[n][BAND_WIDTH(kl, ku)], const int ipiv[n],
+		    double b[n])
+{
+  for(int k = 0; k < n; ++k) {
+    if(ipiv[k] != k) {
+      SWAP(b[k], b[ipiv[k]], double);
+    }
+    const int last = k + kl < n ? k + kl : n - 1;
+    for(int i = k+1; i <= last; ++i) {
+      b[i] -= AB[i][k - i + kl] * b[k];
+    }
+  }
+  for(int i = n-1; i >= 0; --i) {
+    const int jend = i + ku + kl < n ? i + ku + kl : n - 1;
+    b[i] -= kernel_dot(jend - i, &AB[i][kl + 1], &b[i+1]);
+    b[i] /= AB[i][kl];
+  }
+}
+
+int tridiagonal_solve_in_place(int n, const double dl[n], double d[n],
+			       const double du[n], double b[n])
+{
+  for(int i = 1; i < n; ++i) {
+    if(d[i-1] == 0) {
+      return i;
+    }
+    const double m = dl[i] / d[i-1];
+    d[i] -= m * du[i-1];
+    b[i] -= m * b[i-1];
+  }
+  if(n > 0 && d[n-1] == 0) {
+    return n;
+  }
+  for(int i = n-1; i >= 0; --i) {
+    if(i < n-1) {
+      b[i] -= du[i] * b[i+1];
+    }
+    b[i] /= d[i];
+  }
+  return 0;
+}
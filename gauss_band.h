@@ -0,0 +1,50 @@
+/*----------------------------------------------------------------
+* File:     gauss_band.h
+*----------------------------------------------------------------*/
+
+#ifndef GAUSS_BAND_H
+#define GAUSS_BAND_H
+
+/* Band storage of an n x n matrix with kl subdiagonals and ku
+   superdiagonals: row i of AB holds columns i-kl .. i+ku+kl of row i
+   of A, so that element (i,j) is AB[i][j - i + kl]. The last kl
+   columns of each row are room for the fill-in created by partial
+   pivoting and must be zero on input to band_plu. Entries outside the
+   matrix are never read. Memory is n * BAND_WIDTH(kl, ku) doubles. */
+#define BAND_WIDTH(kl, ku) (2 * (kl) + (ku) + 1)
+
+/* Smallest kl and ku such that A[i][j] == 0 whenever j < i - kl or
+   j > i + ku. */
+void band_detect(int n, const double A[n][n], int *kl, int *ku);
+
+/* Store A, whose bandwidth is at most (kl, ku), in band form, with the
+   fill-in area cleared. */
+void dense_to_band(int n, const double A[n][n], int kl, int ku,
+		   double AB[n][BAND_WIDTH(kl, ku)]);
+
+/* LU with partial pivoting in band storage, in O(n kl (kl + ku))
+   operations. U (with bandwidth kl + ku) and the multipliers of L
+   overwrite AB. Unlike plu, rows are interchanged only to the right of
+   the current column, as in LAPACK dgbtrf: ipiv[k] is the row that was
+   swapped with row k at step k, and the interchanges have to be
+   applied in order, as band_plu_solve does. Returns 0, or k+1 for the
+   first step k whose column is zero; as in plu the step is skipped
+   and the factorization completed, with U singular. */
+int band_plu(int n, int kl, int ku, double AB[n][BAND_WIDTH(kl, ku)],
+	     int ipiv[n]);
+
+/* Solve A x = b with the output of band_plu; b is overwritten with x. */
+void band_plu_solve(int n, int kl, int ku,
+		    const double AB[n][BAND_WIDTH(kl, ku)], const int ipiv[n],
+		    double b[n]);
+
+/* Thomas algorithm for a tridiagonal system, in 8n operations:
+   dl[i] = A[i][i-1] (dl[0] unused), d[i] = A[i][i], du[i] = A[i][i+1]
+   (du[n-1] unused). Like gauss_solve_in_place there is no pivoting,
+   which is stable for diagonally dominant matrices. d is overwritten
+   with the pivots and b with the solution. Returns 0, or k+1 if the
+   pivot of step k is zero; it stops there, with b unsolved. */
+int tridiagonal_solve_in_place(int n, const double dl[n], double d[n],
+			       const double du[n], double b[n]);
+
+#endif
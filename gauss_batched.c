@@ -0,0 +1,295 @@
+/*----------------------------------------------------------------
+* File:     gauss_batched.c
+*----------------------------------------------------------------*/
+/* Solvers for many small independent systems. Systems are packed in
+   groups of BATCH_W with the lane index innermost, so that every
+   innermost loop runs over BATCH_W systems with the same trip count
+   and no dependence; the compiler turns it into full-width SIMD
+   instructions. */
+
+#include <math.h>
+#include <stdlib.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "gauss_solve.h"
+#include "gauss_batched.h"
+
+/* The group kernels are compiled for several ISAs and the best one is
+   picked when the library is loaded, as for gauss_kernels.c. */
+#if defined(__x86_64__) && defined(__GNUC__)
+#define BATCH_CLONES __attribute__((target_clones("avx512f", "avx2", "default")))
+#else
+#define BATCH_CLONES
+#endif
+
+BATCH_CLONES
+void gauss_solve_interleaved(int n, double A[n][n][BATCH_W],
+			     double b[n][BATCH_W], int info[BATCH_W])
+{
+  /* A lane whose pivot is zero stops there: it divides by 1 and keeps
+     its old values from then on, so that no lane divides by zero. */
+  for(int l = 0; l < BATCH_W; ++l) {
+    info[l] = 0;
+  }
+  for(int k = 0; k < n; ++k) {
+    double d[BATCH_W];
+    for(int l = 0; l < BATCH_W; ++l) {
+      if(info[l] == 0 && A[k][k][l] == 0) {
+	info[l] = k + 1;
+      }
+      d[l] = info[l] ? 1 : A[k][k][l];
+    }
+    for(int i = k+1; i < n; ++i) {
+      double m[BATCH_W];
+      for(int l = 0; l < BATCH_W; ++l) {
+	m[l] = info[l] ? 0 : A[i][k][l] / d[l];
+	A[i][k][l] = info[l] ? A[i][k][l] : m[l];
+      }
+      for(int j = k+1; j < n; ++j) {
+	for(int l = 0; l < BATCH_W; ++l) {
+	  A[i][j][l] -= m[l] * A[k][j][l];
+	}
+      }
+      for(int l = 0; l < BATCH_W; ++l) {
+	b[i][l] -= m[l] * b[k][l];
+      }
+    }
+  }
+  for(int i = n-1; i >= 0; --i) {
+    for(int j = i+1; j < n; ++j) {
+      for(int l = 0; l < BATCH_W; ++l) {
+	b[i][l] -= info[l] ? 0 : A[i][j][l] * b[j][l];
+      }
+    }
+    for(int l = 0; l < BATCH_W; ++l) {
+      b[i][l] /= info[l] ? 1 : A[i][i][l];
+    }
+  }
+}
+
+BATCH_CLONES
+void plu_interleaved(int n, double A[n][n][BATCH_W], int P[n][BATCH_W],
+		     int info[BATCH_W])
+{
+  for(int i = 0; i < n; ++i) {
+    for(int l = 0; l < BATCH_W; ++l) {
+      P[i][l] = i;
+    }
+  }
+  for(int l = 0; l < BATCH_W; ++l) {
+    info[l] = 0;
+  }
+
+  for(int k = 0; k < n; ++k) {
+    /* Pivot search in all lanes at once; ties go to the first row, as
+       in plu. */
+    int max_row[BATCH_W];
+    double max_abs[BATCH_W];
+    for(int l = 0; l < BATCH_W; ++l) {
+      max_row[l] = k;
+      max_abs[l] = fabs(A[k][k][l]);
+    }
+    for(int i = k+1; i < n; ++i) {
+      for(int l = 0; l < BATCH_W; ++l) {
+	const double a = fabs(A[i][k][l]);
+	max_row[l] = a > max_abs[l] ? i : max_row[l];
+	max_abs[l] = a > max_abs[l] ? a : max_abs[l];
+      }
+    }
+
+    /* Row swaps differ from lane to lane. */
+    for(int l = 0; l < BATCH_W; ++l) {
+      const int r = max_row[l];
+      if(r != k) {
+	for(int j = 0; j < n; ++j) {
+	  SWAP(A[k][j][l], A[r][j][l], double);
+	}
+	SWAP(P[k][l], P[r][l], int);
+      }
+    }
+
+    /* A zero pivot means a zero column: the step is skipped, as in
+       plu, by dividing its zeros by 1. */
+    double d[BATCH_W];
+    for(int l = 0; l < BATCH_W; ++l) {
+      if(info[l] == 0 && max_abs[l] == 0) {
+	info[l] = k + 1;
+      }
+      d[l] = max_abs[l] == 0 ? 1 : A[k][k][l];
+    }
+    for(int i = k+1; i < n; ++i) {
+      double m[BATCH_W];
+      for(int l = 0; l < BATCH_W; ++l) {
+	m[l] = A[i][k][l] / d[l];
+	A[i][k][l] = m[l];
+      }
+      for(int j = k+1; j < n; ++j) {
+	for(int l = 0; l < BATCH_W; ++l) {
+	  A[i][j][l] -= m[l] * A[k][j][l];
+	}
+      }
+    }
+  }
+}
+
+/* Copy matrices s0..s0+cnt-1 into the interleaved group G and fill
+   the lanes cnt..BATCH_W-1 with the identity. */
+static void pack_group(int batch, int n, double A[batch][n][n],
+		       double G[n][n][BATCH_W], int s0, int cnt)
+{
+  for(int i = 0; i < n; ++i) {
+    for(int j = 0; j < n; ++j) {
+      for(int l = 0; l < cnt; ++l) {
+	G[i][j][l] = A[s0 + l][i][j];
+      }
+      for(int l = cnt; l < BATCH_W; ++l) {
+	G[i][j][l] = i == j;
+      }
+    }
+  }
+}
+
+static void unpack_group(int batch, int n, double A[batch][n][n],
+			 double G[n][n][BATCH_W], int s0, int cnt)
+{
+  for(int l = 0; l < cnt; ++l) {
+    for(int i = 0; i < n; ++i) {
+      for(int j = 0; j < n; ++j) {
+	A[s0 + l][i][j] = G[i][j][l];
+      }
+    }
+  }
+}
+
+/* The number of nonzero statuses of the group, copied to info. */
+static int group_status(const int g[BATCH_W], int cnt, int info[])
+{
+  int count = 0;
+  for(int l = 0; l < cnt; ++l) {
+    count += g[l] != 0;
+    if(info) {
+      info[l] = g[l];
+    }
+  }
+  return count;
+}
+
+int gauss_solve_batched(int batch, int n, double A[batch][n][n],
+			double b[batch][n], int info[])
+{
+  const int ngroups = (batch + BATCH_W - 1) / BATCH_W;
+  const int nt = gauss_get_num_threads();
+  int count = 0;
+
+  /* One group buffer per thread, reused for all its groups; if there
+     is no memory for them, one system at a time. */
+  const size_t per = sizeof(double[n][n][BATCH_W])
+    + sizeof(double[n][BATCH_W]);
+  char *buf = ngroups > 0 ? malloc(nt * per) : NULL;
+  if(!buf) {
+    for(int s = 0; s < batch; ++s) {
+      const int st = gauss_solve_in_place(n, A[s], b[s]);
+      count += st != 0;
+      if(info) {
+	info[s] = st;
+      }
+    }
+    return count;
+  }
+
+#pragma omp parallel num_threads(nt) if(nt > 1 && ngroups > 1) \
+  reduction(+:count)
+  {
+#ifdef _OPENMP
+    char *mine = buf + omp_get_thread_num() * per;
+#else
+    char *mine = buf;
+#endif
+    double (*G)[n][BATCH_W] = (double (*)[n][BATCH_W])mine;
+    double (*g)[BATCH_W] =
+      (double (*)[BATCH_W])(mine + sizeof(double[n][n][BATCH_W]));
+
+#pragma omp for schedule(static)
+    for(int grp = 0; grp < ngroups; ++grp) {
+      const int s0 = grp * BATCH_W;
+      const int cnt = s0 + BATCH_W <= batch ? BATCH_W : batch - s0;
+      int st[BATCH_W];
+
+      pack_group(batch, n, A, G, s0, cnt);
+      for(int i = 0; i < n; ++i) {
+	for(int l = 0; l < BATCH_W; ++l) {
+	  g[i][l] = l < cnt ? b[s0 + l][i] : 0;
+	}
+      }
+
+      gauss_solve_interleaved(n, G, g, st);
+
+      unpack_group(batch, n, A, G, s0, cnt);
+      for(int l = 0; l < cnt; ++l) {
+	for(int i = 0; i < n; ++i) {
+	  b[s0 + l][i] = g[i][l];
+	}
+      }
+      count += group_status(st, cnt, info ? info + s0 : NULL);
+    }
+  }
+
+  free(buf);
+  return count;
+}
+
+int plu_batched(int batch, int n, double A[batch][n][n], int P[batch][n],
+		int info[])
+{
+  const int ngroups = (batch + BATCH_W - 1) / BATCH_W;
+  const int nt = gauss_get_num_threads();
+  int count = 0;
+
+  const size_t per = sizeof(double[n][n][BATCH_W]) + sizeof(int[n][BATCH_W]);
+  char *buf = ngroups > 0 ? malloc(nt * per) : NULL;
+  if(!buf) {
+    for(int s = 0; s < batch; ++s) {
+      const int st = plu(n, A[s], P[s]);
+      count += st != 0;
+      if(info) {
+	info[s] = st;
+      }
+    }
+    return count;
+  }
+
+#pragma omp parallel num_threads(nt) if(nt > 1 && ngroups > 1) \
+  reduction(+:count)
+  {
+#ifdef _OPENMP
+    char *mine = buf + omp_get_thread_num() * per;
+#else
+    char *mine = buf;
+#endif
+    double (*G)[n][BATCH_W] = (double (*)[n][BATCH_W])mine;
+    int (*Q)[BATCH_W] =
+      (int (*)[BATCH_W])(mine + sizeof(double[n][n][BATCH_W]));
+
+#pragma omp for schedule(static)
+    for(int grp = 0; grp < ngroups; ++grp) {
+      const int s0 = grp * BATCH_W;
+      const int cnt = s0 + BATCH_W <= batch ? BATCH_W : batch - s0;
+      int st[BATCH_W];
+
+      pack_group(batch, n, A, G, s0, cnt);
+      plu_interleaved(n, G, Q, st);
+      unpack_group(batch, n, A, G, s0, cnt);
+      for(int l = 0; l < cnt; ++l) {
+	for(int i = 0; i < n; ++i) {
+	  P[s0 + l][i] = Q[i][l];
+	}
+      }
+      count += group_status(st, cnt, info ? info + s0 : NULL);
+    }
+  }
+
+  free(buf);
+  return count;
+}
@@ -0,0 +1,41 @@
+/*----------------------------------------------------------------
+* File:     gauss_batched.h
+*----------------------------------------------------------------*/
+
+#ifndef GAUSS_BATCHED_H
+#define GAUSS_BATCHED_H
+
+/* Number of systems processed side by side, one per SIMD lane (eight
+   doubles fill an AVX-512 register, two AVX2 registers). */
+#define BATCH_W 8
+
+/* Solve batch independent systems A[s] x = b[s] of size n, like
+   gauss_solve_in_place: A[s] is overwritten with its packed L\U and
+   b[s] with the solution. Groups of BATCH_W systems are interleaved
+   internally so that SIMD lanes run across systems, and the groups are
+   spread over gauss_get_num_threads() threads; if there is no memory
+   for the groups, the systems are solved one at a time. info[s] (if
+   info is not NULL) receives the status of system s, as returned by
+   gauss_solve_in_place: 0, or k+1 if it stopped at a zero pivot at
+   step k. Returns the number of systems with a nonzero status. */
+int gauss_solve_batched(int batch, int n, double A[batch][n][n],
+			double b[batch][n], int info[]);
+
+/* PLU of batch independent matrices, like plu: A[s] is overwritten
+   with its packed L\U, P[s] receives its permutation vector and
+   info[s] (if info is not NULL) the status of plu. Returns the number
+   of singular matrices. */
+int plu_batched(int batch, int n, double A[batch][n][n], int P[batch][n],
+		int info[]);
+
+/* The kernels on one group in the interleaved ("batch-major") layout:
+   element (i,j) of lane l is A[i][j][l]. Callers that keep their data
+   in this layout can call them directly and skip the packing. info[l]
+   receives the status of lane l, as above; a lane with a zero pivot
+   does not disturb the others. */
+void gauss_solve_interleaved(int n, double A[n][n][BATCH_W],
+			     double b[n][BATCH_W], int info[BATCH_W]);
+void plu_interleaved(int n, double A[n][n][BATCH_W], int P[n][BATCH_W],
+		     int info[BATCH_W]);
+
+#endif
@@ -0,0 +1,39 @@
+/*----------------------------------------------------------------
+* File:     gauss_blocks.h
+*----------------------------------------------------------------*/
+
+/* Building blocks shared by the blocked and tiled LU engines. They
+   operate on a row-major matrix with leading dimension lda and are
+   not part of the public API; see gauss_solve.c for details. */
+
+#ifndef GAUSS_BLOCKS_H
+#define GAUSS_BLOCKS_H
+
+/* Blocking factor used by the blocked kernels when the caller passes
+   nb <= 0. A 64-column panel of doubles is 512 bytes per row, so a
+   panel row plus the row being updated stay in L1. */
+#define LU_DEFAULT_NB 64
+
+/* LU without pivoting of rows k0..m-1, columns k0..k0+kb-1. Returns
+   0, or k+1 if it stopped at the zero pivot of step k. */
+int block_lu_panel_nopiv(int lda, double A[][lda], int k0, int kb, int m);
+
+/* LU with partial pivoting of rows k0..m-1, columns k0..k0+kb-1;
+   the pivot row of step k is stored in ipiv[k-k0]. Returns 0, or k+1
+   for the first step k whose column is zero (and skipped). */
+int block_plu_panel(int lda, double A[][lda], int k0, int kb, int m,
+		    int ipiv[]);
+
+/* Apply the interchanges ipiv of rows k0..k0+kb-1 to columns j0..j1-1. */
+void block_laswp(int lda, double A[][lda], int j0, int j1, int k0, int kb,
+		 const int ipiv[]);
+
+/* Rows k0..k0+kb-1, columns j0..j1-1 := L11^{-1} times themselves. */
+void block_trsm_unit_lower(int lda, double A[][lda], int k0, int kb,
+			   int j0, int j1, int nt);
+
+/* Rows i0..m-1, columns j0..j1-1 -= L(:, k0..k0+kb-1) U(k0..k0+kb-1, :). */
+void block_gemm_update(int lda, double A[][lda], int i0, int m,
+		       int j0, int j1, int k0, int kb, int nt);
+
+#endif
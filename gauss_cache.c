@@ -0,0 +1,344 @@
+/*----------------------------------------------------------------
+* File:     gauss_cache.c
+*----------------------------------------------------------------*/
+/* LRU cache of PLU factorizations. Entries live in a chained hash
+   table keyed by a 64-bit key and in a doubly linked list ordered by
+   last use. Factoring and solving run outside the lock; an entry that
+   is evicted while a solve is using it is freed by the last user. */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "gauss_solve.h"
+#include "gauss_fixed.h"
+#include "gauss_cache.h"
+
+typedef struct cache_entry {
+  uint64_t key;
+  int n;
+  double *LU;
+  int *P;
+  double *A;			/* Copy of A when keyed by its hash */
+  size_t bytes;
+  int refs;			/* Solves in progress */
+  int dead;			/* Evicted, free when refs drops to 0 */
+  struct cache_entry *prev, *next;	/* LRU list, most recent first */
+  struct cache_entry *chain;		/* Hash bucket */
+} cache_entry;
+
+struct gauss_cache {
+  pthread_mutex_t lock;
+  size_t max_bytes;
+  cache_entry **buckets;
+  size_t nbuckets;		/* A power of two */
+  cache_entry *head, *tail;
+  gauss_cache_stats stats;
+};
+
+#define CACHE_MIN_BUCKETS 64
+
+/* The round and constants of XXH64: four independent lanes, so the
+   hash runs at memory speed. */
+#define HASH_P1 0x9E3779B185EBCA87ULL
+#define HASH_P2 0xC2B2AE3D27D4EB4FULL
+#define HASH_P3 0x165667B19E3779F9ULL
+
+static uint64_t rotl64(uint64_t x, int r)
+{
+  return (x << r) | (x >> (64 - r));
+}
+
+static uint64_t hash_round(uint64_t acc, uint64_t w)
+{
+  return rotl64(acc + w * HASH_P2, 31) * HASH_P1;
+}
+
+uint64_t gauss_matrix_hash(int n, const double A[n][n])
+{
+  const double *a = &A[0][0];
+  const size_t len = (size_t)n * n;
+  uint64_t v[4] = { HASH_P1 + HASH_P2, HASH_P2, 0, -HASH_P1 };
+  size_t i = 0;
+
+  for(; i + 4 <= len; i += 4) {
+    uint64_t w[4];
+    memcpy(w, a + i, sizeof(w));
+    for(int l = 0; l < 4; ++l) {
+      v[l] = hash_round(v[l], w[l]);
+    }
+  }
+  uint64_t h = rotl64(v[0], 1) + rotl64(v[1], 7) + rotl64(v[2], 12)
+    + rotl64(v[3], 18) + (uint64_t)n * HASH_P3;
+  for(; i < len; ++i) {
+    uint64_t w;
+    memcpy(&w, a + i, sizeof(w));
+    h = rotl64(h ^ hash_round(0, w), 27) * HASH_P1 + HASH_P3;
+  }
+  h ^= h >> 33;
+  h *= HASH_P2;
+  h ^= h >> 29;
+  h *= HASH_P3;
+  h ^= h >> 32;
+  return h ? h : 1;
+}
+
+gauss_cache *gauss_cache_create(size_t max_bytes)
+{
+  gauss_cache *c = calloc(1, sizeof(*c));
+  if(!c) {
+    return NULL;
+  }
+  c->buckets = calloc(CACHE_MIN_BUCKETS, sizeof(cache_entry *));
+  if(!c->buckets) {
+    free(c);
+    return NULL;
+  }
+  c->nbuckets = CACHE_MIN_BUCKETS;
+  c->max_bytes = max_bytes;
+  pthread_mutex_init(&c->lock, NULL);
+  return c;
+}
+
+static void entry_free(cache_entry *e)
+{
+  free(e->LU);
+  free(e->P);
+  free(e->A);
+  free(e);
+}
+
+void gauss_cache_destroy(gauss_cache *c)
+{
+  if(!c) {
+    return;
+  }
+  cache_entry *e = c->head;
+  while(e) {
+    cache_entry *next = e->next;
+    entry_free(e);
+    e = next;
+  }
+  pthread_mutex_destroy(&c->lock);
+  free(c->buckets);
+  free(c);
+}
+
+static cache_entry **bucket_of(gauss_cache *c, uint64_t key)
+{
+  return &c->buckets[(key ^ (key >> 29)) & (c->nbuckets - 1)];
+}
+
+static void lru_unlink(gauss_cache *c, cache_entry *e)
+{
+  if(e->prev) {
+    e->prev->next = e->next;
+  } else {
+    c->head = e->next;
+  }
+  if(e->next) {
+    e->next->prev = e->prev;
+  } else {
+    c->tail = e->prev;
+  }
+  e->prev = e->next = NULL;
+}
+
+static void lru_push_front(gauss_cache *c, cache_entry *e)
+{
+  e->prev = NULL;
+  e->next = c->head;
+  if(c->head) {
+    c->head->prev = e;
+  } else {
+    c->tail = e;
+  }
+  c->head = e;
+}
+
+/* Remove e from the table and the list; the caller holds the lock. */
+static void cache_remove(gauss_cache *c, cache_entry *e)
+{
+  cache_entry **pp = bucket_of(c, e->key);
+  while(*pp != e) {
+    pp = &(*pp)->chain;
+  }
+  *pp = e->chain;
+  lru_unlink(c, e);
+  c->stats.bytes -= e->bytes;
+  --c->stats.entries;
+  if(e->refs > 0) {
+    e->dead = 1;
+  } else {
+    entry_free(e);
+  }
+}
+
+/* Double the number of buckets when the table gets full. */
+static void cache_grow(gauss_cache *c)
+{
+  const size_t nb = 2 * c->nbuckets;
+  cache_entry **buckets = calloc(nb, sizeof(cache_entry *));
+  if(!buckets) {
+    return;
+  }
+  cache_entry **old = c->buckets;
+  const size_t old_nb = c->nbuckets;
+  c->buckets = buckets;
+  c->nbuckets = nb;
+  for(size_t b = 0; b < old_nb; ++b) {
+    cache_entry *e = old[b];
+    while(e) {
+      cache_entry *chain = e->chain;
+      cache_entry **pp = bucket_of(c, e->key);
+      e->chain = *pp;
+      *pp = e;
+      e = chain;
+    }
+  }
+  free(old);
+}
+
+static cache_entry *cache_find(gauss_cache *c, uint64_t key)
+{
+  cache_entry *e = *bucket_of(c, key);
+  while(e && e->key != key) {
+    e = e->chain;
+  }
+  return e;
+}
+
+static void entry_release(gauss_cache *c, cache_entry *e)
+{
+  pthread_mutex_lock(&c->lock);
+  const int last = --e->refs == 0 && e->dead;
+  pthread_mutex_unlock(&c->lock);
+  if(last) {
+    entry_free(e);
+  }
+}
+
+int gauss_cache_solve(gauss_cache *c, uint64_t key, int n,
+		      const double A[n][n], int nrhs, double B[n][nrhs])
+{
+  const int hashed = key == 0;
+  if(hashed) {
+    key = gauss_matrix_hash(n, A);
+  }
+
+  pthread_mutex_lock(&c->lock);
+  cache_entry *e = cache_find(c, key);
+  if(e && e->n == n) {
+    ++e->refs;
+  } else {
+    e = NULL;
+  }
+  pthread_mutex_unlock(&c->lock);
+
+  /* Rule out a hash collision, outside the lock. An entry inserted
+     under a caller key equal to the hash has no copy of A and cannot
+     be checked. A stale entry is replaced below when the new factors
+     are inserted. */
+  if(e && hashed
+     && (!e->A || memcmp(e->A, A, sizeof(double[n][n])) != 0)) {
+    entry_release(c, e);
+    e = NULL;
+  }
+
+  if(e) {
+    pthread_mutex_lock(&c->lock);
+    ++c->stats.hits;
+    if(!e->dead) {
+      lru_unlink(c, e);
+      lru_push_front(c, e);
+    }
+    pthread_mutex_unlock(&c->lock);
+
+    plu_solve(n, (const double (*)[n])e->LU, e->P, nrhs, B);
+    entry_release(c, e);
+    return 1;
+  }
+
+  /* Miss: factor outside the lock. */
+  e = calloc(1, sizeof(*e));
+  if(!e) {
+    return -1;
+  }
+  e->key = key;
+  e->n = n;
+  e->bytes = sizeof(double[n][n]) + n * sizeof(int) + sizeof(*e);
+  e->LU = malloc(sizeof(double[n][n]));
+  e->P = malloc(n * sizeof(int));
+  if(hashed) {
+    e->A = malloc(sizeof(double[n][n]));
+    e->bytes += sizeof(double[n][n]);
+  }
+  if(!e->LU || !e->P || (hashed && !e->A)) {
+    entry_free(e);
+    return -1;
+  }
+  memcpy(e->LU, A, sizeof(double[n][n]));
+  if(hashed) {
+    memcpy(e->A, A, sizeof(double[n][n]));
+  }
+  double (*LU)[n] = (double (*)[n])e->LU;
+  const int info = n <= FIXED_MAX_N ? plu(n, LU, e->P)
+    : plu_blocked(n, LU, e->P, 0);
+  if(info) {
+    /* Singular: nothing to solve with, and nothing worth caching. */
+    pthread_mutex_lock(&c->lock);
+    ++c->stats.misses;
+    pthread_mutex_unlock(&c->lock);
+    entry_free(e);
+    return -1 - info;
+  }
+  plu_solve(n, (const double (*)[n])LU, e->P, nrhs, B);
+
+  pthread_mutex_lock(&c->lock);
+  ++c->stats.misses;
+  if(e->bytes > c->max_bytes) {
+    pthread_mutex_unlock(&c->lock);
+    entry_free(e);
+    return 0;
+  }
+  /* Drop a stale entry with this key, or the same factors inserted by
+     another thread meanwhile. */
+  cache_entry *other = cache_find(c, key);
+  if(other) {
+    cache_remove(c, other);
+  }
+  while(c->tail && c->stats.bytes + e->bytes > c->max_bytes) {
+    cache_remove(c, c->tail);
+    ++c->stats.evictions;
+  }
+  if((size_t)c->stats.entries >= c->nbuckets) {
+    cache_grow(c);
+  }
+  cache_entry **pp = bucket_of(c, key);
+  e->chain = *pp;
+  *pp = e;
+  lru_push_front(c, e);
+  c->stats.bytes += e->bytes;
+  ++c->stats.entries;
+  pthread_mutex_unlock(&c->lock);
+  return 0;
+}
+
+void gauss_cache_forget(gauss_cache *c, uint64_t key)
+{
+  pthread_mutex_lock(&c->lock);
+  cache_entry *e = cache_find(c, key);
+  if(e) {
+    cache_remove(c, e);
+  }
+  pthread_mutex_unlock(&c->lock);
+}
+
+void gauss_cache_get_stats(gauss_cache *c, gauss_cache_stats *stats)
+{
+  pthread_mutex_lock(&c->lock);
+  *stats = c->stats;
+  pthread_mutex_unlock(&c->lock);
+}
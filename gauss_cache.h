@@ -0,0 +1,49 @@
+/*----------------------------------------------------------------
+* File:     gauss_cache.h
+*----------------------------------------------------------------*/
+
+#ifndef GAUSS_CACHE_H
+#define GAUSS_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* An LRU cache of PLU factorizations with a cap on the bytes it
+   holds. All functions are thread-safe. */
+typedef struct gauss_cache gauss_cache;
+
+typedef struct {
+  long   hits, misses, evictions;
+  long   entries;
+  size_t bytes;
+} gauss_cache_stats;
+
+gauss_cache *gauss_cache_create(size_t max_bytes);
+void         gauss_cache_destroy(gauss_cache *cache);
+
+/* Solve A X = B (B is n x nrhs, overwritten with X) with the cached
+   factorization of A, factoring A with plu and caching it on a miss;
+   A itself is never modified.
+
+   If key != 0 it identifies the matrix: the caller promises that the
+   same key always comes with the same A. If key == 0 the key is
+   gauss_matrix_hash(A), and a copy of A is kept with the factors so
+   that a hash collision can never return the factors of another
+   matrix.
+
+   Returns 1 on a hit, 0 on a miss, -1 if memory for the factors could
+   not be allocated, and -1 - info if A is singular, where info = k+1
+   is the status of plu for a zero pivot at step k. B is untouched in
+   the last two cases, and singular factors are never cached. */
+int gauss_cache_solve(gauss_cache *cache, uint64_t key, int n,
+		      const double A[n][n], int nrhs, double B[n][nrhs]);
+
+/* Drop the entry for key, if any. */
+void gauss_cache_forget(gauss_cache *cache, uint64_t key);
+
+void gauss_cache_get_stats(gauss_cache *cache, gauss_cache_stats *stats);
+
+/* Fast 64-bit hash of the contents of A (never 0). */
+uint64_t gauss_matrix_hash(int n, const double A[n][n]);
+
+#endif
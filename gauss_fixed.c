@@ -0,0 +1,115 @@
+/*----------------------------------------------------------------
+* File:     gauss_fixed.c
+*----------------------------------------------------------------*/
+/* Instantiation of the fixed-size kernels of gauss_fixed_impl.h for
+   n = 2..FIXED_MAX_N, and the switches that dispatch to them. */
+
+#include <math.h>
+#include <string.h>
+
+#include "gauss_solve.h"
+#include "gauss_fixed.h"
+
+#define FIXED_CAT_(A, B) A ## B
+#define FIXED_CAT(A, B) FIXED_CAT_(A, B)
+#define FIXED_UNROLL _Pragma("GCC unroll 16")
+
+/* Largest size whose kernels are fully unrolled and register resident. */
+#define FIXED_REG_MAX_N 8
+
+/* Copy the FIXED_N x FIXED_N matrix with leading dimension lda at A
+   into the local array a, and back. */
+#define FIXED_LOAD(a, A, lda) do {				\
+    for(int r_ = 0; r_ < FIXED_N; ++r_) {			\
+      memcpy((a)[r_], (A) + (size_t)r_ * (lda), sizeof((a)[r_]));	\
+    }								\
+  } while(0)
+#define FIXED_STORE(A, lda, a) do {				\
+    for(int r_ = 0; r_ < FIXED_N; ++r_) {			\
+      memcpy((A) + (size_t)r_ * (lda), (a)[r_], sizeof((a)[r_]));	\
+    }								\
+  } while(0)
+
+#define FIXED_N 2
+#include "gauss_fixed_impl.h"
+#undef FIXED_N
+#define FIXED_N 3
+#include "gauss_fixed_impl.h"
+#undef FIXED_N
+#define FIXED_N 4
+#include "gauss_fixed_impl.h"
+#undef FIXED_N
+#define FIXED_N 5
+#include "gauss_fixed_impl.h"
+#undef FIXED_N
+#define FIXED_N 6
+#include "gauss_fixed_impl.h"
+#undef FIXED_N
+#define FIXED_N 7
+#include "gauss_fixed_impl.h"
+#undef FIXED_N
+#define FIXED_N 8
+#include "gauss_fixed_impl.h"
+#undef FIXED_N
+#define FIXED_N 9
+#include "gauss_fixed_impl.h"
+#undef FIXED_N
+#define FIXED_N 10
+#include "gauss_fixed_impl.h"
+#undef FIXED_N
+#define FIXED_N 11
+#include "gauss_fixed_impl.h"
+#undef FIXED_N
+#define FIXED_N 12
+#include "gauss_fixed_impl.h"
+#undef FIXED_N
+#define FIXED_N 13
+#include "gauss_fixed_impl.h"
+#undef FIXED_N
+#define FIXED_N 14
+#include "gauss_fixed_impl.h"
+#undef FIXED_N
+#define FIXED_N 15
+#include "gauss_fixed_impl.h"
+#undef FIXED_N
+#define FIXED_N 16
+#include "gauss_fixed_impl.h"
+#undef FIXED_N
+
+/* Expands to one case per size, calling F##N with the arguments of the
+   dispatcher. */
+#define FIXED_CASE(F, N, CALL) case N: *info = CALL(F, N); return 1;
+#define FIXED_CASES(F, CALL)						\
+  FIXED_CASE(F, 2, CALL)  FIXED_CASE(F, 3, CALL)  FIXED_CASE(F, 4, CALL)	\
+  FIXED_CASE(F, 5, CALL)  FIXED_CASE(F, 6, CALL)  FIXED_CASE(F, 7, CALL)	\
+  FIXED_CASE(F, 8, CALL)  FIXED_CASE(F, 9, CALL)  FIXED_CASE(F, 10, CALL)	\
+  FIXED_CASE(F, 11, CALL) FIXED_CASE(F, 12, CALL) FIXED_CASE(F, 13, CALL) \
+  FIXED_CASE(F, 14, CALL) FIXED_CASE(F, 15, CALL) FIXED_CASE(F, 16, CALL)
+
+#define CALL_SOLVE(F, N) F ## N(lda, A, b)
+#define CALL_LU(F, N)    F ## N(lda, A)
+#define CALL_PLU(F, N)   F ## N(lda, A, P)
+
+int gauss_solve_fixed(int n, int lda, double *A, double *b, int *info)
+{
+  switch(n) {
+    FIXED_CASES(gauss_solve_fixed_, CALL_SOLVE)
+  }
+  return 0;
+}
+
+int lu_fixed(int n, int lda, double *A, int *info)
+{
+  switch(n) {
+    FIXED_CASES(lu_fixed_, CALL_LU)
+  }
+  return 0;
+}
+
+int plu_fixed(int n, int lda, double *A, int *P, int *info)
+{
+  switch(n) {
+    FIXED_CASES(plu_fixed_, CALL_PLU)
+  }
+  return 0;
+}
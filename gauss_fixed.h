@@ -0,0 +1,21 @@
+/*----------------------------------------------------------------
+* File:     gauss_fixed.h
+*----------------------------------------------------------------*/
+
+/* Fully unrolled kernels for the sizes 2..FIXED_MAX_N, used by
+   gauss_solve_in_place, lu_in_place and plu when n is small. Each
+   function returns 1 if it handled the call, with the status of the
+   solver it replaces in *info, and 0 if there is no kernel for n, in
+   which case nothing was touched. The n x n matrix is stored at A with
+   leading dimension lda. */
+
+#ifndef GAUSS_FIXED_H
+#define GAUSS_FIXED_H
+
+#define FIXED_MAX_N 16
+
+int gauss_solve_fixed(int n, int lda, double *A, double *b, int *info);
+int lu_fixed(int n, int lda, double *A, int *info);
+int plu_fixed(int n, int lda, double *A, int *P, int *info);
+
+#endif
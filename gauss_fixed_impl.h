@@ -0,0 +1,150 @@
+/*----------------------------------------------------------------
+* File:     gauss_fixed_impl.h
+*----------------------------------------------------------------*/
+
+/* Body of the fixed-size kernels, included by gauss_fixed.c once per
+   size with FIXED_N defined (no include guard on purpose). All loop
+   bounds are compile-time constants and the matrix is worked on in a
+   local copy. Up to FIXED_REG_MAX_N every loop is fully unrolled, so
+   the local array is only indexed by constants and the compiler keeps
+   it in registers. Beyond that the matrix no longer fits in the
+   register file and full unrolling only bloats the code; the loops are
+   left to the vectorizer, which still benefits from the constant trip
+   counts. */
+
+#define FIXED_NAME(F) FIXED_CAT(F, FIXED_N)
+
+#if FIXED_N <= FIXED_REG_MAX_N
+#define FIXED_UNROLL_N FIXED_UNROLL
+#else
+#define FIXED_UNROLL_N
+#endif
+
+static int FIXED_NAME(gauss_solve_fixed_)(int lda, double *A,
+					  double b[FIXED_N])
+{
+  double a[FIXED_N][FIXED_N], x[FIXED_N];
+  FIXED_LOAD(a, A, lda);
+  memcpy(x, b, sizeof(x));
+
+  FIXED_UNROLL_N
+  for(int k = 0; k < FIXED_N; ++k) {
+    if(a[k][k] == 0) {
+      FIXED_STORE(A, lda, a);
+      memcpy(b, x, sizeof(x));
+      return k+1;
+    }
+    FIXED_UNROLL_N
+    for(int i = k+1; i < FIXED_N; ++i) {
+      a[i][k] /= a[k][k];
+      FIXED_UNROLL_N
+      for(int j = k+1; j < FIXED_N; ++j) {
+	a[i][j] -= a[i][k] * a[k][j];
+      }
+      x[i] -= a[i][k] * x[k];
+    }
+  }
+  FIXED_UNROLL_N
+  for(int i = FIXED_N-1; i >= 0; --i) {
+    FIXED_UNROLL_N
+    for(int j = i+1; j < FIXED_N; ++j) {
+      x[i] -= a[i][j] * x[j];
+    }
+    x[i] /= a[i][i];
+  }
+
+  FIXED_STORE(A, lda, a);
+  memcpy(b, x, sizeof(x));
+  return 0;
+}
+
+static int FIXED_NAME(lu_fixed_)(int lda, double *A)
+{
+  double a[FIXED_N][FIXED_N];
+  FIXED_LOAD(a, A, lda);
+
+  FIXED_UNROLL_N
+  for(int k = 0; k < FIXED_N; ++k) {
+    if(a[k][k] == 0) {
+      FIXED_STORE(A, lda, a);
+      return k+1;
+    }
+    FIXED_UNROLL_N
+    for(int i = k+1; i < FIXED_N; ++i) {
+      a[i][k] /= a[k][k];
+      FIXED_UNROLL_N
+      for(int j = k+1; j < FIXED_N; ++j) {
+	a[i][j] -= a[i][k] * a[k][j];
+      }
+    }
+  }
+
+  FIXED_STORE(A, lda, a);
+  return 0;
+}
+
+static int FIXED_NAME(plu_fixed_)(int lda, double *A, int P[FIXED_N])
+{
+  int info = 0;
+  double a[FIXED_N][FIXED_N];
+  FIXED_LOAD(a, A, lda);
+  FIXED_UNROLL_N
+  for(int i = 0; i < FIXED_N; ++i) {
+    P[i] = i;
+  }
+
+  FIXED_UNROLL_N
+  for(int k = 0; k < FIXED_N; ++k) {
+    int max_row = k;
+    double max_abs = fabs(a[k][k]);
+    FIXED_UNROLL_N
+    for(int i = k+1; i < FIXED_N; ++i) {
+      if(fabs(a[i][k]) > max_abs) {
+	max_row = i;
+	max_abs = fabs(a[i][k]);
+      }
+    }
+#if FIXED_N <= FIXED_REG_MAX_N
+    /* Swap by comparing against every candidate row, so that all
+       indices into a stay constant. */
+    FIXED_UNROLL
+    for(int i = k+1; i < FIXED_N; ++i) {
+      if(max_row == i) {
+	FIXED_UNROLL
+	for(int j = 0; j < FIXED_N; ++j) {
+	  SWAP(a[k][j], a[i][j], double);
+	}
+	SWAP(P[k], P[i], int);
+      }
+    }
+#else
+    if(max_row != k) {
+      for(int j = 0; j < FIXED_N; ++j) {
+	SWAP(a[k][j], a[max_row][j], double);
+      }
+      SWAP(P[k], P[max_row], int);
+    }
+#endif
+    /* A zero column: nothing to eliminate, U is singular. */
+    if(max_abs == 0) {
+      if(info == 0) {
+	info = k+1;
+      }
+      continue;
+    }
+    FIXED_UNROLL_N
+    for(int i = k+1; i < FIXED_N; ++i) {
+      a[i][k] /= a[k][k];
+      FIXED_UNROLL_N
+      for(int j = k+1; j < FIXED_N; ++j) {
+	a[i][j] -= a[i][k] * a[k][j];
+      }
+    }
+  }
+
+  FIXED_STORE(A, lda, a);
+  return info;
+}
+
+#undef FIXED_UNROLL_N
+#undef FIXED_NAME
@@ -0,0 +1,454 @@
+/*----------------------------------------------------------------
+* File:     gauss_gpu.c
+*----------------------------------------------------------------*/
+/* cuSOLVER and cuBLAS are column-major. A row-major matrix uploaded as
+   it is reads as its transpose, so each upload is followed by one
+   cublasDgeam transpose on the device and each download is preceded
+   by one. A batch of row-major n x n matrices, seen as one matrix of
+   batch*n rows, is transposed in a single call: matrix s is then the
+   column-major block at row offset s*n with leading dimension batch*n,
+   which cublasDgetrfBatched accepts as it is. All device work of the
+   process goes through one stream and one pair of handles, under a
+   lock. Host data moves through pinned staging buffers that are kept
+   from call to call; uploads are queued on the stream, and the stream
+   is synchronized only when the host needs the result. */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "gauss_solve.h"
+#include "gauss_batched.h"
+#include "gauss_recursive.h"
+#include "gauss_gpu.h"
+
+#ifdef GAUSS_CUDA
+#include <pthread.h>
+#include <cuda_runtime.h>
+#include <cublas_v2.h>
+#include <cusolverDn.h>
+
+/* Pinned host memory, grown as needed and reused. */
+typedef struct {
+  double *buf;
+  size_t count;			/* Capacity in doubles */
+} gpu_staging;
+#endif
+
+struct gauss_lu {
+  int n, backend;
+  double *LU;			/* CPU: the packed factors */
+  int *P;
+#ifdef GAUSS_CUDA
+  double *dA;			/* GPU: column-major factors */
+  int *dipiv;
+  gpu_staging staging;		/* For the right-hand sides */
+#endif
+};
+
+static int min_n = 0, min_batch = 0;
+
+void gauss_gpu_set_thresholds(int n, int batch)
+{
+  min_n = n > 0 ? n : 0;
+  min_batch = batch > 0 ? batch : 0;
+}
+
+#ifdef GAUSS_CUDA
+
+static int env_or(const char *name, int value)
+{
+  const char *env = getenv(name);
+  const int v = env ? atoi(env) : 0;
+  return v > 0 ? v : value;
+}
+
+static int use_gpu_n(int n)
+{
+  return gauss_gpu_available()
+    && n >= (min_n ? min_n : env_or("GAUSS_GPU_MIN_N", GPU_DEFAULT_MIN_N));
+}
+
+static int use_gpu_batch(int batch)
+{
+  return gauss_gpu_available()
+    && batch >= (min_batch ? min_batch
+		 : env_or("GAUSS_GPU_MIN_BATCH", GPU_DEFAULT_MIN_BATCH));
+}
+
+/* P from LAPACK's 1-based interchanges. */
+static void ipiv_to_perm(int n, const int ipiv[n], int P[n])
+{
+  for(int i = 0; i < n; ++i) {
+    P[i] = i;
+  }
+  for(int k = 0; k < n; ++k) {
+    SWAP(P[k], P[ipiv[k] - 1], int);
+  }
+}
+
+static pthread_once_t gpu_once = PTHREAD_ONCE_INIT;
+static pthread_mutex_t gpu_lock = PTHREAD_MUTEX_INITIALIZER;
+static int gpu_ok = 0;
+static cudaStream_t stream;
+static cublasHandle_t blas;
+static cusolverDnHandle_t solver;
+/* The staging buffer of gauss_plu_auto and gauss_plu_batched_auto. */
+static gpu_staging staging;
+
+static void gpu_init(void)
+{
+  int count = 0;
+  if(cudaGetDeviceCount(&count) != cudaSuccess || count == 0
+     || cudaStreamCreate(&stream) != cudaSuccess) {
+    return;
+  }
+  if(cublasCreate(&blas) != CUBLAS_STATUS_SUCCESS) {
+    return;
+  }
+  if(cusolverDnCreate(&solver) != CUSOLVER_STATUS_SUCCESS) {
+    cublasDestroy(blas);
+    return;
+  }
+  cublasSetStream(blas, stream);
+  cusolverDnSetStream(solver, stream);
+  gpu_ok = 1;
+}
+
+int gauss_gpu_available(void)
+{
+  pthread_once(&gpu_once, gpu_init);
+  return gpu_ok;
+}
+
+#define GPU_TRY(x) do { if((x) != 0) goto fail; } while(0)
+
+/* dst (cols x rows, column-major) := transpose of src (rows x cols,
+   column-major). */
+static int gpu_transpose(int rows, int cols, const double *src, double *dst)
+{
+  const double one = 1, zero = 0;
+  return cublasDgeam(blas, CUBLAS_OP_T, CUBLAS_OP_N, cols, rows, &one, src,
+		     rows, &zero, dst, cols, dst, cols) != CUBLAS_STATUS_SUCCESS;
+}
+
+static int staging_reserve(gpu_staging *S, size_t count)
+{
+  if(count <= S->count) {
+    return 0;
+  }
+  cudaFreeHost(S->buf);
+  S->count = 0;
+  if(cudaMallocHost((void **)&S->buf, count * sizeof(double))
+     != cudaSuccess) {
+    S->buf = NULL;
+    return -1;
+  }
+  S->count = count;
+  return 0;
+}
+
+/* Queue the copy of count doubles of the host src to the device
+   through S. src may be reused on return; the stream orders the copy
+   before the work queued after it. */
+static int gpu_upload(gpu_staging *S, double *dst, const double *src,
+		      size_t count)
+{
+  if(staging_reserve(S, count) != 0) {
+    return -1;
+  }
+  memcpy(S->buf, src, count * sizeof(double));
+  return cudaMemcpyAsync(dst, S->buf, count * sizeof(double),
+			 cudaMemcpyHostToDevice, stream) != cudaSuccess;
+}
+
+/* Queue the copy of count doubles of the device src into S->buf,
+   where they are once the stream is synchronized. */
+static int gpu_download_async(gpu_staging *S, const double *src,
+			      size_t count)
+{
+  if(staging_reserve(S, count) != 0) {
+    return -1;
+  }
+  return cudaMemcpyAsync(S->buf, src, count * sizeof(double),
+			 cudaMemcpyDeviceToHost, stream) != cudaSuccess;
+}
+
+/* Upload and factor the row-major A; the column-major factors are left
+   in *dA and the interchanges in *dipiv. Called with gpu_lock held. */
+static int gpu_factor(gpu_staging *S, int n, const double *A, double **dA,
+		      int **dipiv, int *info)
+{
+  const size_t nn = (size_t)n * n;
+  double *dT = NULL, *work = NULL;
+  int *dinfo = NULL, lwork = 0;
+  *dA = NULL;
+  *dipiv = NULL;
+  GPU_TRY(cudaMalloc((void **)&dT, nn * sizeof(double)));
+  GPU_TRY(cudaMalloc((void **)dA, nn * sizeof(double)));
+  GPU_TRY(cudaMalloc((void **)dipiv, n * sizeof(int)));
+  GPU_TRY(cudaMalloc((void **)&dinfo, sizeof(int)));
+  GPU_TRY(gpu_upload(S, dT, A, nn));
+  GPU_TRY(gpu_transpose(n, n, dT, *dA));
+  GPU_TRY(cusolverDnDgetrf_bufferSize(solver, n, n, *dA, n, &lwork));
+  GPU_TRY(cudaMalloc((void **)&work, (lwork + 1) * sizeof(double)));
+  GPU_TRY(cusolverDnDgetrf(solver, n, n, *dA, n, work, *dipiv, dinfo));
+  GPU_TRY(cudaMemcpyAsync(info, dinfo, sizeof(int), cudaMemcpyDeviceToHost,
+			  stream));
+  GPU_TRY(cudaStreamSynchronize(stream));
+  cudaFree(dT);
+  cudaFree(work);
+  cudaFree(dinfo);
+  return 0;
+
+ fail:
+  cudaFree(dT);
+  cudaFree(work);
+  cudaFree(dinfo);
+  cudaFree(*dA);
+  cudaFree(*dipiv);
+  *dA = NULL;
+  *dipiv = NULL;
+  return -1;
+}
+
+/* The packed row-major L\U and P of the column-major factors. LU is
+   written only once every copy has succeeded, so that on failure it
+   still holds the matrix. */
+static int gpu_download(gpu_staging *S, int n, const double *dA,
+			const int *dipiv, double *LU, int *P)
+{
+  const size_t nn = (size_t)n * n;
+  double *dT = NULL;
+  int *ipiv = malloc((n + 1) * sizeof(int));
+  GPU_TRY(ipiv == NULL);
+  GPU_TRY(cudaMalloc((void **)&dT, nn * sizeof(double)));
+  GPU_TRY(gpu_transpose(n, n, dA, dT));
+  GPU_TRY(gpu_download_async(S, dT, nn));
+  GPU_TRY(cudaMemcpyAsync(ipiv, dipiv, n * sizeof(int),
+			  cudaMemcpyDeviceToHost, stream));
+  GPU_TRY(cudaStreamSynchronize(stream));
+  memcpy(LU, S->buf, nn * sizeof(double));
+  ipiv_to_perm(n, ipiv, P);
+  cudaFree(dT);
+  free(ipiv);
+  return 0;
+
+ fail:
+  cudaFree(dT);
+  free(ipiv);
+  return -1;
+}
+
+static int gpu_plu(int n, double A[n][n], int P[n], int *info)
+{
+  double *dA;
+  int *dipiv;
+  pthread_mutex_lock(&gpu_lock);
+  int err = gpu_factor(&staging, n, &A[0][0], &dA, &dipiv, info);
+  if(!err) {
+    err = gpu_download(&staging, n, dA, dipiv, &A[0][0], P);
+    cudaFree(dA);
+    cudaFree(dipiv);
+  }
+  pthread_mutex_unlock(&gpu_lock);
+  return err;
+}
+
+static int gpu_plu_batched(int batch, int n, double *A, int *P)
+{
+  const size_t total = (size_t)batch * n * n;
+  const int ld = batch * n;
+  double *dT = NULL, *dA = NULL, **dptr = NULL;
+  double **ptr = malloc(batch * sizeof(double *));
+  int *dipiv = NULL, *dinfo = NULL;
+  int *ipiv = malloc((size_t)batch * n * sizeof(int));
+  int err = -1;
+  pthread_mutex_lock(&gpu_lock);
+  GPU_TRY(ptr == NULL || ipiv == NULL);
+  GPU_TRY(cudaMalloc((void **)&dT, total * sizeof(double)));
+  GPU_TRY(cudaMalloc((void **)&dA, total * sizeof(double)));
+  GPU_TRY(cudaMalloc((void **)&dptr, batch * sizeof(double *)));
+  GPU_TRY(cudaMalloc((void **)&dipiv, (size_t)batch * n * sizeof(int)));
+  GPU_TRY(cudaMalloc((void **)&dinfo, batch * sizeof(int)));
+  GPU_TRY(gpu_upload(&staging, dT, A, total));
+  GPU_TRY(gpu_transpose(n, ld, dT, dA));
+  for(int s = 0; s < batch; ++s) {
+    ptr[s] = dA + (size_t)s * n;
+  }
+  GPU_TRY(cudaMemcpy(dptr, ptr, batch * sizeof(double *),
+		     cudaMemcpyHostToDevice));
+  GPU_TRY(cublasDgetrfBatched(blas, n, dptr, ld, dipiv, dinfo, batch));
+  GPU_TRY(gpu_transpose(ld, n, dA, dT));
+  GPU_TRY(gpu_download_async(&staging, dT, total));
+  GPU_TRY(cudaMemcpyAsync(ipiv, dipiv, (size_t)batch * n * sizeof(int),
+			  cudaMemcpyDeviceToHost, stream));
+  GPU_TRY(cudaStreamSynchronize(stream));
+  /* A is overwritten only now, so that the CPU fallback gets it. */
+  memcpy(A, staging.buf, total * sizeof(double));
+  for(int s = 0; s < batch; ++s) {
+    ipiv_to_perm(n, ipiv + (size_t)s * n, P + (size_t)s * n);
+  }
+  err = 0;
+
+ fail:
+  pthread_mutex_unlock(&gpu_lock);
+  cudaFree(dT);
+  cudaFree(dA);
+  cudaFree(dptr);
+  cudaFree(dipiv);
+  cudaFree(dinfo);
+  free(ptr);
+  free(ipiv);
+  return err;
+}
+
+/* Number of matrices of the batch with a zero on the diagonal of U,
+   as cublasDgetrfBatched leaves it. */
+static int count_singular(int batch, int n, double A[batch][n][n])
+{
+  int count = 0;
+  for(int s = 0; s < batch; ++s) {
+    for(int k = 0; k < n; ++k) {
+      if(A[s][k][k] == 0) {
+	++count;
+	break;
+      }
+    }
+  }
+  return count;
+}
+
+/* B (row-major n x nrhs) := A^{-1} B with the resident factors. */
+static int gpu_solve(gauss_lu *F, int nrhs, double *B)
+{
+  const int n = F->n;
+  const size_t nb = (size_t)n * nrhs;
+  double *dT = NULL, *dB = NULL;
+  int *dinfo = NULL, err = -1;
+  pthread_mutex_lock(&gpu_lock);
+  GPU_TRY(cudaMalloc((void **)&dT, nb * sizeof(double)));
+  GPU_TRY(cudaMalloc((void **)&dB, nb * sizeof(double)));
+  GPU_TRY(cudaMalloc((void **)&dinfo, sizeof(int)));
+  GPU_TRY(gpu_upload(&F->staging, dT, B, nb));
+  GPU_TRY(gpu_transpose(nrhs, n, dT, dB));
+  GPU_TRY(cusolverDnDgetrs(solver, CUBLAS_OP_N, n, nrhs, F->dA, n, F->dipiv,
+			   dB, n, dinfo));
+  GPU_TRY(gpu_transpose(n, nrhs, dB, dT));
+  GPU_TRY(gpu_download_async(&F->staging, dT, nb));
+  GPU_TRY(cudaStreamSynchronize(stream));
+  memcpy(B, F->staging.buf, nb * sizeof(double));
+  err = 0;
+
+ fail:
+  pthread_mutex_unlock(&gpu_lock);
+  cudaFree(dT);
+  cudaFree(dB);
+  cudaFree(dinfo);
+  return err;
+}
+
+#else
+
+int gauss_gpu_available(void)
+{
+  return 0;
+}
+
+#endif
+
+int gauss_plu_auto(int n, double A[n][n], int P[n], int *backend)
+{
+#ifdef GAUSS_CUDA
+  int info;
+  if(use_gpu_n(n) && gpu_plu(n, A, P, &info) == 0) {
+    if(backend) {
+      *backend = GAUSS_BACKEND_GPU;
+    }
+    return info;
+  }
+#endif
+  if(backend) {
+    *backend = GAUSS_BACKEND_CPU;
+  }
+  return plu_recursive(n, A, P);
+}
+
+int gauss_plu_batched_auto(int batch, int n, double A[batch][n][n],
+			   int P[batch][n], int *backend)
+{
+#ifdef GAUSS_CUDA
+  if(use_gpu_batch(batch) && gpu_plu_batched(batch, n, &A[0][0][0],
+					     &P[0][0]) == 0) {
+    if(backend) {
+      *backend = GAUSS_BACKEND_GPU;
+    }
+    return count_singular(batch, n, A);
+  }
+#endif
+  if(backend) {
+    *backend = GAUSS_BACKEND_CPU;
+  }
+  return plu_batched(batch, n, A, P, NULL);
+}
+
+gauss_lu *gauss_lu_factor(int n, const double A[n][n], int *info)
+{
+  gauss_lu *F = calloc(1, sizeof(*F));
+  if(!F) {
+    return NULL;
+  }
+  F->n = n;
+#ifdef GAUSS_CUDA
+  if(use_gpu_n(n)) {
+    pthread_mutex_lock(&gpu_lock);
+    const int err = gpu_factor(&F->staging, n, &A[0][0], &F->dA, &F->dipiv,
+			       info);
+    pthread_mutex_unlock(&gpu_lock);
+    if(!err) {
+      F->backend = GAUSS_BACKEND_GPU;
+      return F;
+    }
+  }
+#endif
+  F->backend = GAUSS_BACKEND_CPU;
+  F->LU = malloc(((size_t)n * n + 1) * sizeof(double));
+  F->P = malloc((n + 1) * sizeof(int));
+  if(!F->LU || !F->P) {
+    gauss_lu_free(F);
+    return NULL;
+  }
+  memcpy(F->LU, A, sizeof(double[n][n]));
+  *info = plu_recursive(n, (double (*)[n])F->LU, F->P);
+  return F;
+}
+
+int gauss_lu_solve(gauss_lu *F, int nrhs, double B[][nrhs])
+{
+  const int n = F->n;
+#ifdef GAUSS_CUDA
+  if(F->backend == GAUSS_BACKEND_GPU) {
+    return gpu_solve(F, nrhs, &B[0][0]);
+  }
+#endif
+  plu_solve(n, (const double (*)[n])F->LU, F->P, nrhs, B);
+  return 0;
+}
+
+int gauss_lu_backend(const gauss_lu *F)
+{
+  return F->backend;
+}
+
+void gauss_lu_free(gauss_lu *F)
+{
+  if(F) {
+#ifdef GAUSS_CUDA
+    cudaFree(F->dA);
+    cudaFree(F->dipiv);
+    cudaFreeHost(F->staging.buf);
+#endif
+    free(F->LU);
+    free(F->P);
+    free(F);
+  }
+}
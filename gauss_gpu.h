@@ -0,0 +1,52 @@
+/*----------------------------------------------------------------
+* File:     gauss_gpu.h
+*----------------------------------------------------------------*/
+
+#ifndef GAUSS_GPU_H
+#define GAUSS_GPU_H
+
+/* Optional GPU backend. Built with -DGAUSS_CUDA (make CUDA=1), large
+   problems are factored and solved with cuSOLVER and cuBLAS on the
+   first CUDA device. Otherwise, or when no device is present, every
+   function below runs on the CPU with the same results as plu and
+   plu_solve, so callers need no #ifdef. */
+
+#define GAUSS_BACKEND_CPU 0
+#define GAUSS_BACKEND_GPU 1
+
+/* Sizes from which the GPU is used: n for a single matrix, the number
+   of matrices for a batch. The GAUSS_GPU_MIN_N and
+   GAUSS_GPU_MIN_BATCH environment variables override them. */
+#define GPU_DEFAULT_MIN_N     8192
+#define GPU_DEFAULT_MIN_BATCH 1024
+
+/* Whether the library was built with the GPU backend and a device was
+   found (checked once). */
+int  gauss_gpu_available(void);
+/* Thresholds; a value <= 0 restores the default. */
+void gauss_gpu_set_thresholds(int min_n, int min_batch);
+
+/* plu and plu_batched, run on the GPU when it is available and the
+   problem is at least the threshold, and on the CPU otherwise, or if
+   the GPU fails. *backend (if not NULL) receives the backend that
+   produced the result. Returns the status of plu; for the batch, the
+   number of singular matrices. */
+int gauss_plu_auto(int n, double A[n][n], int P[n], int *backend);
+int gauss_plu_batched_auto(int batch, int n, double A[batch][n][n],
+			   int P[batch][n], int *backend);
+
+/* A factorization kept where it was computed: on the GPU the factors
+   stay in device memory, so repeated solves upload only the
+   right-hand sides, through pinned buffers. */
+typedef struct gauss_lu gauss_lu;
+
+/* Factor A (not modified). *info receives the status of plu. Returns
+   NULL if out of memory. */
+gauss_lu *gauss_lu_factor(int n, const double A[n][n], int *info);
+/* Solve A X = B for the n x nrhs matrix B, overwritten with X.
+   Returns 0, or -1 on an allocation or device error. */
+int       gauss_lu_solve(gauss_lu *F, int nrhs, double B[][nrhs]);
+int       gauss_lu_backend(const gauss_lu *F);
+void      gauss_lu_free(gauss_lu *F);
+
+#endif
@@ -0,0 +1,176 @@
+/*----------------------------------------------------------------
+* File:     gauss_instrument.c
+*----------------------------------------------------------------*/
+/* Each instrumented call accumulates into a frame on its own stack,
+   and merges it into the process totals once, under a lock, at the
+   end. The perf_event counters are opened once per thread, on its
+   first instrumented call, as one group so that they are read
+   together, and closed by a thread-specific data destructor when the
+   thread exits. */
+
+#define _GNU_SOURCE
+
+#include <string.h>
+
+#include "gauss_instrument.h"
+
+#ifdef GAUSS_INSTRUMENT
+
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+static gauss_stats totals;
+static pthread_mutex_t totals_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Group leader and members; -2 before the first attempt, -1 if the
+   counters are not available to this thread. */
+static __thread int perf_fd[3] = { -2, -2, -2 };
+
+double gauss_instr_now(void)
+{
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + 1e-9 * t.tv_nsec;
+}
+
+#ifdef __linux__
+static int perf_open(unsigned type, unsigned long long config, int group)
+{
+  struct perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = type;
+  attr.config = config;
+  attr.disabled = group < 0;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format = PERF_FORMAT_GROUP;
+  return syscall(SYS_perf_event_open, &attr, 0, -1, group, 0);
+}
+
+static void perf_close(int fd[3])
+{
+  for(int i = 0; i < 3; ++i) {
+    if(fd[i] >= 0) {
+      close(fd[i]);
+    }
+    fd[i] = -1;
+  }
+}
+
+static pthread_key_t perf_key;
+static pthread_once_t perf_key_once = PTHREAD_ONCE_INIT;
+static int perf_key_ok;
+
+static void perf_destroy(void *fd)
+{
+  perf_close(fd);
+}
+
+static void perf_key_create(void)
+{
+  perf_key_ok = pthread_key_create(&perf_key, perf_destroy) == 0;
+}
+
+static void perf_init(void)
+{
+  /* Without the key the fds could not be closed at thread exit */
+  pthread_once(&perf_key_once, perf_key_create);
+  if(!perf_key_ok || pthread_setspecific(perf_key, perf_fd) != 0) {
+    perf_fd[0] = perf_fd[1] = perf_fd[2] = -1;
+    return;
+  }
+  perf_fd[0] = perf_open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, -1);
+  perf_fd[1] = perf_fd[0] < 0 ? -1
+    : perf_open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, perf_fd[0]);
+  perf_fd[2] = perf_fd[1] < 0 ? -1
+    : perf_open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES, perf_fd[0]);
+  if(perf_fd[2] < 0) {
+    perf_close(perf_fd);
+    return;
+  }
+  ioctl(perf_fd[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+static int perf_read(long long c[3])
+{
+  if(perf_fd[0] == -2) {
+    perf_init();
+  }
+  unsigned long long buf[4];
+  if(perf_fd[0] < 0 || read(perf_fd[0], buf, sizeof(buf)) != sizeof(buf)) {
+    return 0;
+  }
+  for(int i = 0; i < 3; ++i) {
+    c[i] = buf[i + 1];
+  }
+  return 1;
+}
+#else
+static int perf_read(long long c[3])
+{
+  (void)c;
+  return 0;
+}
+#endif
+
+void gauss_instr_begin(gauss_instr_frame *f)
+{
+  memset(f, 0, sizeof(*f));
+  perf_read(f->counters);
+  f->t = gauss_instr_now();
+}
+
+void gauss_instr_end(gauss_instr_frame *f)
+{
+  long long c[3];
+  const int have = perf_read(c);
+  pthread_mutex_lock(&totals_lock);
+  totals.calls++;
+  for(int p = 0; p < GAUSS_NPHASES; ++p) {
+    totals.seconds[p] += f->seconds[p];
+  }
+  totals.flops += f->flops;
+  if(have) {
+    totals.have_counters = 1;
+    totals.cycles += c[0] - f->counters[0];
+    totals.instructions += c[1] - f->counters[1];
+    totals.llc_misses += c[2] - f->counters[2];
+  }
+  pthread_mutex_unlock(&totals_lock);
+}
+
+int gauss_stats_get(gauss_stats *stats)
+{
+  pthread_mutex_lock(&totals_lock);
+  *stats = totals;
+  pthread_mutex_unlock(&totals_lock);
+  return 0;
+}
+
+void gauss_stats_reset(void)
+{
+  pthread_mutex_lock(&totals_lock);
+  memset(&totals, 0, sizeof(totals));
+  pthread_mutex_unlock(&totals_lock);
+}
+
+#else
+
+int gauss_stats_get(gauss_stats *stats)
+{
+  memset(stats, 0, sizeof(*stats));
+  return -1;
+}
+
+void gauss_stats_reset(void)
+{
+}
+
+#endif
@@ -0,0 +1,78 @@
+/*----------------------------------------------------------------
+* File:     gauss_instrument.h
+*----------------------------------------------------------------*/
+
+#ifndef GAUSS_INSTRUMENT_H
+#define GAUSS_INSTRUMENT_H
+
+/* Optional instrumentation of plu, lu_in_place, gauss_solve_in_place
+   and plu_solve (and their _lda variants), enabled by building with
+   -DGAUSS_INSTRUMENT (make INSTRUMENT=1). Each call records the time
+   spent in each phase and the floating-point operations it performs,
+   and, where the kernel allows perf_event_open, hardware counters for
+   the calling thread (the threads of an OpenMP region are not
+   counted). The small sizes handled by the unrolled kernels are not
+   instrumented. Without GAUSS_INSTRUMENT the macros below expand to
+   nothing. */
+
+enum {
+  GAUSS_PHASE_PIVOT,		/* Pivot search */
+  GAUSS_PHASE_SWAP,		/* Row interchanges */
+  GAUSS_PHASE_UPDATE,		/* Elimination and trailing updates */
+  GAUSS_PHASE_SOLVE,		/* Forward and back substitution */
+  GAUSS_NPHASES
+};
+
+typedef struct {
+  long long calls;		/* Instrumented calls */
+  double seconds[GAUSS_NPHASES];
+  double flops;			/* Counted, not measured */
+  int have_counters;		/* Whether the three below were measured */
+  long long cycles, instructions, llc_misses;
+} gauss_stats;
+
+/* Totals over all threads since the last reset. Returns 0, or -1 (and
+   zeros) if the library was built without GAUSS_INSTRUMENT. */
+int  gauss_stats_get(gauss_stats *stats);
+void gauss_stats_reset(void);
+
+#ifdef GAUSS_INSTRUMENT
+
+typedef struct {
+  double t;			/* Time of the last mark */
+  double seconds[GAUSS_NPHASES];
+  double flops;
+  long long counters[3];
+} gauss_instr_frame;
+
+void   gauss_instr_begin(gauss_instr_frame *f);
+void   gauss_instr_end(gauss_instr_frame *f);
+double gauss_instr_now(void);
+
+/* In an instrumented function: BEGIN once at the top (it declares the
+   frame), MARK to start timing, PHASE(ph) to charge the time since the
+   last mark or phase to ph, FLOPS(x) to count x operations, and END
+   before returning. */
+#define GAUSS_INSTR_BEGIN()					\
+  gauss_instr_frame gauss_frame_;				\
+  gauss_instr_begin(&gauss_frame_)
+#define GAUSS_INSTR_MARK() (gauss_frame_.t = gauss_instr_now())
+#define GAUSS_INSTR_PHASE(ph) do {				\
+    const double gauss_t_ = gauss_instr_now();			\
+    gauss_frame_.seconds[ph] += gauss_t_ - gauss_frame_.t;	\
+    gauss_frame_.t = gauss_t_;					\
+  } while(0)
+#define GAUSS_INSTR_FLOPS(x) (gauss_frame_.flops += (x))
+#define GAUSS_INSTR_END() gauss_instr_end(&gauss_frame_)
+
+#else
+
+#define GAUSS_INSTR_BEGIN()
+#define GAUSS_INSTR_MARK()
+#define GAUSS_INSTR_PHASE(ph)
+#define GAUSS_INSTR_FLOPS(x)
+#define GAUSS_INSTR_END()
+
+#endif
+
+#endif
@@ -0,0 +1,324 @@
+/*----------------------------------------------------------------
+* File:     gauss_inverse.c
+*----------------------------------------------------------------*/
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "gauss_solve.h"
+#include "gauss_kernels.h"
+#include "gauss_inverse.h"
+
+#define INVERSE_DEFAULT_NB 64
+/* Column strips of the inversion of U, one per thread at a time. */
+#define INVERSE_JB 256
+
+/* Maximum number of iterations of the 1-norm estimator (ITMAX of
+   dlacn2). */
+#define NORM1_ITMAX 5
+
+/* The sign of P: -1 if it has an odd number of even-length cycles.
+   Each cycle is counted from its smallest element, which takes
+   O(n^2) steps at worst but no memory. */
+static int perm_sign(int n, const int P[])
+{
+  if(!P) {
+    return 1;
+  }
+  int sign = 1;
+  for(int s = 0; s < n; ++s) {
+    int len = 1, i = P[s];
+    while(i > s) {
+      i = P[i];
+      ++len;
+    }
+    if(i == s && len % 2 == 0) {
+      sign = -sign;
+    }
+  }
+  return sign;
+}
+
+/* k+1 for the first zero on the diagonal of U, or 0. */
+static int zero_pivot(int n, const double LU[n][n])
+{
+  for(int k = 0; k < n; ++k) {
+    if(LU[k][k] == 0) {
+      return k + 1;
+    }
+  }
+  return 0;
+}
+
+double plu_det(int n, const double LU[n][n], const int P[])
+{
+  if(zero_pivot(n, LU)) {
+    return 0;
+  }
+  double det = perm_sign(n, P);
+  for(int k = 0; k < n; ++k) {
+    det *= LU[k][k];
+  }
+  return det;
+}
+
+double plu_logdet(int n, const double LU[n][n], const int P[], int *sign)
+{
+  double logdet = 0;
+  *sign = perm_sign(n, P);
+  for(int k = 0; k < n; ++k) {
+    if(LU[k][k] == 0) {
+      *sign = 0;
+      return -HUGE_VAL;
+    }
+    if(LU[k][k] < 0) {
+      *sign = -*sign;
+    }
+    logdet += log(fabs(LU[k][k]));
+  }
+  return logdet;
+}
+
+/* U := U^{-1}, from the last row up: row j of the inverse is
+   -U[j][j+1..] X / U[j][j] over the rows X of the inverse below it,
+   formed in t as a combination of those rows. */
+static void invert_upper(int n, double A[n][n], double t[], int nt)
+{
+  (void)nt;
+  for(int j = n - 1; j >= 0; --j) {
+    const double d = 1 / A[j][j];
+#pragma omp parallel for schedule(static) num_threads(nt) \
+  if(nt > 1 && (size_t)(n - j) * (n - j) > PARALLEL_MIN_WORK)
+    for(int s0 = j + 1; s0 < n; s0 += INVERSE_JB) {
+      const int s1 = s0 + INVERSE_JB < n ? s0 + INVERSE_JB : n;
+      memset(&t[s0], 0, (s1 - s0) * sizeof(double));
+      for(int m = j + 1; m < s1; ++m) {
+	const int c = m > s0 ? m : s0;
+	kernel_axpy(s1 - c, A[j][m], &A[m][c], &t[c]);
+      }
+    }
+    A[j][j] = d;
+    for(int k = j + 1; k < n; ++k) {
+      A[j][k] = -d * t[k];
+    }
+  }
+}
+
+int plu_inverse(int n, double LU[n][n], const int P[], int nb)
+{
+  const int info = zero_pivot(n, (const double (*)[n])LU);
+  if(info) {
+    return info;
+  }
+  if(nb <= 0) {
+    nb = INVERSE_DEFAULT_NB;
+  }
+  const int nt = gauss_get_num_threads();
+  double *t = malloc((n + 1) * sizeof(double));
+  double (*W)[nb] = malloc(((size_t)n * nb + 1) * sizeof(double));
+  if(!t || !W) {
+    free(t);
+    free(W);
+    return -1;
+  }
+  invert_upper(n, LU, t, nt);
+
+  /* X L = U^{-1}, solved for X by blocks of columns from the right:
+     the block of L is moved to W, the columns to its right (already
+     X) are subtracted, and the unit lower triangle of the block is
+     solved. */
+  for(int jb = (n - 1) / nb * nb; jb >= 0; jb -= nb) {
+    const int kb = jb + nb < n ? nb : n - jb, je = jb + kb;
+    for(int i = jb; i < n; ++i) {
+      for(int c = 0; c < kb; ++c) {
+	if(i > jb + c) {
+	  W[i][c] = LU[i][jb + c];
+	  LU[i][jb + c] = 0;
+	} else {
+	  W[i][c] = 0;
+	}
+      }
+    }
+#pragma omp parallel for schedule(static) num_threads(nt) \
+  if(nt > 1 && (size_t)n * (n - jb) > PARALLEL_MIN_WORK)
+    for(int r = 0; r < n; ++r) {
+      for(int i = je; i < n; ++i) {
+	kernel_axpy(kb, -LU[r][i], W[i], &LU[r][jb]);
+      }
+      for(int c = kb - 2; c >= 0; --c) {
+	double s = 0;
+	for(int q = c + 1; q < kb; ++q) {
+	  s += LU[r][jb + q] * W[jb + q][c];
+	}
+	LU[r][jb + c] -= s;
+      }
+    }
+  }
+
+  /* A^{-1} = X P: column i of X is column P[i] of the inverse. */
+  if(P) {
+    for(int r = 0; r < n; ++r) {
+      for(int i = 0; i < n; ++i) {
+	t[P[i]] = LU[r][i];
+      }
+      memcpy(LU[r], t, n * sizeof(double));
+    }
+  }
+  free(t);
+  free(W);
+  return 0;
+}
+
+double gauss_norm1(int n, const double A[n][n])
+{
+  double *s = calloc(n + 1, sizeof(double)), norm = 0;
+  if(!s) {
+    return -1;
+  }
+  for(int i = 0; i < n; ++i) {
+    for(int j = 0; j < n; ++j) {
+      s[j] += fabs(A[i][j]);
+    }
+  }
+  for(int j = 0; j < n; ++j) {
+    norm = s[j] > norm ? s[j] : norm;
+  }
+  free(s);
+  return norm;
+}
+
+/* x := A^{-T} x = P^T L^{-T} U^{-T} x, with the rows of U and L
+   traversed contiguously. */
+static void solve_transposed(int n, const double LU[n][n], const int P[],
+			     double x[], double t[])
+{
+  for(int k = 0; k < n; ++k) {
+    x[k] /= LU[k][k];
+    kernel_axpy(n - k - 1, -x[k], &LU[k][k + 1], &x[k + 1]);
+  }
+  for(int k = n - 1; k > 0; --k) {
+    kernel_axpy(k, -x[k], LU[k], x);
+  }
+  if(P) {
+    for(int i = 0; i < n; ++i) {
+      t[P[i]] = x[i];
+    }
+    memcpy(x, t, n * sizeof(double));
+  }
+}
+
+static void solve(int n, const double LU[n][n], const int P[], double x[])
+{
+  plu_solve(n, LU, P, 1, (double (*)[1])x);
+}
+
+static double norm1(int n, const double x[])
+{
+  double s = 0;
+  for(int i = 0; i < n; ++i) {
+    s += fabs(x[i]);
+  }
+  return s;
+}
+
+/* First index of the entry of largest magnitude. */
+static int argmax_abs(int n, const double x[])
+{
+  int j = 0;
+  for(int i = 1; i < n; ++i) {
+    if(fabs(x[i]) > fabs(x[j])) {
+      j = i;
+    }
+  }
+  return j;
+}
+
+/* x := sign(v), with sign(0) = 1; returns whether it was already so. */
+static int set_signs(int n, const double v[], double x[])
+{
+  int same = 1;
+  for(int i = 0; i < n; ++i) {
+    const double s = v[i] >= 0 ? 1 : -1;
+    same = same && x[i] == s;
+    x[i] = s;
+  }
+  return same;
+}
+
+double plu_inv_norm1_est(int n, const double LU[n][n], const int P[])
+{
+  if(n <= 0) {
+    return 0;
+  }
+  if(zero_pivot(n, LU)) {
+    return HUGE_VAL;
+  }
+  double *v = malloc(n * sizeof(double)), *x = malloc(n * sizeof(double));
+  double *xi = malloc(n * sizeof(double)), *t = malloc(n * sizeof(double));
+  if(!v || !x || !xi || !t) {
+    free(v);
+    free(x);
+    free(xi);
+    free(t);
+    return -1;
+  }
+
+  for(int i = 0; i < n; ++i) {
+    v[i] = 1.0 / n;
+  }
+  solve(n, LU, P, v);
+  double est = norm1(n, v);
+  if(n > 1) {
+    for(int i = 0; i < n; ++i) {
+      xi[i] = 0;
+    }
+    set_signs(n, v, xi);
+    memcpy(x, xi, n * sizeof(double));
+    solve_transposed(n, LU, P, x, t);
+    int j = argmax_abs(n, x);
+    for(int iter = 2; ; ++iter) {
+      /* v = A^{-1} e_j, the column of A^{-1} that looks largest */
+      memset(v, 0, n * sizeof(double));
+      v[j] = 1;
+      solve(n, LU, P, v);
+      const double est_old = est;
+      est = norm1(n, v);
+      if(set_signs(n, v, xi) || est <= est_old) {
+	est = est > est_old ? est : est_old;
+	break;
+      }
+      memcpy(x, xi, n * sizeof(double));
+      solve_transposed(n, LU, P, x, t);
+      const int j_last = j;
+      j = argmax_abs(n, x);
+      if(x[j_last] == fabs(x[j]) || iter >= NORM1_ITMAX) {
+	break;
+      }
+    }
+
+    /* The alternating vector catches the cases where the iteration
+       above is misled. */
+    for(int i = 0; i < n; ++i) {
+      x[i] = (i % 2 ? -1 : 1) * (1 + (double)i / (n - 1));
+    }
+    solve(n, LU, P, x);
+    const double alt = 2 * norm1(n, x) / (3.0 * n);
+    est = alt > est ? alt : est;
+  }
+  free(v);
+  free(x);
+  free(xi);
+  free(t);
+  return est;
+}
+
+double plu_cond1_est(int n, const double LU[n][n], const int P[],
+		     double anorm)
+{
+  const double est = plu_inv_norm1_est(n, LU, P);
+  return est < 0 ? est : anorm * est;
+}
@@ -0,0 +1,41 @@
+/*----------------------------------------------------------------
+* File:     gauss_inverse.h
+*----------------------------------------------------------------*/
+
+#ifndef GAUSS_INVERSE_H
+#define GAUSS_INVERSE_H
+
+/* Quantities computed from a factorization already at hand: the packed
+   L\U of plu with its P, or of lu_in_place with P == NULL, as for
+   plu_solve. None of them refactors or copies A. */
+
+/* det(A): the product of the diagonal of U, with the sign of P (the
+   parity of its cycles). plu_logdet returns log|det(A)| instead,
+   which does not overflow, and the sign (-1, 0 or 1) in *sign; for a
+   singular U it returns -HUGE_VAL with *sign = 0. */
+double plu_det(int n, const double LU[n][n], const int P[]);
+double plu_logdet(int n, const double LU[n][n], const int P[], int *sign);
+
+/* Overwrite the factors with A^{-1} = U^{-1} L^{-1} P, as getri does:
+   U is inverted in place, then L^{-1} is applied from the right one
+   block of nb columns at a time (nb <= 0 selects a default), with one
+   n x nb block of L as the only scratch. Returns 0, k+1 if U[k][k] is
+   exactly zero (the factors are then left unchanged), or -1 if out of
+   memory. */
+int plu_inverse(int n, double LU[n][n], const int P[], int nb);
+
+/* The 1-norm of A, the largest column sum of |a_ij|; needed with the
+   estimate below, and computed before A is factored. */
+double gauss_norm1(int n, const double A[n][n]);
+
+/* An estimate of ||A^{-1}||_1 from the factors by the method of Hager
+   as refined by Higham (LAPACK's dlacn2): a few solves with A and A^T,
+   O(n^2) each, usually exact and never larger than the true value.
+   Returns -1 if out of memory, and HUGE_VAL if U is singular.
+   plu_cond1_est multiplies it by anorm = gauss_norm1(A) to estimate
+   the condition number kappa_1(A). */
+double plu_inv_norm1_est(int n, const double LU[n][n], const int P[]);
+double plu_cond1_est(int n, const double LU[n][n], const int P[],
+		     double anorm);
+
+#endif
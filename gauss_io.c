@@ -0,0 +1,208 @@
+/*----------------------------------------------------------------
+* File:     gauss_io.c
+*----------------------------------------------------------------*/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "gauss_io.h"
+
+#define BYTE_ORDER_MARK 0x01020304u
+
+/* The header must stay exactly 64 bytes, and P is written as it is. */
+typedef char gauss_io_header_size[sizeof(gauss_io_header) == GAUSS_IO_ALIGN
+				  ? 1 : -1];
+typedef char gauss_io_int_size[sizeof(int) == sizeof(int32_t) ? 1 : -1];
+
+static uint64_t align_up(uint64_t x)
+{
+  return (x + GAUSS_IO_ALIGN - 1) & ~(uint64_t)(GAUSS_IO_ALIGN - 1);
+}
+
+/* The doubles from the first element to the last element of an m x n
+   matrix with leading dimension lda; the padding after the last row
+   need not exist, for example in a view of a larger matrix. */
+static uint64_t data_elems(uint64_t m, uint64_t n, uint64_t lda)
+{
+  return m ? (m - 1) * lda + n : 0;
+}
+
+static int write_padding(FILE *f, uint64_t to)
+{
+  static const char zeros[GAUSS_IO_ALIGN];
+  const long at = ftell(f);
+  return at < 0 || fwrite(zeros, 1, to - at, f) != to - at ? -1 : 0;
+}
+
+int gauss_matrix_store(const char *path, int kind, int m, int n, int lda,
+		       const double A[][lda], const int P[])
+{
+  if(kind < GAUSS_IO_MATRIX || kind > GAUSS_IO_PLU
+     || m < 0 || n < 0 || lda < n || (kind == GAUSS_IO_PLU && !P)) {
+    errno = EINVAL;
+    return -1;
+  }
+  gauss_io_header h;
+  memset(&h, 0, sizeof(h));
+  memcpy(h.magic, GAUSS_IO_MAGIC, sizeof(h.magic));
+  h.byte_order = BYTE_ORDER_MARK;
+  h.version = GAUSS_IO_VERSION;
+  h.dtype = GAUSS_IO_FLOAT64;
+  h.kind = kind;
+  h.m = m;
+  h.n = n;
+  h.lda = lda;
+  h.data_offset = align_up(sizeof(h));
+  const size_t elems = data_elems(m, n, lda);
+  const uint64_t data_bytes = (uint64_t)elems * sizeof(double);
+  h.perm_offset = P ? align_up(h.data_offset + data_bytes) : 0;
+
+  /* A unique name in the same directory, so that concurrent stores do
+     not share it and the rename stays within one file system. */
+  char *tmp = malloc(strlen(path) + 8);
+  if(!tmp) {
+    return -1;
+  }
+  sprintf(tmp, "%s.XXXXXX", path);
+  const int fd = mkstemp(tmp);
+  if(fd < 0) {
+    free(tmp);
+    return -1;
+  }
+  FILE *f = fdopen(fd, "wb");
+  if(!f) {
+    const int e = errno;
+    close(fd);
+    remove(tmp);
+    free(tmp);
+    errno = e;
+    return -1;
+  }
+  int err = fchmod(fd, 0644) != 0
+    || fwrite(&h, sizeof(h), 1, f) != 1
+    || write_padding(f, h.data_offset)
+    || fwrite(A, sizeof(double), elems, f) != elems;
+  if(!err && P) {
+    err = write_padding(f, h.perm_offset)
+      || fwrite(P, sizeof(int32_t), m, f) != (size_t)m;
+  }
+  /* The data must be on disk before the rename makes it visible. */
+  if(!err) {
+    err = fflush(f) != 0 || fsync(fd) != 0;
+  }
+  if(fclose(f) != 0) {
+    err = 1;
+  }
+  if(!err && rename(tmp, path) != 0) {
+    err = 1;
+  }
+  if(err) {
+    const int e = errno;
+    remove(tmp);
+    errno = e;
+  }
+  free(tmp);
+  return err ? -1 : 0;
+}
+
+/* Whether size bytes at off lie within a file of the given size,
+   without wrapping around. */
+static int range_valid(uint64_t off, uint64_t size, uint64_t bytes)
+{
+  return off <= bytes && size <= bytes - off;
+}
+
+static int header_valid(const gauss_io_header *h, size_t bytes)
+{
+  if(memcmp(h->magic, GAUSS_IO_MAGIC, sizeof(h->magic)) != 0
+     || h->byte_order != BYTE_ORDER_MARK || h->version != GAUSS_IO_VERSION
+     || h->dtype != GAUSS_IO_FLOAT64 || h->kind > GAUSS_IO_PLU
+     || h->m < 0 || h->n < 0 || h->lda < h->n
+     || h->data_offset % GAUSS_IO_ALIGN || h->perm_offset % GAUSS_IO_ALIGN
+     || (h->kind == GAUSS_IO_PLU && h->perm_offset == 0)) {
+    return 0;
+  }
+  /* The count is below 2^62, but the size in bytes may not fit. */
+  const uint64_t elems = data_elems(h->m, h->n, h->lda);
+  if(elems > UINT64_MAX / sizeof(double)) {
+    return 0;
+  }
+  const uint64_t data_bytes = elems * sizeof(double);
+  if(h->data_offset < sizeof(*h)
+     || !range_valid(h->data_offset, data_bytes, bytes)) {
+    return 0;
+  }
+  return h->perm_offset == 0
+    || (h->perm_offset >= h->data_offset
+	&& h->perm_offset - h->data_offset >= data_bytes
+	&& range_valid(h->perm_offset,
+		       (uint64_t)h->m * sizeof(int32_t), bytes));
+}
+
+gauss_mapped *gauss_matrix_load(const char *path, int writable)
+{
+  const int fd = open(path, O_RDONLY);
+  if(fd < 0) {
+    return NULL;
+  }
+  struct stat st;
+  gauss_mapped *M = NULL;
+  void *base = MAP_FAILED;
+  if(fstat(fd, &st) != 0) {
+    goto out;
+  }
+  if((size_t)st.st_size < sizeof(gauss_io_header)) {
+    errno = EINVAL;
+    goto out;
+  }
+  base = mmap(NULL, st.st_size,
+	      writable ? PROT_READ | PROT_WRITE : PROT_READ,
+	      writable ? MAP_PRIVATE : MAP_SHARED, fd, 0);
+  if(base == MAP_FAILED) {
+    goto out;
+  }
+  const gauss_io_header *h = base;
+  if(!header_valid(h, st.st_size)) {
+    errno = EINVAL;
+    goto out;
+  }
+  M = malloc(sizeof(*M));
+  if(!M) {
+    goto out;
+  }
+  M->m = h->m;
+  M->n = h->n;
+  M->lda = h->lda;
+  M->kind = h->kind;
+  M->data = (double *)((char *)base + h->data_offset);
+  M->P = h->perm_offset ? (int32_t *)((char *)base + h->perm_offset) : NULL;
+  M->base = base;
+  M->bytes = st.st_size;
+
+ out:
+  {
+    const int e = errno;
+    if(!M && base != MAP_FAILED) {
+      munmap(base, st.st_size);
+    }
+    close(fd);
+    errno = e;
+  }
+  return M;
+}
+
+void gauss_matrix_unmap(gauss_mapped *M)
+{
+  if(M) {
+    munmap(M->base, M->bytes);
+    free(M);
+  }
+}
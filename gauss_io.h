@@ -0,0 +1,70 @@
+/*----------------------------------------------------------------
+* File:     gauss_io.h
+*----------------------------------------------------------------*/
+
+#ifndef GAUSS_IO_H
+#define GAUSS_IO_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Binary matrix files. A 64-byte header is followed by the matrix,
+   row-major with the leading dimension it was stored with (without
+   the padding after the last row), and then by the permutation if
+   there is one; both start on a 64-byte boundary. The numbers are in the byte order of the machine that
+   wrote the file, which the header records. Loading maps the file, so
+   the matrix is used where it lies, without parsing or copying. */
+
+#define GAUSS_IO_MAGIC   "GAUSSMAT"
+#define GAUSS_IO_VERSION 1
+#define GAUSS_IO_ALIGN   64
+
+/* dtype: the element type of the matrix. Only double for now. */
+#define GAUSS_IO_FLOAT64 1
+
+/* kind: what the matrix holds. */
+#define GAUSS_IO_MATRIX 0	/* A plain matrix */
+#define GAUSS_IO_LU     1	/* Packed L\U of lu_in_place */
+#define GAUSS_IO_PLU    2	/* Packed L\U of plu, with P */
+
+typedef struct {
+  char     magic[8];		/* GAUSS_IO_MAGIC, no terminator */
+  uint32_t byte_order;		/* 0x01020304 as written */
+  uint32_t version;
+  uint32_t dtype;
+  uint32_t kind;
+  int32_t  m, n, lda;
+  uint32_t reserved;
+  uint64_t data_offset;		/* (m-1) * lda + n doubles */
+  uint64_t perm_offset;		/* m int32, or 0 if there is no P */
+  uint8_t  pad[8];
+} gauss_io_header;
+
+/* A mapped matrix file: element (i,j) of the matrix is
+   data[i * lda + j]. */
+typedef struct {
+  int m, n, lda, kind;
+  double *data;
+  int32_t *P;			/* NULL if the file has no permutation */
+  void *base;
+  size_t bytes;
+} gauss_mapped;
+
+/* Write the m x n matrix A (leading dimension lda) to path, with the
+   permutation P (m entries) unless it is NULL; P is required for
+   GAUSS_IO_PLU, and kind must be one of the kinds above. The file is written under a unique temporary name in
+   the same directory, synced and renamed, so a reader never sees it
+   half written and concurrent stores do not collide; it gets mode
+   0644. Returns 0, or -1 with errno set. */
+int gauss_matrix_store(const char *path, int kind, int m, int n, int lda,
+		       const double A[][lda], const int P[]);
+
+/* Map the file at path. With writable = 0 the pages are read-only;
+   otherwise they are private copy-on-write pages, so the matrix can be
+   modified in place (for example factored) without changing the file.
+   Returns NULL, with errno set, if the file cannot be mapped or is not
+   a valid matrix file (EINVAL). */
+gauss_mapped *gauss_matrix_load(const char *path, int writable);
+void          gauss_matrix_unmap(gauss_mapped *M);
+
+#endif
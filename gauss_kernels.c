@@ -0,0 +1,262 @@
+/*----------------------------------------------------------------
+* File:     gauss_kernels.c
+*----------------------------------------------------------------*/
+/* Hand-vectorized AXPY, dot product and sum of squares, with a generic
+   C fallback. The vector versions are compiled with per-function
+   target attributes, so the library itself is built for the baseline
+   ISA and runs on any x86-64 machine. */
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "gauss_kernels.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define GAUSS_HAVE_X86 1
+#include <immintrin.h>
+#endif
+
+static void axpy_generic(int n, double alpha, const double *restrict x,
+			 double *restrict y)
+{
+  for(int j = 0; j < n; ++j) {
+    y[j] += alpha * x[j];
+  }
+}
+
+static double dot_generic(int n, const double *x, const double *y)
+{
+  double S = 0;
+  for(int j = 0; j < n; ++j) {
+    S += x[j] * y[j];
+  }
+  return S;
+}
+
+static double sumsq_generic(int n, const double *x)
+{
+  double S = 0;
+  for(int j = 0; j < n; ++j) {
+    S += x[j] * x[j];
+  }
+  return S;
+}
+
+static double dist2_generic(int n, const double *x, const double *y)
+{
+  double S = 0;
+  for(int j = 0; j < n; ++j) {
+    S += (x[j] - y[j]) * (x[j] - y[j]);
+  }
+  return S;
+}
+
+#ifdef GAUSS_HAVE_X86
+
+/* The scalar tails use fma() so that every element of y is updated
+   with a single rounding, whether it falls in the vector body or in
+   the tail. This keeps results independent of how a row is split
+   into segments by the blocked kernels. */
+
+__attribute__((target("avx2,fma")))
+static void axpy_avx2(int n, double alpha, const double *restrict x,
+		      double *restrict y)
+{
+  const __m256d a = _mm256_set1_pd(alpha);
+  int j = 0;
+  for(; j + 8 <= n; j += 8) {
+    __m256d y0 = _mm256_loadu_pd(y + j);
+    __m256d y1 = _mm256_loadu_pd(y + j + 4);
+    y0 = _mm256_fmadd_pd(a, _mm256_loadu_pd(x + j), y0);
+    y1 = _mm256_fmadd_pd(a, _mm256_loadu_pd(x + j + 4), y1);
+    _mm256_storeu_pd(y + j, y0);
+    _mm256_storeu_pd(y + j + 4, y1);
+  }
+  for(; j + 4 <= n; j += 4) {
+    __m256d y0 = _mm256_loadu_pd(y + j);
+    y0 = _mm256_fmadd_pd(a, _mm256_loadu_pd(x + j), y0);
+    _mm256_storeu_pd(y + j, y0);
+  }
+  for(; j < n; ++j) {
+    y[j] = fma(alpha, x[j], y[j]);
+  }
+}
+
+__attribute__((target("avx2,fma")))
+static double hsum_avx2(__m256d v)
+{
+  __m128d lo = _mm256_castpd256_pd128(v), hi = _mm256_extractf128_pd(v, 1);
+  lo = _mm_add_pd(lo, hi);
+  return _mm_cvtsd_f64(_mm_add_sd(lo, _mm_unpackhi_pd(lo, lo)));
+}
+
+__attribute__((target("avx2,fma")))
+static double dot_avx2(int n, const double *x, const double *y)
+{
+  __m256d s0 = _mm256_setzero_pd(), s1 = _mm256_setzero_pd();
+  __m256d s2 = _mm256_setzero_pd(), s3 = _mm256_setzero_pd();
+  int j = 0;
+  for(; j + 16 <= n; j += 16) {
+    s0 = _mm256_fmadd_pd(_mm256_loadu_pd(x + j), _mm256_loadu_pd(y + j), s0);
+    s1 = _mm256_fmadd_pd(_mm256_loadu_pd(x + j + 4),
+			 _mm256_loadu_pd(y + j + 4), s1);
+    s2 = _mm256_fmadd_pd(_mm256_loadu_pd(x + j + 8),
+			 _mm256_loadu_pd(y + j + 8), s2);
+    s3 = _mm256_fmadd_pd(_mm256_loadu_pd(x + j + 12),
+			 _mm256_loadu_pd(y + j + 12), s3);
+  }
+  for(; j + 4 <= n; j += 4) {
+    s0 = _mm256_fmadd_pd(_mm256_loadu_pd(x + j), _mm256_loadu_pd(y + j), s0);
+  }
+  double S = hsum_avx2(_mm256_add_pd(_mm256_add_pd(s0, s1),
+				     _mm256_add_pd(s2, s3)));
+  for(; j < n; ++j) {
+    S = fma(x[j], y[j], S);
+  }
+  return S;
+}
+
+__attribute__((target("avx2,fma")))
+static double sumsq_avx2(int n, const double *x)
+{
+  return dot_avx2(n, x, x);
+}
+
+__attribute__((target("avx2,fma")))
+static double dist2_avx2(int n, const double *x, const double *y)
+{
+  __m256d s0 = _mm256_setzero_pd(), s1 = _mm256_setzero_pd();
+  int j = 0;
+  for(; j + 8 <= n; j += 8) {
+    const __m256d d0 = _mm256_sub_pd(_mm256_loadu_pd(x + j),
+				     _mm256_loadu_pd(y + j));
+    const __m256d d1 = _mm256_sub_pd(_mm256_loadu_pd(x + j + 4),
+				     _mm256_loadu_pd(y + j + 4));
+    s0 = _mm256_fmadd_pd(d0, d0, s0);
+    s1 = _mm256_fmadd_pd(d1, d1, s1);
+  }
+  double S = hsum_avx2(_mm256_add_pd(s0, s1));
+  for(; j < n; ++j) {
+    S = fma(x[j] - y[j], x[j] - y[j], S);
+  }
+  return S;
+}
+
+__attribute__((target("avx512f")))
+static void axpy_avx512(int n, double alpha, const double *restrict x,
+			double *restrict y)
+{
+  const __m512d a = _mm512_set1_pd(alpha);
+  int j = 0;
+  for(; j + 16 <= n; j += 16) {
+    __m512d y0 = _mm512_loadu_pd(y + j);
+    __m512d y1 = _mm512_loadu_pd(y + j + 8);
+    y0 = _mm512_fmadd_pd(a, _mm512_loadu_pd(x + j), y0);
+    y1 = _mm512_fmadd_pd(a, _mm512_loadu_pd(x + j + 8), y1);
+    _mm512_storeu_pd(y + j, y0);
+    _mm512_storeu_pd(y + j + 8, y1);
+  }
+  /* Masked lanes are not loaded, computed or stored, so they raise no
+     floating point exceptions. */
+  for(; j < n; j += 8) {
+    const __mmask8 m = n - j >= 8 ? 0xff : (__mmask8)((1u << (n - j)) - 1);
+    __m512d x0 = _mm512_maskz_loadu_pd(m, x + j);
+    __m512d y0 = _mm512_maskz_loadu_pd(m, y + j);
+    y0 = _mm512_mask3_fmadd_pd(a, x0, y0, m);
+    _mm512_mask_storeu_pd(y + j, m, y0);
+  }
+}
+
+__attribute__((target("avx512f")))
+static double dot_avx512(int n, const double *x, const double *y)
+{
+  __m512d s0 = _mm512_setzero_pd(), s1 = _mm512_setzero_pd();
+  __m512d s2 = _mm512_setzero_pd(), s3 = _mm512_setzero_pd();
+  int j = 0;
+  for(; j + 32 <= n; j += 32) {
+    s0 = _mm512_fmadd_pd(_mm512_loadu_pd(x + j), _mm512_loadu_pd(y + j), s0);
+    s1 = _mm512_fmadd_pd(_mm512_loadu_pd(x + j + 8),
+			 _mm512_loadu_pd(y + j + 8), s1);
+    s2 = _mm512_fmadd_pd(_mm512_loadu_pd(x + j + 16),
+			 _mm512_loadu_pd(y + j + 16), s2);
+    s3 = _mm512_fmadd_pd(_mm512_loadu_pd(x + j + 24),
+			 _mm512_loadu_pd(y + j + 24), s3);
+  }
+  for(; j < n; j += 8) {
+    const __mmask8 m = n - j >= 8 ? 0xff : (__mmask8)((1u << (n - j)) - 1);
+    s0 = _mm512_mask3_fmadd_pd(_mm512_maskz_loadu_pd(m, x + j),
+			       _mm512_maskz_loadu_pd(m, y + j), s0, m);
+  }
+  return _mm512_reduce_add_pd(_mm512_add_pd(_mm512_add_pd(s0, s1),
+					    _mm512_add_pd(s2, s3)));
+}
+
+__attribute__((target("avx512f")))
+static double sumsq_avx512(int n, const double *x)
+{
+  return dot_avx512(n, x, x);
+}
+
+__attribute__((target("avx512f")))
+static double dist2_avx512(int n, const double *x, const double *y)
+{
+  __m512d s0 = _mm512_setzero_pd(), s1 = _mm512_setzero_pd();
+  int j = 0;
+  for(; j + 16 <= n; j += 16) {
+    const __m512d d0 = _mm512_sub_pd(_mm512_loadu_pd(x + j),
+				     _mm512_loadu_pd(y + j));
+    const __m512d d1 = _mm512_sub_pd(_mm512_loadu_pd(x + j + 8),
+				     _mm512_loadu_pd(y + j + 8));
+    s0 = _mm512_fmadd_pd(d0, d0, s0);
+    s1 = _mm512_fmadd_pd(d1, d1, s1);
+  }
+  for(; j < n; j += 8) {
+    const __mmask8 m = n - j >= 8 ? 0xff : (__mmask8)((1u << (n - j)) - 1);
+    const __m512d d = _mm512_sub_pd(_mm512_maskz_loadu_pd(m, x + j),
+				    _mm512_maskz_loadu_pd(m, y + j));
+    s0 = _mm512_fmadd_pd(d, d, s0);
+  }
+  return _mm512_reduce_add_pd(_mm512_add_pd(s0, s1));
+}
+
+#endif /* GAUSS_HAVE_X86 */
+
+void   (*kernel_axpy)(int, double, const double *, double *) = axpy_generic;
+double (*kernel_dot)(int, const double *, const double *) = dot_generic;
+double (*kernel_sumsq)(int, const double *) = sumsq_generic;
+double (*kernel_dist2)(int, const double *, const double *) = dist2_generic;
+
+static const char *kernel_isa = "generic";
+
+const char *gauss_kernel_isa(void)
+{
+  return kernel_isa;
+}
+
+/* Runs when the library (or the program) is loaded. */
+__attribute__((constructor))
+static void kernels_init(void)
+{
+#ifdef GAUSS_HAVE_X86
+  const char *cap = getenv("GAUSS_ISA");
+  const int allow_avx512 = !cap || strcmp(cap, "avx512") == 0;
+  const int allow_avx2 = allow_avx512 || strcmp(cap, "avx2") == 0;
+
+  __builtin_cpu_init();
+  if(allow_avx512 && __builtin_cpu_supports("avx512f")) {
+    kernel_axpy = axpy_avx512;
+    kernel_dot = dot_avx512;
+    kernel_sumsq = sumsq_avx512;
+    kernel_dist2 = dist2_avx512;
+    kernel_isa = "avx512";
+  } else if(allow_avx2 && __builtin_cpu_supports("avx2")
+	    && __builtin_cpu_supports("fma")) {
+    kernel_axpy = axpy_avx2;
+    kernel_dot = dot_avx2;
+    kernel_sumsq = sumsq_avx2;
+    kernel_dist2 = dist2_avx2;
+    kernel_isa = "avx2";
+  }
+#endif
+}
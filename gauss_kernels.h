@@ -0,0 +1,28 @@
+/*----------------------------------------------------------------
+* File:     gauss_kernels.h
+*----------------------------------------------------------------*/
+
+/* Vector kernels used by the inner loops of the solvers and helpers.
+   The implementation (generic C, AVX2/FMA or AVX-512) is chosen once
+   when the library is loaded, from cpuid. Setting the environment
+   variable GAUSS_ISA to "generic", "avx2" or "avx512" caps the choice. */
+
+#ifndef GAUSS_KERNELS_H
+#define GAUSS_KERNELS_H
+
+/* y[j] += alpha * x[j] for 0 <= j < n; x and y must not overlap. */
+extern void   (*kernel_axpy)(int n, double alpha, const double *x, double *y);
+
+/* Sum of x[j] * y[j] for 0 <= j < n. */
+extern double (*kernel_dot)(int n, const double *x, const double *y);
+
+/* Sum of x[j] * x[j] for 0 <= j < n. */
+extern double (*kernel_sumsq)(int n, const double *x);
+
+/* Sum of (x[j] - y[j])^2 for 0 <= j < n. */
+extern double (*kernel_dist2)(int n, const double *x, const double *y);
+
+/* Name of the selected implementation: "generic", "avx2" or "avx512". */
+const char *gauss_kernel_isa(void);
+
+#endif
@@ -0,0 +1,218 @@
+/*----------------------------------------------------------------
+* File:     gauss_mixed.c
+*----------------------------------------------------------------*/
+/* Single precision PLU and the mixed precision solver. The O(n^3)
+   factorization runs in float, where a SIMD register holds twice as
+   many elements and the matrix takes half the memory traffic; each
+   refinement step costs only O(n^2) in double. */
+
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "gauss_solve.h"
+#include "gauss_arena.h"
+#include "gauss_kernels.h"
+#include "gauss_mixed.h"
+
+/* The float loops are left to the vectorizer and compiled for several
+   ISAs, as the batched kernels are. */
+#if defined(__x86_64__) && defined(__GNUC__)
+#define MIXED_CLONES __attribute__((target_clones("avx512f", "avx2", "default")))
+#else
+#define MIXED_CLONES
+#endif
+
+MIXED_CLONES
+void plu_f(int n, float A[n][n], int P[n])
+{
+  const int nt = gauss_get_num_threads();
+  (void)nt;
+
+  for(int i = 0; i < n; ++i) {
+    P[i] = i;
+  }
+  for(int k = 0; k < n; ++k) {
+    int max_row = k;
+    for(int i = k+1; i < n; ++i) {
+      if(fabsf(A[i][k]) > fabsf(A[max_row][k])) {
+	max_row = i;
+      }
+    }
+    if(max_row != k) {
+      for(int j = 0; j < n; ++j) {
+	SWAP(A[k][j], A[max_row][j], float);
+      }
+      SWAP(P[k], P[max_row], int);
+    }
+#pragma omp parallel for schedule(static) num_threads(nt) \
+  if(nt > 1 && (n - k) * (n - k) > PARALLEL_MIN_WORK)
+    for(int i = k+1; i < n; ++i) {
+      const float m = A[i][k] /= A[k][k];
+      for(int j = k+1; j < n; ++j) {
+	A[i][j] -= m * A[k][j];
+      }
+    }
+  }
+}
+
+MIXED_CLONES
+void plu_solve_lower_f(int n, const float LU[n][n], const int P[n],
+		       float b[n])
+{
+  float y[n];
+  for(int i = 0; i < n; ++i) {
+    y[i] = b[P[i]];
+  }
+  for(int i = 0; i < n; ++i) {
+    float s = y[i];
+    for(int j = 0; j < i; ++j) {
+      s -= LU[i][j] * y[j];
+    }
+    y[i] = s;
+  }
+  memcpy(b, y, sizeof(y));
+}
+
+MIXED_CLONES
+void plu_solve_upper_f(int n, const float LU[n][n], float b[n])
+{
+  for(int i = n-1; i >= 0; --i) {
+    float s = b[i];
+    for(int j = i+1; j < n; ++j) {
+      s -= LU[i][j] * b[j];
+    }
+    b[i] = s / LU[i][i];
+  }
+}
+
+void plu_solve_f(int n, const float LU[n][n], const int P[n], float b[n])
+{
+  plu_solve_lower_f(n, LU, P, b);
+  plu_solve_upper_f(n, LU, b);
+}
+
+/* x := solution of A x = b with plu in double; 1, or 1 + the status
+   of plu if A is singular. */
+static int solve_double(int n, const double A[n][n], const double b[n],
+			double x[n])
+{
+  double (*LU)[n] = (double (*)[n])gauss_arena_scratch((size_t)n * n);
+  int *P = malloc((n + 1) * sizeof(int));
+  if(!LU || !P) {
+    gauss_arena_release(NULL, (double *)LU);
+    free(P);
+    return -1;
+  }
+  memcpy(LU, A, (size_t)n * n * sizeof(double));
+  const int info = plu(n, LU, P);
+  if(info == 0) {
+    memcpy(x, b, n * sizeof(double));
+    plu_solve(n, (const double (*)[n])LU, P, 1, (double (*)[1])x);
+  }
+  free(P);
+  gauss_arena_release(NULL, (double *)LU);
+  return 1 + info;
+}
+
+int gauss_solve_mixed(int n, const double A[n][n], const double b[n],
+		      double x[n], double tol, int *iters)
+{
+  if(iters) {
+    *iters = 0;
+  }
+  if(tol <= 0) {
+    tol = sqrt((double)n) * DBL_EPSILON;
+  }
+
+  /* The float matrix takes half as many doubles of scratch. */
+  float (*Af)[n] =
+    (float (*)[n])gauss_arena_scratch(((size_t)n * n + 1) / 2);
+  int *P = malloc((n + 1) * sizeof(int));
+  double *r = malloc((n + 1) * sizeof(double));
+  float *rf = malloc((n + 1) * sizeof(float));
+  if(!Af || !P || !r || !rf) {
+    gauss_arena_release(NULL, (double *)Af);
+    free(P);
+    free(r);
+    free(rf);
+    return -1;
+  }
+
+  /* Entries beyond the float range would overflow to infinity. */
+  int fits = 1;
+  for(int i = 0; i < n; ++i) {
+    for(int j = 0; j < n; ++j) {
+      fits &= fabs(A[i][j]) <= FLT_MAX;
+      Af[i][j] = fits ? (float)A[i][j] : 0;
+    }
+  }
+
+  int status = 1;
+  if(fits) {
+    double anrm2 = 0;
+    for(int i = 0; i < n; ++i) {
+      anrm2 += kernel_sumsq(n, A[i]);
+    }
+    const double anrm = sqrt(anrm2);
+
+    plu_f(n, Af, P);
+    for(int i = 0; i < n; ++i) {
+      x[i] = 0;
+    }
+
+    /* With x = 0 the first residual is b, the first correction is the
+       single precision solution itself. */
+    double rprev = INFINITY;
+    for(int it = 0; it <= MIXED_MAX_ITER; ++it) {
+      for(int i = 0; i < n; ++i) {
+	r[i] = b[i] - kernel_dot(n, A[i], x);
+      }
+      const double rnrm = sqrt(kernel_sumsq(n, r));
+      const double xnrm = sqrt(kernel_sumsq(n, x));
+      if(it > 0 && rnrm <= tol * anrm * xnrm) {
+	status = 0;
+	break;
+      }
+      /* Stalled, diverged or not finite: give up on float. */
+      if(!(rnrm < 0.5 * rprev) || it == MIXED_MAX_ITER) {
+	break;
+      }
+      rprev = rnrm;
+
+      /* Scale the residual into the float range before solving for
+	 the correction. */
+      double rmax = 0;
+      for(int i = 0; i < n; ++i) {
+	rmax = fmax(rmax, fabs(r[i]));
+      }
+      if(rmax == 0) {
+	status = 0;
+	break;
+      }
+      for(int i = 0; i < n; ++i) {
+	rf[i] = (float)(r[i] / rmax);
+      }
+      plu_solve_f(n, (const float (*)[n])Af, P, rf);
+      for(int i = 0; i < n; ++i) {
+	x[i] += rmax * (double)rf[i];
+      }
+      if(iters) {
+	*iters = it + 1;
+      }
+    }
+  }
+
+  gauss_arena_release(NULL, (double *)Af);
+  free(P);
+  free(r);
+  free(rf);
+  if(status == 1) {
+    status = solve_double(n, A, b, x);
+  }
+  return status;
+}
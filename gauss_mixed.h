@@ -0,0 +1,38 @@
+/*----------------------------------------------------------------
+* File:     gauss_mixed.h
+*----------------------------------------------------------------*/
+
+#ifndef GAUSS_MIXED_H
+#define GAUSS_MIXED_H
+
+/* Single precision versions of plu and of the two triangular solves.
+   Same P convention and packed L\U layout as plu. */
+void plu_f(int n, float A[n][n], int P[n]);
+/* Solve L U y = P b with the output of plu_f; b is overwritten with
+   y. plu_solve_lower_f and plu_solve_upper_f are the two halves:
+   b := L^{-1} P b and b := U^{-1} b. */
+void plu_solve_f(int n, const float LU[n][n], const int P[n], float b[n]);
+void plu_solve_lower_f(int n, const float LU[n][n], const int P[n],
+		       float b[n]);
+void plu_solve_upper_f(int n, const float LU[n][n], float b[n]);
+
+/* Largest number of refinement steps of gauss_solve_mixed. */
+#define MIXED_MAX_ITER 30
+
+/* Solve A x = b by factoring A in single precision and refining x
+   with residuals computed in double, until
+       ||b - A x|| <= tol * ||A||_F * ||x||
+   (tol <= 0 selects sqrt(n) DBL_EPSILON, the accuracy of a backward
+   stable double solve). A and b are not modified. If A does not fit
+   in float, or refinement stalls (the residual fails to halve) or
+   does not converge in MIXED_MAX_ITER steps, x is computed with plu
+   in double instead.
+
+   Returns 0 if refinement converged, 1 after the fallback to double,
+   2 + k if the fallback found a zero pivot at step k (A is singular
+   and x is not a solution), and -1 if out of memory. If iters is not
+   NULL it receives the number of refinement steps taken. */
+int gauss_solve_mixed(int n, const double A[n][n], const double b[n],
+		      double x[n], double tol, int *iters);
+
+#endif
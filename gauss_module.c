@@ -0,0 +1,155 @@
+/*----------------------------------------------------------------
+* File:     gauss_module.c
+*----------------------------------------------------------------*/
+/* The _gauss CPython extension: the factorizations on buffer objects
+   (NumPy arrays, array.array, memoryview), with the GIL released while
+   the C code runs so that Python threads can factor different matrices
+   at the same time. Built by "make ext". */
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <math.h>
+
+#include "gauss_solve.h"
+
+/* Get a writable C-contiguous buffer of count items of the given
+   struct format ("d" or "i"). */
+static int get_buffer(PyObject *obj, Py_buffer *view, const char *format,
+		      Py_ssize_t itemsize, Py_ssize_t count, const char *name)
+{
+  if(PyObject_GetBuffer(obj, view, PyBUF_WRITABLE | PyBUF_FORMAT
+			| PyBUF_C_CONTIGUOUS) < 0) {
+    return -1;
+  }
+  /* Accept native and little-endian byte order prefixes, as NumPy
+     writes them. */
+  const char *f = view->format ? view->format : "B";
+  if(*f == '@' || *f == '=' || *f == '<') {
+    ++f;
+  }
+  if(view->itemsize != itemsize || strcmp(f, format) != 0) {
+    PyErr_Format(PyExc_TypeError, "%s must hold items of format '%s'",
+		 name, format);
+    PyBuffer_Release(view);
+    return -1;
+  }
+  if(count >= 0 && view->len != count * itemsize) {
+    PyErr_Format(PyExc_ValueError, "%s must hold %zd items", name, count);
+    PyBuffer_Release(view);
+    return -1;
+  }
+  return 0;
+}
+
+/* Side of the square matrix held by a float64 buffer. */
+static int matrix_side(PyObject *obj, Py_buffer *view, int *n)
+{
+  if(get_buffer(obj, view, "d", sizeof(double), -1, "A") < 0) {
+    return -1;
+  }
+  const Py_ssize_t len = view->len / (Py_ssize_t)sizeof(double);
+  const Py_ssize_t side = (Py_ssize_t)llround(sqrt((double)len));
+  if(side * side != len || side > INT_MAX) {
+    PyErr_SetString(PyExc_ValueError, "A must be a square matrix");
+    PyBuffer_Release(view);
+    return -1;
+  }
+  *n = (int)side;
+  return 0;
+}
+
+/* A nonzero status of the C function (k+1 for a zero pivot at step k,
+   see gauss_solve.h) raises ValueError. */
+static PyObject *check_status(int info)
+{
+  if(info != 0) {
+    return PyErr_Format(PyExc_ValueError,
+                        "Singular matrix: zero pivot at step %d", info - 1);
+  }
+  Py_RETURN_NONE;
+}
+
+static PyObject *py_lu_in_place(PyObject *self, PyObject *args)
+{
+  PyObject *a;
+  Py_buffer A;
+  int n, info;
+
+  if(!PyArg_ParseTuple(args, "O:lu_in_place", &a)
+     || matrix_side(a, &A, &n) < 0) {
+    return NULL;
+  }
+  Py_BEGIN_ALLOW_THREADS
+  info = lu_in_place(n, A.buf);
+  Py_END_ALLOW_THREADS
+  PyBuffer_Release(&A);
+  return check_status(info);
+}
+
+static PyObject *py_plu(PyObject *self, PyObject *args)
+{
+  PyObject *a, *p;
+  Py_buffer A, P;
+  int n, info;
+
+  if(!PyArg_ParseTuple(args, "OO:plu", &a, &p)
+     || matrix_side(a, &A, &n) < 0) {
+    return NULL;
+  }
+  if(get_buffer(p, &P, "i", sizeof(int), n, "P") < 0) {
+    PyBuffer_Release(&A);
+    return NULL;
+  }
+  Py_BEGIN_ALLOW_THREADS
+  info = plu(n, A.buf, P.buf);
+  Py_END_ALLOW_THREADS
+  PyBuffer_Release(&P);
+  PyBuffer_Release(&A);
+  return check_status(info);
+}
+
+static PyObject *py_gauss_solve_in_place(PyObject *self, PyObject *args)
+{
+  PyObject *a, *b;
+  Py_buffer A, B;
+  int n, info;
+
+  if(!PyArg_ParseTuple(args, "OO:gauss_solve_in_place", &a, &b)
+     || matrix_side(a, &A, &n) < 0) {
+    return NULL;
+  }
+  if(get_buffer(b, &B, "d", sizeof(double), n, "b") < 0) {
+    PyBuffer_Release(&A);
+    return NULL;
+  }
+  Py_BEGIN_ALLOW_THREADS
+  info = gauss_solve_in_place(n, A.buf, B.buf);
+  Py_END_ALLOW_THREADS
+  PyBuffer_Release(&B);
+  PyBuffer_Release(&A);
+  return check_status(info);
+}
+
+static PyMethodDef gauss_methods[] = {
+  { "lu_in_place", py_lu_in_place, METH_VARARGS,
+    "lu_in_place(A): LU of the float64 buffer A in place;\n"
+    "raises ValueError on a zero pivot." },
+  { "plu", py_plu, METH_VARARGS,
+    "plu(A, P): PA=LU of the float64 buffer A in place, P an int32 buffer;\n"
+    "raises ValueError on a zero pivot." },
+  { "gauss_solve_in_place", py_gauss_solve_in_place, METH_VARARGS,
+    "gauss_solve_in_place(A, b): solve Ax=b in place, without pivoting;\n"
+    "raises ValueError on a zero pivot." },
+  { NULL, NULL, 0, NULL }
+};
+
+static struct PyModuleDef gauss_module = {
+  PyModuleDef_HEAD_INIT, "_gauss",
+  "Gaussian elimination on buffers, releasing the GIL.", -1, gauss_methods,
+  NULL, NULL, NULL, NULL
+};
+
+PyMODINIT_FUNC PyInit__gauss(void)
+{
+  return PyModule_Create(&gauss_module);
+}
@@ -0,0 +1,505 @@
+/*----------------------------------------------------------------
+* File:     gauss_mpi.c
+*----------------------------------------------------------------*/
+/* Every blocking collective below is issued, on its communicator, by
+   all the members in the same order of panels, so none can wait on a
+   process that is itself waiting on a later one. The only
+   communication that overlaps computation is the broadcast of the
+   next panel along the process rows, posted with MPI_Ibcast by every
+   member of the row at the same point of the loop. */
+
+#include <limits.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "gauss_solve.h"
+#include "gauss_kernels.h"
+#include "gauss_mpi.h"
+
+#define MPI_DEFAULT_NB 64
+/* Column strips of the trailing update, as in gauss_ooc.c. */
+#define MPI_JB 256
+
+/* Number of the indices 0..n-1, in blocks of nb dealt cyclically over
+   np processes, that belong to process p (numroc in ScaLAPACK). It is
+   also the local index of the first global index >= n on p. */
+static int numroc(int n, int nb, int p, int np)
+{
+  const int nblocks = n / nb;
+  int count = nblocks / np * nb;
+  const int extra = nblocks % np;
+  if(p < extra) {
+    count += nb;
+  } else if(p == extra) {
+    count += n % nb;
+  }
+  return count;
+}
+
+static int owner(int i, int nb, int np)
+{
+  return i / nb % np;
+}
+
+static int g2l(int i, int nb, int np)
+{
+  return i / nb / np * nb + i % nb;
+}
+
+static int l2g(int l, int nb, int p, int np)
+{
+  return (l / nb * np + p) * nb + l % nb;
+}
+
+int gauss_grid_init(gauss_grid *g, MPI_Comm comm, int nprow)
+{
+  int size, rank;
+  MPI_Comm_size(comm, &size);
+  MPI_Comm_rank(comm, &rank);
+  if(nprow <= 0) {
+    nprow = (int)sqrt((double)size);
+    while(size % nprow) {
+      --nprow;
+    }
+  }
+  if(size % nprow) {
+    return -1;
+  }
+  g->comm = comm;
+  g->nprow = nprow;
+  g->npcol = size / nprow;
+  g->myrow = rank / g->npcol;
+  g->mycol = rank % g->npcol;
+  MPI_Comm_split(comm, g->myrow, g->mycol, &g->row_comm);
+  MPI_Comm_split(comm, g->mycol, g->myrow, &g->col_comm);
+  return 0;
+}
+
+void gauss_grid_free(gauss_grid *g)
+{
+  MPI_Comm_free(&g->row_comm);
+  MPI_Comm_free(&g->col_comm);
+}
+
+gauss_dmatrix *gauss_dmatrix_create(const gauss_grid *g, int n, int nb)
+{
+  gauss_dmatrix *D = malloc(sizeof(*D));
+  if(!D) {
+    return NULL;
+  }
+  D->grid = g;
+  D->n = n;
+  D->nb = nb > 0 ? nb : MPI_DEFAULT_NB;
+  D->mloc = numroc(n, D->nb, g->myrow, g->nprow);
+  D->nloc = numroc(n, D->nb, g->mycol, g->npcol);
+  D->A = malloc(((size_t)D->mloc * D->nloc + 1) * sizeof(double));
+  if(!D->A) {
+    free(D);
+    return NULL;
+  }
+  return D;
+}
+
+void gauss_dmatrix_free(gauss_dmatrix *D)
+{
+  if(D) {
+    free(D->A);
+    free(D);
+  }
+}
+
+/* Copy between the global matrix and the local part of process q, in
+   the direction given by to_local. */
+static void pack_local(const gauss_dmatrix *D, int q, double *loc,
+		       double *A, int to_local)
+{
+  const gauss_grid *g = D->grid;
+  const int n = D->n, nb = D->nb;
+  const int pr = q / g->npcol, pc = q % g->npcol;
+  const int mloc = numroc(n, nb, pr, g->nprow);
+  const int nloc = numroc(n, nb, pc, g->npcol);
+  for(int li = 0; li < mloc; ++li) {
+    const size_t i = l2g(li, nb, pr, g->nprow);
+    for(int lj = 0; lj < nloc; ++lj) {
+      const int j = l2g(lj, nb, pc, g->npcol);
+      if(to_local) {
+	loc[(size_t)li * nloc + lj] = A[i * n + j];
+      } else {
+	A[i * n + j] = loc[(size_t)li * nloc + lj];
+      }
+    }
+  }
+}
+
+static void scatter_gather(const gauss_dmatrix *D, int root, double *A,
+			   int scatter)
+{
+  const gauss_grid *g = D->grid;
+  int rank, size;
+  MPI_Comm_rank(g->comm, &rank);
+  MPI_Comm_size(g->comm, &size);
+  const size_t mine = (size_t)D->mloc * D->nloc;
+  if(rank != root) {
+    if(scatter) {
+      MPI_Recv(D->A, mine, MPI_DOUBLE, root, 0, g->comm, MPI_STATUS_IGNORE);
+    } else {
+      MPI_Send(D->A, mine, MPI_DOUBLE, root, 0, g->comm);
+    }
+    return;
+  }
+  size_t most = 0;
+  for(int q = 0; q < size; ++q) {
+    const size_t c = (size_t)numroc(D->n, D->nb, q / g->npcol, g->nprow)
+      * numroc(D->n, D->nb, q % g->npcol, g->npcol);
+    most = c > most ? c : most;
+  }
+  double *buf = malloc((most + 1) * sizeof(double));
+  for(int q = 0; q < size; ++q) {
+    const int count = numroc(D->n, D->nb, q / g->npcol, g->nprow)
+      * numroc(D->n, D->nb, q % g->npcol, g->npcol);
+    double *loc = q == root ? D->A : buf;
+    if(scatter) {
+      pack_local(D, q, loc, A, 1);
+      if(q != root) {
+	MPI_Send(loc, count, MPI_DOUBLE, q, 0, g->comm);
+      }
+    } else {
+      if(q != root) {
+	MPI_Recv(loc, count, MPI_DOUBLE, q, 0, g->comm, MPI_STATUS_IGNORE);
+      }
+      pack_local(D, q, loc, A, 0);
+    }
+  }
+  free(buf);
+}
+
+void gauss_dmatrix_scatter(gauss_dmatrix *D, int root, const double *A)
+{
+  scatter_gather(D, root, (double *)A, 1);
+}
+
+void gauss_dmatrix_gather(const gauss_dmatrix *D, int root, double *A)
+{
+  scatter_gather(D, root, A, 0);
+}
+
+/* Interchange global rows i and r in the local columns c0..c1-1,
+   between processes of the grid column if the rows live apart. */
+static void swap_rows(gauss_dmatrix *D, int i, int r, int c0, int c1,
+		      double *tmp)
+{
+  const gauss_grid *g = D->grid;
+  const int nb = D->nb, w = c1 - c0;
+  const int qi = owner(i, nb, g->nprow), qr = owner(r, nb, g->nprow);
+  if(w <= 0 || (g->myrow != qi && g->myrow != qr)) {
+    return;
+  }
+  if(qi == qr) {
+    double *a = D->A + (size_t)g2l(i, nb, g->nprow) * D->nloc + c0;
+    double *b = D->A + (size_t)g2l(r, nb, g->nprow) * D->nloc + c0;
+    for(int j = 0; j < w; ++j) {
+      SWAP(a[j], b[j], double);
+    }
+    return;
+  }
+  const int mine = g->myrow == qi ? i : r, other = g->myrow == qi ? qr : qi;
+  double *a = D->A + (size_t)g2l(mine, nb, g->nprow) * D->nloc + c0;
+  MPI_Sendrecv(a, w, MPI_DOUBLE, other, 1, tmp, w, MPI_DOUBLE, other, 1,
+	       g->col_comm, MPI_STATUS_IGNORE);
+  memcpy(a, tmp, w * sizeof(double));
+}
+
+/* Factor the panel of columns k0..k0+kb-1 on the process column that
+   holds it, as plu does: for each column, the pivot is the first entry
+   of largest magnitude (MPI_MAXLOC breaks ties by the lower index),
+   the interchange is applied within the panel, and the rows below are
+   eliminated with the pivot row broadcast down the column. ipiv
+   receives the kb pivot rows (global), then the status of the panel. */
+static void factor_panel(gauss_dmatrix *D, int k0, int kb, int ipiv[],
+			 double *row, double *tmp)
+{
+  const gauss_grid *g = D->grid;
+  const int nb = D->nb, jl0 = g2l(k0, nb, g->npcol);
+  double (*A)[D->nloc] = (double (*)[D->nloc])D->A;
+  ipiv[kb] = 0;
+
+  for(int j = k0; j < k0 + kb; ++j) {
+    const int jl = jl0 + j - k0;
+    struct { double v; int i; } best = { -1, INT_MAX };
+    for(int l = numroc(j, nb, g->myrow, g->nprow); l < D->mloc; ++l) {
+      if(fabs(A[l][jl]) > best.v) {
+	best.v = fabs(A[l][jl]);
+	best.i = l2g(l, nb, g->myrow, g->nprow);
+      }
+    }
+    MPI_Allreduce(MPI_IN_PLACE, &best, 1, MPI_DOUBLE_INT, MPI_MAXLOC,
+		  g->col_comm);
+    if(best.v == 0) {
+      /* A zero column below the diagonal: nothing to eliminate */
+      ipiv[j - k0] = j;
+      if(ipiv[kb] == 0) {
+	ipiv[kb] = j + 1;
+      }
+      continue;
+    }
+    ipiv[j - k0] = best.i;
+    if(best.i != j) {
+      swap_rows(D, j, best.i, jl0, jl0 + kb, tmp);
+    }
+
+    const int w = k0 + kb - j, oj = owner(j, nb, g->nprow);
+    if(g->myrow == oj) {
+      memcpy(row, &A[g2l(j, nb, g->nprow)][jl], w * sizeof(double));
+    }
+    MPI_Bcast(row, w, MPI_DOUBLE, oj, g->col_comm);
+    for(int l = numroc(j + 1, nb, g->myrow, g->nprow); l < D->mloc; ++l) {
+      A[l][jl] /= row[0];
+      kernel_axpy(w - 1, -A[l][jl], &row[1], &A[l][jl + 1]);
+    }
+  }
+}
+
+/* The rows of the panel at or below k0, kb wide, in local order. */
+static void pack_panel(const gauss_dmatrix *D, int k0, int kb, double *L)
+{
+  const gauss_grid *g = D->grid;
+  const int r0 = numroc(k0, D->nb, g->myrow, g->nprow);
+  const int jl0 = g2l(k0, D->nb, g->npcol);
+  for(int l = r0; l < D->mloc; ++l) {
+    memcpy(L + (size_t)(l - r0) * kb, D->A + (size_t)l * D->nloc + jl0,
+	   kb * sizeof(double));
+  }
+}
+
+/* A[rs.., ca..cb-1] -= L U for the local rows from rs, where L holds
+   the panel rows from r0 (kb wide) and U the row of U from local
+   column u0. */
+static void update(gauss_dmatrix *D, const double *L, int r0, int kb,
+		   const double *U, int u0, int rs, int ca, int cb, int nt)
+{
+  (void)nt;
+  const int nloc = D->nloc, wu = nloc - u0;
+  if(ca >= cb) {
+    return;
+  }
+#pragma omp parallel for schedule(static) num_threads(nt) \
+  if(nt > 1 && (size_t)(D->mloc - rs) * (cb - ca) > PARALLEL_MIN_WORK)
+  for(int l = rs; l < D->mloc; ++l) {
+    const double *Li = L + (size_t)(l - r0) * kb;
+    double *Ai = D->A + (size_t)l * nloc;
+    for(int jj = ca; jj < cb; jj += MPI_JB) {
+      const int jb = jj + MPI_JB < cb ? MPI_JB : cb - jj;
+      for(int p = 0; p < kb; ++p) {
+	kernel_axpy(jb, -Li[p], U + (size_t)p * wu + jj - u0, Ai + jj);
+      }
+    }
+  }
+}
+
+/* Factor panel K where it lives, if it is here, and start its
+   broadcast along the process rows. */
+static void start_panel(gauss_dmatrix *D, int K, int *ipiv, double *L,
+			double *row, double *tmp, MPI_Request req[2])
+{
+  const gauss_grid *g = D->grid;
+  const int nb = D->nb, k0 = K * nb;
+  const int kb = k0 + nb < D->n ? nb : D->n - k0;
+  const int pc = owner(k0, nb, g->npcol);
+  const int count = (D->mloc - numroc(k0, nb, g->myrow, g->nprow)) * kb;
+  if(g->mycol == pc) {
+    factor_panel(D, k0, kb, ipiv, row, tmp);
+    pack_panel(D, k0, kb, L);
+  }
+  MPI_Ibcast(ipiv, kb + 1, MPI_INT, pc, g->row_comm, &req[0]);
+  MPI_Ibcast(L, count, MPI_DOUBLE, pc, g->row_comm, &req[1]);
+}
+
+int gauss_mpi_plu(gauss_dmatrix *D, int P[])
+{
+  const gauss_grid *g = D->grid;
+  const int n = D->n, nb = D->nb, nt = gauss_get_num_threads();
+  const int nblocks = (n + nb - 1) / nb;
+  const size_t lsize = (size_t)D->mloc * nb + 1;
+  double *L[2] = { malloc(lsize * sizeof(double)),
+		   malloc(lsize * sizeof(double)) };
+  double *U = malloc(((size_t)D->nloc * nb + 1) * sizeof(double));
+  double *row = malloc((nb + 1) * sizeof(double));
+  double *tmp = malloc((D->nloc + 1) * sizeof(double));
+  int *ipiv[2] = { malloc((nb + 1) * sizeof(int)),
+		   malloc((nb + 1) * sizeof(int)) };
+  int *piv = malloc((n + 1) * sizeof(int));
+  int ok = L[0] && L[1] && U && row && tmp && ipiv[0] && ipiv[1] && piv;
+  MPI_Allreduce(MPI_IN_PLACE, &ok, 1, MPI_INT, MPI_LAND, g->comm);
+  int info = ok ? 0 : -1;
+
+  MPI_Request req[2];
+  if(ok && nblocks > 0) {
+    start_panel(D, 0, ipiv[0], L[0], row, tmp, req);
+  }
+  for(int K = 0; ok && K < nblocks; ++K) {
+    const int k0 = K * nb, k1 = k0 + nb < n ? k0 + nb : n, kb = k1 - k0;
+    const int pr = owner(k0, nb, g->nprow), pc = owner(k0, nb, g->npcol);
+    const int jl0 = g2l(k0, nb, g->npcol);
+    const int r0 = numroc(k0, nb, g->myrow, g->nprow);
+    const int rs = numroc(k1, nb, g->myrow, g->nprow);
+    const int c1 = numroc(k1, nb, g->mycol, g->npcol);
+    double *Lk = L[K % 2];
+    int *ipk = ipiv[K % 2];
+    MPI_Waitall(2, req, MPI_STATUSES_IGNORE);
+    memcpy(&piv[k0], ipk, kb * sizeof(int));
+    if(ipk[kb] && info == 0) {
+      info = ipk[kb];
+    }
+
+    /* The interchanges, outside the panel (already done there). */
+    for(int j = k0; j < k1; ++j) {
+      if(ipk[j - k0] != j) {
+	if(g->mycol == pc) {
+	  swap_rows(D, j, ipk[j - k0], 0, jl0, tmp);
+	  swap_rows(D, j, ipk[j - k0], jl0 + kb, D->nloc, tmp);
+	} else {
+	  swap_rows(D, j, ipk[j - k0], 0, D->nloc, tmp);
+	}
+      }
+    }
+
+    /* The row of U: U12 = L11^{-1} A12, then down the columns. */
+    const int wu = D->nloc - c1;
+    if(g->myrow == pr) {
+      const int rl0 = g2l(k0, nb, g->nprow);
+      double (*A)[D->nloc] = (double (*)[D->nloc])D->A;
+      for(int r = 1; r < kb; ++r) {
+	for(int p = 0; p < r; ++p) {
+	  kernel_axpy(wu, -Lk[r * kb + p], &A[rl0 + p][c1], &A[rl0 + r][c1]);
+	}
+      }
+      for(int r = 0; r < kb; ++r) {
+	memcpy(U + (size_t)r * wu, &A[rl0 + r][c1], wu * sizeof(double));
+      }
+    }
+    MPI_Bcast(U, kb * wu, MPI_DOUBLE, pr, g->col_comm);
+
+    /* Look-ahead: the next panel is brought up to date and factored
+       first, so that its broadcast runs during the rest of the
+       update. */
+    int ca = c1;
+    if(K + 1 < nblocks) {
+      if(g->mycol == owner(k1, nb, g->npcol)) {
+	const int knb = k1 + nb < n ? nb : n - k1;
+	update(D, Lk, r0, kb, U, c1, rs, c1, c1 + knb, nt);
+	ca = c1 + knb;
+      }
+      start_panel(D, K + 1, ipiv[(K + 1) % 2], L[(K + 1) % 2], row, tmp, req);
+    }
+    update(D, Lk, r0, kb, U, c1, rs, ca, D->nloc, nt);
+  }
+
+  if(ok) {
+    for(int i = 0; i < n; ++i) {
+      P[i] = i;
+    }
+    for(int k = 0; k < n; ++k) {
+      SWAP(P[k], P[piv[k]], int);
+    }
+  }
+  free(L[0]);
+  free(L[1]);
+  free(U);
+  free(row);
+  free(tmp);
+  free(ipiv[0]);
+  free(ipiv[1]);
+  free(piv);
+  return info;
+}
+
+/* Both triangular solves go block by block. The process holding the
+   diagonal block solves it, after the partial sums of the blocks to
+   its left (or right) held along its process row have been reduced
+   onto it; the result is broadcast down its process column, whose
+   processes then add their blocks' contributions to their partial
+   sums. */
+int gauss_mpi_solve(const gauss_dmatrix *D, const int P[], double b[])
+{
+  const gauss_grid *g = D->grid;
+  const int n = D->n, nb = D->nb, nblocks = (n + nb - 1) / nb;
+  const double (*A)[D->nloc] = (const double (*)[D->nloc])D->A;
+  double *y = malloc((n + 1) * sizeof(double));
+  double *s = calloc(n + 1, sizeof(double));
+  double *sum = malloc((nb + 1) * sizeof(double));
+  int ok = y && s && sum;
+  MPI_Allreduce(MPI_IN_PLACE, &ok, 1, MPI_INT, MPI_LAND, g->comm);
+  if(!ok) {
+    free(y);
+    free(s);
+    free(sum);
+    return -1;
+  }
+  for(int i = 0; i < n; ++i) {
+    y[i] = b[P[i]];
+  }
+
+  for(int K = 0; K < nblocks; ++K) {
+    const int k0 = K * nb, k1 = k0 + nb < n ? k0 + nb : n, kb = k1 - k0;
+    const int pr = owner(k0, nb, g->nprow), pc = owner(k0, nb, g->npcol);
+    const int cl0 = g2l(k0, nb, g->npcol);
+    if(g->myrow == pr) {
+      MPI_Reduce(&s[k0], sum, kb, MPI_DOUBLE, MPI_SUM, pc, g->row_comm);
+      if(g->mycol == pc) {
+	const int rl0 = g2l(k0, nb, g->nprow);
+	for(int r = 0; r < kb; ++r) {
+	  y[k0 + r] -= sum[r] + kernel_dot(r, &A[rl0 + r][cl0], &y[k0]);
+	}
+      }
+    }
+    if(g->mycol == pc) {
+      MPI_Bcast(&y[k0], kb, MPI_DOUBLE, pr, g->col_comm);
+      for(int l = numroc(k1, nb, g->myrow, g->nprow); l < D->mloc; ++l) {
+	s[l2g(l, nb, g->myrow, g->nprow)] += kernel_dot(kb, &A[l][cl0], &y[k0]);
+      }
+    }
+  }
+
+  memset(s, 0, n * sizeof(double));
+  for(int K = nblocks - 1; K >= 0; --K) {
+    const int k0 = K * nb, k1 = k0 + nb < n ? k0 + nb : n, kb = k1 - k0;
+    const int pr = owner(k0, nb, g->nprow), pc = owner(k0, nb, g->npcol);
+    const int cl0 = g2l(k0, nb, g->npcol);
+    if(g->myrow == pr) {
+      MPI_Reduce(&s[k0], sum, kb, MPI_DOUBLE, MPI_SUM, pc, g->row_comm);
+      if(g->mycol == pc) {
+	const int rl0 = g2l(k0, nb, g->nprow);
+	for(int r = kb - 1; r >= 0; --r) {
+	  y[k0 + r] -= sum[r] + kernel_dot(kb - r - 1, &A[rl0 + r][cl0 + r + 1],
+					   &y[k0 + r + 1]);
+	  y[k0 + r] /= A[rl0 + r][cl0 + r];
+	}
+      }
+    }
+    if(g->mycol == pc) {
+      MPI_Bcast(&y[k0], kb, MPI_DOUBLE, pr, g->col_comm);
+      for(int l = 0; l < numroc(k0, nb, g->myrow, g->nprow); ++l) {
+	s[l2g(l, nb, g->myrow, g->nprow)] += kernel_dot(kb, &A[l][cl0], &y[k0]);
+      }
+    }
+  }
+
+  /* x is complete on the process column of each block; each block is
+     contributed once, by the process holding its diagonal block. */
+  for(int K = 0; K < nblocks; ++K) {
+    const int k0 = K * nb, k1 = k0 + nb < n ? k0 + nb : n;
+    if(g->myrow != owner(k0, nb, g->nprow)
+       || g->mycol != owner(k0, nb, g->npcol)) {
+      memset(&y[k0], 0, (k1 - k0) * sizeof(double));
+    }
+  }
+  MPI_Allreduce(y, b, n, MPI_DOUBLE, MPI_SUM, g->comm);
+  free(y);
+  free(s);
+  free(sum);
+  return 0;
+}
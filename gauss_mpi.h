@@ -0,0 +1,66 @@
+/*----------------------------------------------------------------
+* File:     gauss_mpi.h
+*----------------------------------------------------------------*/
+
+#ifndef GAUSS_MPI_H
+#define GAUSS_MPI_H
+
+#include <mpi.h>
+
+/* Distributed-memory PLU (make mpi). The processes form an
+   nprow x npcol grid, rank = myrow * npcol + mycol, and an n x n
+   matrix is divided into nb x nb blocks dealt out cyclically in both
+   directions, as in ScaLAPACK: block (I,J) lives on process
+   (I mod nprow, J mod npcol). */
+typedef struct {
+  MPI_Comm comm;
+  MPI_Comm row_comm;		/* My grid row; rank = mycol */
+  MPI_Comm col_comm;		/* My grid column; rank = myrow */
+  int nprow, npcol, myrow, mycol;
+} gauss_grid;
+
+/* Arrange the processes of comm into a grid with nprow rows, or the
+   most nearly square grid if nprow <= 0. Collective. Returns 0, or -1
+   if nprow does not divide the number of processes. */
+int  gauss_grid_init(gauss_grid *g, MPI_Comm comm, int nprow);
+void gauss_grid_free(gauss_grid *g);
+
+/* The local part of a distributed matrix: the blocks of this process,
+   in their global order, as one mloc x nloc row-major array. */
+typedef struct {
+  const gauss_grid *grid;
+  int n, nb;
+  int mloc, nloc;
+  double *A;
+} gauss_dmatrix;
+
+/* Allocate the local part (not collective). nb <= 0 selects the
+   default block size. Returns NULL if out of memory. */
+gauss_dmatrix *gauss_dmatrix_create(const gauss_grid *g, int n, int nb);
+void           gauss_dmatrix_free(gauss_dmatrix *D);
+
+/* Distribute the n x n matrix A of process root to D, or collect D
+   into A on root; A is only referenced on root. Collective. */
+void gauss_dmatrix_scatter(gauss_dmatrix *D, int root, const double *A);
+void gauss_dmatrix_gather(const gauss_dmatrix *D, int root, double *A);
+
+/* PLU in place, with the same pivots and packed L\U as plu: after
+   gauss_dmatrix_gather, A and P are what plu would have produced (up
+   to rounding in the blocked updates). P (n entries) and the return
+   value are the same on every process: 0, -1 if out of memory, or k+1
+   if U[k][k] is exactly zero. Collective.
+
+   Right-looking by block columns, as in HPL. The process column that
+   holds a panel factors it with one MAXLOC reduction per column down
+   the column; the pivots and L are then broadcast along the process
+   rows, and the row of U down the process columns. With look-ahead,
+   the next panel is updated and factored first, and its broadcast
+   overlaps the update of the rest of the trailing matrix. */
+int gauss_mpi_plu(gauss_dmatrix *D, int P[]);
+
+/* Solve A x = b with the output of gauss_mpi_plu. b (n entries, the
+   same on every process) is overwritten with x on every process.
+   Returns 0 or -1 if out of memory. Collective. */
+int gauss_mpi_solve(const gauss_dmatrix *D, const int P[], double b[]);
+
+#endif
@@ -0,0 +1,325 @@
+/*----------------------------------------------------------------
+* File:     gauss_ooc.c
+*----------------------------------------------------------------*/
+/* Out-of-core PLU. The left-looking order writes every panel once;
+   the panels to its left are only read, in order, which lets the
+   kernel read ahead. Row interchanges are applied to the panels on the
+   left as soon as a panel is factored, so the file always holds rows
+   in the current order and the updates need no index mapping. */
+
+#define _DEFAULT_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "gauss_solve.h"
+#include "gauss_kernels.h"
+#include "gauss_ooc.h"
+
+#define OOC_DEFAULT_NB 512
+/* Blocking of the update of a panel by a panel on its left: strips
+   of OOC_JB columns, and OOC_KB rows of U at a time, which stay in L2
+   while every row below is updated. */
+#define OOC_JB 256
+#define OOC_KB 64
+#define OOC_IB 32
+
+struct gauss_ooc {
+  int fd;
+  int n, nb, npanels;
+  double *map;
+  size_t bytes;
+};
+
+static double *panel(const gauss_ooc *A, int p)
+{
+  return A->map + (size_t)p * A->nb * A->n;
+}
+
+static int panel_width(const gauss_ooc *A, int p)
+{
+  const int c0 = p * A->nb;
+  return c0 + A->nb < A->n ? A->nb : A->n - c0;
+}
+
+/* Read ahead, or drop from the resident set, the pages of panel p. */
+static void panel_advise(const gauss_ooc *A, int p, int advice)
+{
+  const uintptr_t page = sysconf(_SC_PAGESIZE);
+  uintptr_t a = (uintptr_t)panel(A, p);
+  const uintptr_t e = a + (size_t)A->n * panel_width(A, p) * sizeof(double);
+  a &= ~(page - 1);
+  madvise((void *)a, e - a, advice);
+}
+
+int gauss_ooc_panel_width(int n, size_t mem_bytes)
+{
+  const size_t w = mem_bytes / (3 * (size_t)n * sizeof(double));
+  return w < 1 ? 1 : w > (size_t)n ? n : (int)w;
+}
+
+static gauss_ooc *ooc_map(const char *path, int n, int nb, int create)
+{
+  gauss_ooc *A = calloc(1, sizeof(*A));
+  if(!A) {
+    return NULL;
+  }
+  A->n = n;
+  A->nb = nb > 0 ? nb : OOC_DEFAULT_NB;
+  A->npanels = (n + A->nb - 1) / A->nb;
+  A->bytes = (size_t)n * n * sizeof(double);
+  A->fd = open(path, create ? O_RDWR | O_CREAT | O_TRUNC : O_RDWR, 0644);
+  if(A->fd < 0) {
+    free(A);
+    return NULL;
+  }
+  struct stat st;
+  if(create ? ftruncate(A->fd, A->bytes) != 0
+     : fstat(A->fd, &st) != 0 || (size_t)st.st_size != A->bytes) {
+    if(!create) {
+      errno = EINVAL;
+    }
+    goto fail;
+  }
+  A->map = mmap(NULL, A->bytes > 0 ? A->bytes : 1, PROT_READ | PROT_WRITE,
+		MAP_SHARED, A->fd, 0);
+  if(A->map == MAP_FAILED) {
+    goto fail;
+  }
+  return A;
+
+ fail:
+  {
+    const int e = errno;
+    close(A->fd);
+    free(A);
+    errno = e;
+  }
+  return NULL;
+}
+
+gauss_ooc *gauss_ooc_create(const char *path, int n, int nb)
+{
+  return ooc_map(path, n, nb, 1);
+}
+
+gauss_ooc *gauss_ooc_open(const char *path, int n, int nb)
+{
+  return ooc_map(path, n, nb, 0);
+}
+
+void gauss_ooc_close(gauss_ooc *A)
+{
+  if(A) {
+    msync(A->map, A->bytes, MS_SYNC);
+    munmap(A->map, A->bytes > 0 ? A->bytes : 1);
+    close(A->fd);
+    free(A);
+  }
+}
+
+void gauss_ooc_set_row(gauss_ooc *A, int i, const double row[])
+{
+  for(int p = 0; p < A->npanels; ++p) {
+    const int w = panel_width(A, p);
+    memcpy(panel(A, p) + (size_t)i * w, row + p * A->nb, w * sizeof(double));
+  }
+}
+
+void gauss_ooc_get_row(const gauss_ooc *A, int i, double row[])
+{
+  for(int p = 0; p < A->npanels; ++p) {
+    const int w = panel_width(A, p);
+    memcpy(row + p * A->nb, panel(A, p) + (size_t)i * w, w * sizeof(double));
+  }
+}
+
+/* Apply the interchanges ipiv[k0..k1-1] (absolute rows) to the n x w
+   row-major block X. */
+static void ooc_laswp(int w, double *X, int k0, int k1, const int ipiv[])
+{
+  for(int k = k0; k < k1; ++k) {
+    const int r = ipiv[k];
+    if(r != k) {
+      double *a = X + (size_t)k * w, *b = X + (size_t)r * w;
+      for(int j = 0; j < w; ++j) {
+	SWAP(a[j], b[j], double);
+      }
+    }
+  }
+}
+
+/* Update of the panel J (n x wJ, in memory) by the factored panel K
+   (n x wK, columns k0..k0+wK-1): the rows of the diagonal block of K
+   become rows of U, J := L_KK^{-1} J there, and every row below gets
+   J[i] -= L_K[i] J[block]. */
+static void ooc_update(int n, int k0, int wK, const double *Kp, int wJ,
+		       double *Jp, int nt)
+{
+  (void)nt;
+  const double (*K)[wK] = (const double (*)[wK])Kp;
+  double (*J)[wJ] = (double (*)[wJ])Jp;
+
+#pragma omp parallel for schedule(static) num_threads(nt) \
+  if(nt > 1 && wK * wJ > PARALLEL_MIN_WORK)
+  for(int jj = 0; jj < wJ; jj += OOC_JB) {
+    const int jb = jj + OOC_JB < wJ ? OOC_JB : wJ - jj;
+    for(int r = 1; r < wK; ++r) {
+      for(int p = 0; p < r; ++p) {
+	kernel_axpy(jb, -K[k0 + r][p], &J[k0 + p][jj], &J[k0 + r][jj]);
+      }
+    }
+  }
+
+  const int i0 = k0 + wK;
+#pragma omp parallel for schedule(static) num_threads(nt) \
+  if(nt > 1 && (size_t)(n - i0) * wJ > PARALLEL_MIN_WORK)
+  for(int ii = i0; ii < n; ii += OOC_IB) {
+    const int ie = ii + OOC_IB < n ? ii + OOC_IB : n;
+    for(int jj = 0; jj < wJ; jj += OOC_JB) {
+      const int jb = jj + OOC_JB < wJ ? OOC_JB : wJ - jj;
+      for(int pp = 0; pp < wK; pp += OOC_KB) {
+	const int pe = pp + OOC_KB < wK ? pp + OOC_KB : wK;
+	for(int i = ii; i < ie; ++i) {
+	  for(int p = pp; p < pe; ++p) {
+	    kernel_axpy(jb, -K[i][p], &J[k0 + p][jj], &J[i][jj]);
+	  }
+	}
+      }
+    }
+  }
+}
+
+int gauss_ooc_plu(gauss_ooc *A, int P[])
+{
+  const int n = A->n, nt = gauss_get_num_threads();
+  int *ipiv = malloc((n + 1) * sizeof(int));
+  int *lp = malloc((n + 1) * sizeof(int));
+  int *where = malloc((n + 1) * sizeof(int));
+  int *at = malloc((n + 1) * sizeof(int));
+  void *buf = NULL;
+  if(!ipiv || !lp || !where || !at
+     || posix_memalign(&buf, 64, ((size_t)n * A->nb + 1) * sizeof(double))) {
+    free(ipiv);
+    free(lp);
+    free(where);
+    free(at);
+    return -1;
+  }
+  double *Jp = buf;
+  int info = 0;
+
+  for(int J = 0; J < A->npanels; ++J) {
+    const int c0 = J * A->nb, wJ = panel_width(A, J);
+    double (*Jm)[wJ] = (double (*)[wJ])Jp;
+
+    if(J > 0) {
+      panel_advise(A, 0, MADV_WILLNEED);
+    }
+    memcpy(Jp, panel(A, J), (size_t)n * wJ * sizeof(double));
+    ooc_laswp(wJ, Jp, 0, c0, ipiv);
+
+    for(int K = 0; K < J; ++K) {
+      if(K + 1 < J) {
+	panel_advise(A, K + 1, MADV_WILLNEED);
+      }
+      ooc_update(n, K * A->nb, panel_width(A, K), panel(A, K), wJ, Jp, nt);
+      panel_advise(A, K, MADV_DONTNEED);
+    }
+
+    /* Factor rows c0..n-1 of the panel in memory. */
+    const int m = n - c0;
+    const int pinfo = plu_blocked_lda(m, wJ, wJ, (double (*)[wJ])Jm[c0], lp, 0);
+    if(pinfo && info == 0) {
+      info = c0 + pinfo;
+    }
+
+    /* The permutation of the panel as a sequence of interchanges, so
+       that it can be applied in place to the panels on the left, and to
+       the ones on the right when they are loaded. where[r] is the
+       current position of local row r, and at[q] the row now at q. */
+    for(int i = 0; i < m; ++i) {
+      where[i] = at[i] = i;
+    }
+    for(int k = 0; k < wJ; ++k) {
+      const int r = lp[k], q = where[r];
+      ipiv[c0 + k] = c0 + q;
+      at[q] = at[k];
+      where[at[q]] = q;
+      at[k] = r;
+      where[r] = k;
+    }
+
+    memcpy(panel(A, J), Jp, (size_t)n * wJ * sizeof(double));
+    for(int K = 0; K < J; ++K) {
+      ooc_laswp(panel_width(A, K), panel(A, K), c0, c0 + wJ, ipiv);
+    }
+  }
+
+  for(int i = 0; i < n; ++i) {
+    P[i] = i;
+  }
+  for(int k = 0; k < n; ++k) {
+    SWAP(P[k], P[ipiv[k]], int);
+  }
+  free(buf);
+  free(ipiv);
+  free(lp);
+  free(where);
+  free(at);
+  return info;
+}
+
+int gauss_ooc_solve(const gauss_ooc *A, const int P[], double b[])
+{
+  const int n = A->n;
+  double *y = malloc((n + 1) * sizeof(double));
+  if(!y) {
+    return -1;
+  }
+  for(int i = 0; i < n; ++i) {
+    y[i] = b[P[i]];
+  }
+
+  for(int K = 0; K < A->npanels; ++K) {
+    const int k0 = K * A->nb, w = panel_width(A, K);
+    const double (*L)[w] = (const double (*)[w])panel(A, K);
+    if(K + 1 < A->npanels) {
+      panel_advise(A, K + 1, MADV_WILLNEED);
+    }
+    for(int r = 1; r < w; ++r) {
+      y[k0 + r] -= kernel_dot(r, L[k0 + r], &y[k0]);
+    }
+    for(int i = k0 + w; i < n; ++i) {
+      y[i] -= kernel_dot(w, L[i], &y[k0]);
+    }
+  }
+
+  for(int K = A->npanels - 1; K >= 0; --K) {
+    const int k0 = K * A->nb, w = panel_width(A, K);
+    const double (*U)[w] = (const double (*)[w])panel(A, K);
+    if(K > 0) {
+      panel_advise(A, K - 1, MADV_WILLNEED);
+    }
+    for(int r = w - 1; r >= 0; --r) {
+      y[k0 + r] -= kernel_dot(w - r - 1, &U[k0 + r][r + 1], &y[k0 + r + 1]);
+      y[k0 + r] /= U[k0 + r][r];
+    }
+    for(int i = 0; i < k0; ++i) {
+      y[i] -= kernel_dot(w, U[i], &y[k0]);
+    }
+  }
+
+  memcpy(b, y, n * sizeof(double));
+  free(y);
+  return 0;
+}
@@ -0,0 +1,47 @@
+/*----------------------------------------------------------------
+* File:     gauss_ooc.h
+*----------------------------------------------------------------*/
+
+#ifndef GAUSS_OOC_H
+#define GAUSS_OOC_H
+
+#include <stddef.h>
+
+/* An n x n matrix kept in a file, for matrices larger than memory.
+   The file is divided into column panels of nb columns (the last one
+   may be narrower); each panel is stored contiguously, row by row, so
+   that a panel is read or written with sequential I/O. The file is
+   memory-mapped, and only two or three panels are resident at any time
+   during the factorization. */
+typedef struct gauss_ooc gauss_ooc;
+
+/* Panel width such that the working set of gauss_ooc_plu (one panel
+   being factored and two streamed panels) fits in mem_bytes. */
+int gauss_ooc_panel_width(int n, size_t mem_bytes);
+
+/* Create (or truncate) the file at path for an n x n matrix with panel
+   width nb, or open an existing one; the file size must match. Return
+   NULL on error, with errno set. */
+gauss_ooc *gauss_ooc_create(const char *path, int n, int nb);
+gauss_ooc *gauss_ooc_open(const char *path, int n, int nb);
+/* Unmap and close, after writing back all changes. */
+void gauss_ooc_close(gauss_ooc *A);
+
+/* Copy row i of the matrix in, or out. */
+void gauss_ooc_set_row(gauss_ooc *A, int i, const double row[]);
+void gauss_ooc_get_row(const gauss_ooc *A, int i, double row[]);
+
+/* PLU in place, with the P convention and the packed L\U output of
+   plu. Left-looking by panels: each panel in turn is loaded into
+   memory, updated with every panel to its left streamed from the file
+   (the next one is read ahead while the current one is used), factored
+   with plu_blocked_lda and written back. Returns 0, -1 if out of
+   memory, or k+1 if U[k][k] is exactly zero (the factorization
+   is then completed, but U is singular). */
+int gauss_ooc_plu(gauss_ooc *A, int P[]);
+
+/* Solve A x = b with the output of gauss_ooc_plu, streaming the panels
+   twice; b is overwritten with x. Returns 0 or -1 if out of memory. */
+int gauss_ooc_solve(const gauss_ooc *A, const int P[], double b[]);
+
+#endif
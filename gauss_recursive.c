@@ -0,0 +1,97 @@
+/*----------------------------------------------------------------
+* File:     gauss_recursive.c
+*----------------------------------------------------------------*/
+/* The triangular solve and the update are recursive as well, halving
+   the inner dimension until it fits the blocked kernels of
+   gauss_blocks.h, which keep a block of at most REC_KB rows of U in
+   cache. Every element still receives its updates in increasing order
+   of the inner index, as in plu, so the result is the same. */
+
+#include <stdlib.h>
+
+#include "gauss_solve.h"
+#include "gauss_blocks.h"
+#include "gauss_recursive.h"
+
+/* Narrowest column range that is split further. */
+#define REC_BASE 16
+/* Widest inner dimension handed to block_trsm_unit_lower and
+   block_gemm_update at once. */
+#define REC_KB 64
+
+/* Rows i0..m-1, columns j0..j1-1 -= L(:, k0..k0+kb-1) U(k0..k0+kb-1, :). */
+static void rec_gemm(int lda, double A[][lda], int i0, int m, int j0, int j1,
+		     int k0, int kb, int nt)
+{
+  if(kb <= REC_KB) {
+    block_gemm_update(lda, A, i0, m, j0, j1, k0, kb, nt);
+    return;
+  }
+  const int h = kb / 2;
+  rec_gemm(lda, A, i0, m, j0, j1, k0, h, nt);
+  rec_gemm(lda, A, i0, m, j0, j1, k0 + h, kb - h, nt);
+}
+
+/* Rows k0..k0+kb-1, columns j0..j1-1 := L11^{-1} times themselves. */
+static void rec_trsm(int lda, double A[][lda], int k0, int kb, int j0, int j1,
+		     int nt)
+{
+  if(kb <= REC_KB) {
+    block_trsm_unit_lower(lda, A, k0, kb, j0, j1, nt);
+    return;
+  }
+  const int h = kb / 2;
+  rec_trsm(lda, A, k0, h, j0, j1, nt);
+  rec_gemm(lda, A, k0 + h, k0 + kb, j0, j1, k0, h, nt);
+  rec_trsm(lda, A, k0 + h, kb - h, j0, j1, nt);
+}
+
+/* PLU of rows k0..m-1, columns k0..k0+w-1, with interchanges applied
+   within those columns only and recorded in ipiv[k0..k0+w-1]. */
+static int rec_plu(int lda, double A[][lda], int m, int k0, int w, int ipiv[],
+		   int nt)
+{
+  if(w <= REC_BASE) {
+    return block_plu_panel(lda, A, k0, w, m, &ipiv[k0]);
+  }
+  const int h = w / 2, k1 = k0 + h, j1 = k0 + w;
+  int info = rec_plu(lda, A, m, k0, h, ipiv, nt);
+  block_laswp(lda, A, k1, j1, k0, h, &ipiv[k0]);
+  rec_trsm(lda, A, k0, h, k1, j1, nt);
+  rec_gemm(lda, A, k1, m, k1, j1, k0, h, nt);
+  const int rinfo = rec_plu(lda, A, m, k1, w - h, ipiv, nt);
+  block_laswp(lda, A, k0, k1, k1, w - h, &ipiv[k1]);
+  return info ? info : rinfo;
+}
+
+int plu_recursive(int n, double A[n][n], int P[n])
+{
+  return plu_recursive_lda(n, n, n, A, P);
+}
+
+int plu_recursive_lda(int m, int n, int lda, double A[][lda], int P[m])
+{
+  const int nt = gauss_get_num_threads();
+  const int mn = m < n ? m : n;
+  int *ipiv = malloc((mn + 1) * sizeof(int));
+  if(!ipiv) {
+    /* Same factorization, without the scratch space. */
+    return plu_lda(m, n, lda, A, P);
+  }
+
+  const int info = rec_plu(lda, A, m, 0, mn, ipiv, nt);
+  if(n > mn) {
+    /* Wide matrix: the columns right of the square part become rows
+       of U. */
+    block_laswp(lda, A, mn, n, 0, mn, ipiv);
+    rec_trsm(lda, A, 0, mn, mn, n, nt);
+  }
+  for(int i = 0; i < m; ++i) {
+    P[i] = i;
+  }
+  for(int k = 0; k < mn; ++k) {
+    SWAP(P[k], P[ipiv[k]], int);
+  }
+  free(ipiv);
+  return info;
+}
@@ -0,0 +1,18 @@
+/*----------------------------------------------------------------
+* File:     gauss_recursive.h
+*----------------------------------------------------------------*/
+
+#ifndef GAUSS_RECURSIVE_H
+#define GAUSS_RECURSIVE_H
+
+/* Recursive PLU (Toledo): factor the left half of the columns, apply
+   its interchanges and update the right half, factor the right half,
+   then apply its interchanges to the left half. The halving produces
+   blocks of every size, so every level of the cache is used well
+   without a block size to tune. Same P convention, packed output and
+   return value as plu; plu_recursive_lda factors an m x n matrix as
+   plu_lda does. */
+int plu_recursive(int n, double A[n][n], int P[n]);
+int plu_recursive_lda(int m, int n, int lda, double A[][lda], int P[m]);
+
+#endif
@@ -0,0 +1,145 @@
+/*----------------------------------------------------------------
+* File:     gauss_robust.c
+*----------------------------------------------------------------*/
+/* Pivoting only as much as the matrix needs. Every method reports a
+   zero pivot through its return value, so a failed attempt costs one
+   factorization and nothing traps. */
+
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "gauss_solve.h"
+#include "gauss_arena.h"
+#include "gauss_kernels.h"
+#include "gauss_robust.h"
+
+int plu_complete(int n, double A[n][n], int P[n], int Q[n])
+{
+  for(int i = 0; i < n; ++i) {
+    P[i] = Q[i] = i;
+  }
+  for(int k = 0; k < n; ++k) {
+    int r = k, c = k;
+    double amax = 0;
+    for(int i = k; i < n; ++i) {
+      for(int j = k; j < n; ++j) {
+	if(fabs(A[i][j]) > amax) {
+	  amax = fabs(A[i][j]);
+	  r = i;
+	  c = j;
+	}
+      }
+    }
+    if(amax == 0) {
+      return k+1;
+    }
+    if(r != k) {
+      for(int j = 0; j < n; ++j) {
+	SWAP(A[k][j], A[r][j], double);
+      }
+      SWAP(P[k], P[r], int);
+    }
+    if(c != k) {
+      for(int i = 0; i < n; ++i) {
+	SWAP(A[i][k], A[i][c], double);
+      }
+      SWAP(Q[k], Q[c], int);
+    }
+    for(int i = k+1; i < n; ++i) {
+      A[i][k] /= A[k][k];
+      kernel_axpy(n-k-1, -A[i][k], &A[k][k+1], &A[i][k+1]);
+    }
+  }
+  return 0;
+}
+
+static double max_abs(int n, const double A[n][n])
+{
+  double m = 0;
+  for(int i = 0; i < n; ++i) {
+    for(int j = 0; j < n; ++j) {
+      m = fmax(m, fabs(A[i][j]));
+    }
+  }
+  return m;
+}
+
+/* Whether max|L| max|U| / amax for the packed factors, with the unit
+   diagonal of L counted, is within GAUSS_MAX_GROWTH. Without traps an
+   overflow shows up as inf or NaN, which fails the test too (fmax
+   would skip a NaN). */
+static int growth_ok(int n, const double LU[n][n], double amax)
+{
+  double lmax = 1, umax = 0;
+  for(int i = 0; i < n; ++i) {
+    for(int j = 0; j < n; ++j) {
+      const double a = fabs(LU[i][j]);
+      if(!(a <= DBL_MAX)) {
+	return 0;
+      }
+      if(j < i) {
+	lmax = fmax(lmax, a);
+      } else {
+	umax = fmax(umax, a);
+      }
+    }
+  }
+  return lmax * umax <= GAUSS_MAX_GROWTH * amax;
+}
+
+int gauss_solve_robust(int n, const double A[n][n], const double b[n],
+		       double x[n], int first, int *method)
+{
+  double (*LU)[n] = (double (*)[n])gauss_arena_scratch((size_t)n * n);
+  int *P = malloc((n + 1) * sizeof(int)), *Q = malloc((n + 1) * sizeof(int));
+  double *z = malloc((n + 1) * sizeof(double));
+  if(!LU || !P || !Q || !z) {
+    gauss_arena_release(NULL, (double *)LU);
+    free(P);
+    free(Q);
+    free(z);
+    return -1;
+  }
+  const double amax = max_abs(n, A);
+  int m = first > GAUSS_METHOD_NOPIV ? first : GAUSS_METHOD_NOPIV;
+  int info = 0;
+
+  for(;; ++m) {
+    memcpy(LU, A, sizeof(double[n][n]));
+    memcpy(z, b, n * sizeof(double));
+    if(m == GAUSS_METHOD_NOPIV) {
+      /* Growth is checked after the solve; the solve is the cheap part. */
+      if(gauss_solve_in_place(n, LU, z) == 0 && growth_ok(n, LU, amax)) {
+	break;
+      }
+    } else if(m == GAUSS_METHOD_PARTIAL) {
+      if(plu(n, LU, P) == 0 && growth_ok(n, LU, amax)) {
+	plu_solve(n, LU, P, 1, (double (*)[1])z);
+	break;
+      }
+    } else {
+      m = GAUSS_METHOD_COMPLETE;
+      info = plu_complete(n, LU, P, Q);
+      if(info == 0) {
+	plu_solve(n, LU, P, 1, (double (*)[1])z);
+	for(int j = 0; j < n; ++j) {
+	  x[Q[j]] = z[j];
+	}
+      }
+      break;
+    }
+  }
+  if(m != GAUSS_METHOD_COMPLETE) {
+    memcpy(x, z, n * sizeof(double));
+  }
+  if(method) {
+    *method = m;
+  }
+  gauss_arena_release(NULL, (double *)LU);
+  free(P);
+  free(Q);
+  free(z);
+  return info;
+}
@@ -0,0 +1,32 @@
+/*----------------------------------------------------------------
+* File:     gauss_robust.h
+*----------------------------------------------------------------*/
+
+#ifndef GAUSS_ROBUST_H
+#define GAUSS_ROBUST_H
+
+/* PAQ = LU with complete pivoting: at step k the entry of largest
+   magnitude in the trailing matrix is moved to (k,k). Row i of PAQ is
+   row P[i] of A and column j is column Q[j] of A; L\U are packed in A
+   as for plu. Returns 0, or k+1 if the trailing matrix of step k is
+   zero, i.e. A has rank k (the remaining steps are not done). */
+int plu_complete(int n, double A[n][n], int P[n], int Q[n]);
+
+/* Methods of gauss_solve_robust, from the cheapest. */
+#define GAUSS_METHOD_NOPIV    0	/* gauss_solve_in_place */
+#define GAUSS_METHOD_PARTIAL  1	/* plu */
+#define GAUSS_METHOD_COMPLETE 2	/* plu_complete */
+
+/* A factorization is rejected when max|L| max|U| / max|A| exceeds
+   this, which bounds its backward error by about 1e-10 n. */
+#define GAUSS_MAX_GROWTH 1e6
+
+/* Solve A x = b, trying the methods from first on until one has no
+   zero pivot and growth at most GAUSS_MAX_GROWTH; complete pivoting is
+   always accepted unless A is singular. A and b are not modified.
+   *method (if not NULL) receives the method used. Returns 0, k+1 if
+   complete pivoting found A to have rank k, or -1 if out of memory. */
+int gauss_solve_robust(int n, const double A[n][n], const double b[n],
+		       double x[n], int first, int *method);
+
+#endif
@@ -8,31 +8,103 @@
 *
 *----------------------------------------------------------------*/
 #include "gauss_solve.h"
+#include "gauss_blocks.h"
+#include "gauss_kernels.h"
+#include "gauss_fixed.h"
+#include "gauss_instrument.h"
 #include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
-void gauss_solve_in_place(const int n, double A[n][n], double b[n])
+/* Number of threads requested through gauss_set_num_threads, or 0 if
+   the GAUSS_NUM_THREADS environment variable or the OpenMP default
+   should be used. */
+static int gauss_num_threads = 0;
+
+void gauss_set_num_threads(int nthreads)
 {
+  gauss_num_threads = nthreads > 0 ? nthreads : 0;
+}
+
+int gauss_get_num_threads(void)
+{
+  if(gauss_num_threads > 0) {
+    return gauss_num_threads;
+  }
+  const char *env = getenv("GAUSS_NUM_THREADS");
+  if(env) {
+    int nthreads = atoi(env);
+    if(nthreads > 0) {
+      return nthreads;
+    }
+  }
+#ifdef _OPENMP
+  return omp_get_max_threads();
+#else
+  return 1;
+#endif
+}
+
+int gauss_solve_in_place(const int n, double A[n][n], double b[n])
+{
+  return gauss_solve_in_place_lda(n, n, A, b);
+}
+
+int gauss_solve_in_place_lda(int n, int lda, double A[][lda], double b[n])
+{
+  int info = 0;
+  if(gauss_solve_fixed(n, lda, &A[0][0], b, &info)) {
+    return info;
+  }
+  const int nt = gauss_get_num_threads();
+  (void)nt;
+  GAUSS_INSTR_BEGIN();
   for(int k = 0; k < n; ++k) {
+    if(A[k][k] == 0) {
+      info = k+1;
+      break;
+    }
+    /* Rows are updated independently, so the result does not depend
+       on the number of threads. */
+#pragma omp parallel for schedule(static) num_threads(nt) \
+  if(nt > 1 && (n-k) * (n-k) > PARALLEL_MIN_WORK)
     for(int i = k+1; i < n; ++i) {
       /* Store the multiplier into A[i][k] as it would become 0 and be
 	 useless */
       A[i][k] /= A[k][k];
-      for( int j = k+1; j < n; ++j) {
-	A[i][j] -= A[i][k] * A[k][j];
-      }
+      kernel_axpy(n-k-1, -A[i][k], &A[k][k+1], &A[i][k+1]);
       b[i] -= A[i][k] * b[k];
     }
+    GAUSS_INSTR_FLOPS((n-k-1) * (2.0 * (n-k) + 1));
   } /* End of Gaussian elimination, start back-substitution. */
-  for(int i = n-1; i >= 0; --i) {
-    for(int j = i+1; j<n; ++j) {
-      b[i] -= A[i][j] * b[j];
-    }
-    b[i] /= A[i][i];
-  } /* End of back-substitution. */
+  GAUSS_INSTR_PHASE(GAUSS_PHASE_UPDATE);
+  if(info == 0) {
+    for(int i = n-1; i >= 0; --i) {
+      b[i] -= kernel_dot(n-i-1, &A[i][i+1], &b[i+1]);
+      b[i] /= A[i][i];
+    } /* End of back-substitution. */
+    GAUSS_INSTR_PHASE(GAUSS_PHASE_SOLVE);
+    GAUSS_INSTR_FLOPS((double)n * n);
+  }
+  GAUSS_INSTR_END();
+  return info;
+}
+
+int lu_in_place(const int n, double A[n][n])
+{
+  return lu_in_place_lda(n, n, A);
 }
 
-void lu_in_place(const int n, double A[n][n])
+int lu_in_place_lda(int n, int lda, double A[][lda])
 {
+  int info = 0;
+  if(lu_fixed(n, lda, &A[0][0], &info)) {
+    return info;
+  }
+  GAUSS_INSTR_BEGIN();
   for(int k = 0; k < n; ++k) {
     for(int i = k; i < n; ++i) {
       for(int j=0; j<k; ++j) {
@@ -40,6 +112,10 @@ void lu_in_place(const int n, double A[n][n])
 	A[k][i] -=  A[k][j] * A[j][i]; 
       }
     }
+    if(A[k][k] == 0) {
+      info = k+1;
+      break;
+    }
     for(int i = k+1; i<n; ++i) {
       for(int j=0; j<k; ++j) {
 	/* L[i][k] -= A[i][k] * U[j][k] */
@@ -48,7 +124,201 @@ void lu_in_place(const int n, double A[n][n])
       /* L[k][k] /= U[k][k] */
       A[i][k] /= A[k][k];	
     }
+    GAUSS_INSTR_FLOPS(2.0 * k * (2 * (n-k) - 1) + (n-k-1));
+  }
+  GAUSS_INSTR_PHASE(GAUSS_PHASE_UPDATE);
+  GAUSS_INSTR_END();
+  return info;
+}
+
+/* Width of the column strips of the trailing update. The kb x
+   GEMM_JB block of U that is reused by every row of the trailing
+   matrix is at most 64 KB and stays in L2. */
+#define GEMM_JB 128
+
+/* Unblocked right-looking LU (no pivoting) of the panel made of rows
+   k0..m-1 and columns k0..k0+kb-1 of A. Stops at a zero pivot. */
+int block_lu_panel_nopiv(int lda, double A[][lda], int k0, int kb, int m)
+{
+  for(int k = k0; k < k0 + kb; ++k) {
+    if(A[k][k] == 0) {
+      return k+1;
+    }
+    for(int i = k+1; i < m; ++i) {
+      A[i][k] /= A[k][k];
+      kernel_axpy(k0 + kb - k - 1, -A[i][k], &A[k][k+1], &A[i][k+1]);
+    }
   }
+  return 0;
+}
+
+/* Overwrite rows k0..k0+kb-1, columns j0..j1-1 of A with
+   L11^{-1} times themselves, where L11 is the unit lower triangle
+   stored in rows and columns k0..k0+kb-1. */
+void block_trsm_unit_lower(int lda, double A[][lda], int k0, int kb,
+			   int j0, int j1, int nt)
+{
+  (void)nt;
+  /* Column strips are independent; each one is solved by one thread. */
+#pragma omp parallel for schedule(static) num_threads(nt) \
+  if(nt > 1 && kb * (j1 - j0) > PARALLEL_MIN_WORK)
+  for(int jj = j0; jj < j1; jj += GEMM_JB) {
+    const int je = jj + GEMM_JB < j1 ? jj + GEMM_JB : j1;
+    for(int r = k0 + 1; r < k0 + kb; ++r) {
+      for(int p = k0; p < r; ++p) {
+	kernel_axpy(je - jj, -A[r][p], &A[p][jj], &A[r][jj]);
+      }
+    }
+  }
+}
+
+/* Number of rows of the trailing matrix handed to a thread at once. */
+#define GEMM_IB 32
+
+/* Trailing update A[i][j] -= sum_p A[i][p] * A[p][j] for rows
+   i0..m-1, columns j0..j1-1 and p in k0..k0+kb-1. The columns are
+   processed in strips of GEMM_JB so that the block of U is reused
+   from cache by every row. The p loop runs in increasing order for
+   every element, exactly as in the unblocked algorithm, so the
+   result is the same for any number of threads nt. */
+void block_gemm_update(int lda, double A[][lda], int i0, int m,
+		       int j0, int j1, int k0, int kb, int nt)
+{
+  (void)nt;
+#pragma omp parallel for schedule(static) num_threads(nt) \
+  if(nt > 1 && (m - i0) * (j1 - j0) > PARALLEL_MIN_WORK)
+  for(int ii = i0; ii < m; ii += GEMM_IB) {
+    const int ie = ii + GEMM_IB < m ? ii + GEMM_IB : m;
+    for(int jj = j0; jj < j1; jj += GEMM_JB) {
+      const int je = jj + GEMM_JB < j1 ? jj + GEMM_JB : j1;
+      for(int i = ii; i < ie; ++i) {
+	for(int p = k0; p < k0 + kb; ++p) {
+	  kernel_axpy(je - jj, -A[i][p], &A[p][jj], &A[i][jj]);
+	}
+      }
+    }
+  }
+}
+
+int lu_blocked_in_place(const int n, double A[n][n], int nb)
+{
+  return lu_blocked_in_place_lda(n, n, A, nb);
+}
+
+int lu_blocked_in_place_lda(int n, int lda, double A[][lda], int nb)
+{
+  const int nt = gauss_get_num_threads();
+  if(nb <= 0) {
+    nb = LU_DEFAULT_NB;
+  }
+  for(int k0 = 0; k0 < n; k0 += nb) {
+    const int kb = k0 + nb < n ? nb : n - k0;
+    /* Factor the panel, then turn the rows of the panel to the right
+       of it into rows of U, then update the trailing matrix. */
+    const int info = block_lu_panel_nopiv(lda, A, k0, kb, n);
+    if(info) {
+      return info;
+    }
+    if(k0 + kb < n) {
+      block_trsm_unit_lower(lda, A, k0, kb, k0 + kb, n, nt);
+      block_gemm_update(lda, A, k0 + kb, n, k0 + kb, n, k0, kb, nt);
+    }
+  }
+  return 0;
+}
+
+/* Unblocked right-looking LU with partial pivoting of the panel made
+   of rows k0..m-1 and columns k0..k0+kb-1 of A. Row interchanges are
+   applied to the panel columns only; the pivot row chosen at step k
+   is recorded in ipiv[k-k0] so that the interchanges can be applied
+   to the rest of the matrix later by block_laswp. A column with no
+   nonzero candidate is left as it is; the first such k gives the
+   return value k+1 (0 if there is none). */
+int block_plu_panel(int lda, double A[][lda], int k0, int kb, int m,
+		    int ipiv[])
+{
+  int info = 0;
+  for(int k = k0; k < k0 + kb; ++k) {
+    int max_row = k;
+    for(int i = k+1; i < m; ++i) {
+      if(fabs(A[i][k]) > fabs(A[max_row][k])) {
+	max_row = i;
+      }
+    }
+    ipiv[k-k0] = max_row;
+    if(max_row != k) {
+      for(int j = k0; j < k0 + kb; ++j) {
+	SWAP(A[k][j], A[max_row][j], double);
+      }
+    }
+    if(A[k][k] == 0) {
+      if(info == 0) {
+	info = k+1;
+      }
+      continue;
+    }
+    for(int i = k+1; i < m; ++i) {
+      A[i][k] /= A[k][k];
+      kernel_axpy(k0 + kb - k - 1, -A[i][k], &A[k][k+1], &A[i][k+1]);
+    }
+  }
+  return info;
+}
+
+/* Apply the row interchanges recorded by block_plu_panel for rows
+   k0..k0+kb-1 to columns j0..j1-1 of A, in one pass. */
+void block_laswp(int lda, double A[][lda], int j0, int j1, int k0, int kb,
+		 const int ipiv[])
+{
+  for(int k = k0; k < k0 + kb; ++k) {
+    const int r = ipiv[k-k0];
+    if(r != k) {
+      for(int j = j0; j < j1; ++j) {
+	SWAP(A[k][j], A[r][j], double);
+      }
+    }
+  }
+}
+
+int plu_blocked(int n, double A[n][n], int P[n], int nb)
+{
+  return plu_blocked_lda(n, n, n, A, P, nb);
+}
+
+int plu_blocked_lda(int m, int n, int lda, double A[][lda], int P[m], int nb)
+{
+  int info = 0;
+  const int nt = gauss_get_num_threads();
+  const int mn = m < n ? m : n;
+  if(nb <= 0) {
+    nb = LU_DEFAULT_NB;
+  }
+  for(int i = 0; i < m; ++i) {
+    P[i] = i;
+  }
+
+  int ipiv[nb];
+  for(int k0 = 0; k0 < mn; k0 += nb) {
+    const int kb = k0 + nb < mn ? nb : mn - k0;
+    const int pinfo = block_plu_panel(lda, A, k0, kb, m, ipiv);
+    if(info == 0) {
+      info = pinfo;
+    }
+
+    /* Deferred row swaps: the columns left and right of the panel,
+       and the permutation vector. */
+    block_laswp(lda, A, 0, k0, k0, kb, ipiv);
+    block_laswp(lda, A, k0 + kb, n, k0, kb, ipiv);
+    for(int k = k0; k < k0 + kb; ++k) {
+      SWAP(P[k], P[ipiv[k-k0]], int);
+    }
+
+    if(k0 + kb < n) {
+      block_trsm_unit_lower(lda, A, k0, kb, k0 + kb, n, nt);
+      block_gemm_update(lda, A, k0 + kb, m, k0 + kb, n, k0, kb, nt);
+    }
+  }
+  return info;
 }
 
 void lu_in_place_reconstruct(int n, double A[n][n])
@@ -68,21 +338,39 @@ void lu_in_place_reconstruct(int n, double A[n][n])
   }
 }
 
-void plu(int n, double A[n][n], int P[n]) {
+int plu(int n, double A[n][n], int P[n]) {
+    return plu_lda(n, n, n, A, P);
+}
+
+int plu_lda(int m, int n, int lda, double A[][lda], int P[m]) {
+    int info = 0;
+
+    // Small sizes have unrolled kernels
+    if (m == n && plu_fixed(n, lda, &A[0][0], P, &info)) {
+        return info;
+    }
+
+    const int nt = gauss_get_num_threads();
+    (void)nt;
+    const int mn = m < n ? m : n;
+
     // Initialize permutation matrix P to the identity matrix
-    for (int i = 0; i < n; i++) {
+    for (int i = 0; i < m; i++) {
         P[i] = i;
     }
 
     // Perform Gaussian elimination with partial pivoting
-    for (int k = 0; k < n; k++) {
+    GAUSS_INSTR_BEGIN();
+    for (int k = 0; k < mn; k++) {
+        GAUSS_INSTR_MARK();
         // Find the row with the maximum pivot value
         int max_row = k;
-        for (int i = k + 1; i < n; i++) {
+        for (int i = k + 1; i < m; i++) {
             if (fabs(A[i][k]) > fabs(A[max_row][k])) {
                 max_row = i;
             }
         }
+        GAUSS_INSTR_PHASE(GAUSS_PHASE_PIVOT);
 
         // Swap rows in matrix A and update the permutation array P
         if (max_row != k) {
@@ -98,14 +386,138 @@ void plu(int n, double A[n][n], int P[n]) {
             P[k] = P[max_row];
             P[max_row] = temp;
         }
+        GAUSS_INSTR_PHASE(GAUSS_PHASE_SWAP);
 
-        // Perform Gaussian elimination
-        for (int i = k + 1; i < n; i++) {
+        // A zero column below the diagonal: nothing to eliminate
+        if (A[k][k] == 0) {
+            if (info == 0) {
+                info = k + 1;
+            }
+            continue;
+        }
+
+        // Perform Gaussian elimination; the rows are independent
+#pragma omp parallel for schedule(static) num_threads(nt) \
+    if(nt > 1 && (m - k) * (n - k) > PARALLEL_MIN_WORK)
+        for (int i = k + 1; i < m; i++) {
             A[i][k] /= A[k][k];  // Store the multiplier (L_ik)
 
-            for (int j = k + 1; j < n; j++) {
-                A[i][j] -= A[i][k] * A[k][j];  // Update the U matrix
-            }
+            // Update the U matrix
+            kernel_axpy(n - k - 1, -A[i][k], &A[k][k + 1], &A[i][k + 1]);
         }
+        GAUSS_INSTR_PHASE(GAUSS_PHASE_UPDATE);
+        GAUSS_INSTR_FLOPS((m - k - 1) * (2.0 * (n - k - 1) + 1));
     }
+    GAUSS_INSTR_END();
+    return info;
+}
+
+/* B[i][j] -= sum_p T[i][p] * B[p][j] for rows i0..i1-1 of B, all nrhs
+   columns, and p in k0..k1-1: the update of the rows of B outside a
+   block of the triangular solve that has just finished. */
+static void solve_update(int n, const double T[n][n], int nrhs,
+			 double B[n][nrhs], int i0, int i1, int k0, int k1,
+			 int nt)
+{
+  (void)nt;
+#pragma omp parallel for schedule(static) num_threads(nt) \
+  if(nt > 1 && (i1 - i0) * nrhs > PARALLEL_MIN_WORK)
+  for(int ii = i0; ii < i1; ii += GEMM_IB) {
+    const int ie = ii + GEMM_IB < i1 ? ii + GEMM_IB : i1;
+    for(int jj = 0; jj < nrhs; jj += GEMM_JB) {
+      const int jb = jj + GEMM_JB < nrhs ? GEMM_JB : nrhs - jj;
+      for(int i = ii; i < ie; ++i) {
+	for(int p = k0; p < k1; ++p) {
+	  kernel_axpy(jb, -T[i][p], &B[p][jj], &B[i][jj]);
+	}
+      }
+    }
+  }
+}
+
+/* B := P B without scratch space, for plu_solve when out of memory:
+   each cycle of P is rotated by row swaps, starting from its smallest
+   index, which is found by walking the cycle (O(n^2) steps at worst). */
+static void permute_rows_noscratch(int n, const int P[n], int nrhs,
+				   double B[n][nrhs])
+{
+  for(int s = 0; s < n; ++s) {
+    int i = P[s];
+    while(i > s) {
+      i = P[i];
+    }
+    if(i < s) {
+      continue;
+    }
+    for(i = s; P[i] != s; i = P[i]) {
+      for(int j = 0; j < nrhs; ++j) {
+	SWAP(B[i][j], B[P[i]][j], double);
+      }
+    }
+  }
+}
+
+void plu_solve(int n, const double LU[n][n], const int P[n], int nrhs,
+	       double B[n][nrhs])
+{
+  const int nt = gauss_get_num_threads();
+  const int nb = LU_DEFAULT_NB;
+  GAUSS_INSTR_BEGIN();
+
+  /* B := P B, following the cycles of the permutation so that only
+     one row of scratch space is needed. */
+  if(P) {
+    char *done = calloc(n + 1, 1);
+    double *tmp = malloc((nrhs + 1) * sizeof(double));
+    if(!done || !tmp) {
+      permute_rows_noscratch(n, P, nrhs, B);
+    }
+    for(int s = 0; done && tmp && s < n; ++s) {
+      if(done[s] || P[s] == s) {
+	continue;
+      }
+      memcpy(tmp, B[s], nrhs * sizeof(double));
+      int i = s;
+      while(P[i] != s) {
+	memcpy(B[i], B[P[i]], nrhs * sizeof(double));
+	done[i] = 1;
+	i = P[i];
+      }
+      memcpy(B[i], tmp, nrhs * sizeof(double));
+      done[i] = 1;
+    }
+    free(tmp);
+    free(done);
+  }
+  GAUSS_INSTR_PHASE(GAUSS_PHASE_SWAP);
+
+  /* Forward substitution with the unit lower triangle L, one block of
+     nb rows at a time; each finished block updates the rows below it
+     as a matrix-matrix product. */
+  for(int k0 = 0; k0 < n; k0 += nb) {
+    const int k1 = k0 + nb < n ? k0 + nb : n;
+    for(int r = k0 + 1; r < k1; ++r) {
+      for(int p = k0; p < r; ++p) {
+	kernel_axpy(nrhs, -LU[r][p], B[p], B[r]);
+      }
+    }
+    solve_update(n, LU, nrhs, B, k1, n, k0, k1, nt);
+  }
+
+  /* Back substitution with U, from the last block up. */
+  for(int k1 = n; k1 > 0; k1 -= nb) {
+    const int k0 = k1 - nb > 0 ? k1 - nb : 0;
+    for(int r = k1 - 1; r >= k0; --r) {
+      for(int p = r + 1; p < k1; ++p) {
+	kernel_axpy(nrhs, -LU[r][p], B[p], B[r]);
+      }
+      for(int j = 0; j < nrhs; ++j) {
+	B[r][j] /= LU[r][r];
+      }
+    }
+    solve_update(n, LU, nrhs, B, 0, k0, k0, k1, nt);
+  }
+  GAUSS_INSTR_PHASE(GAUSS_PHASE_SOLVE);
+  GAUSS_INSTR_FLOPS(2.0 * n * n * nrhs);
+  GAUSS_INSTR_END();
 }
@@ -24,9 +24,57 @@
   } while(0)
 
 
-void gauss_solve_in_place(const int n, double A[n][n], double b[n]);
-void lu_in_place(const int n, double A[n][n]);
+/* Number of threads used by the kernels when the library is built
+   with OpenMP (libgauss_omp.so). A value <= 0 restores the default,
+   taken from the GAUSS_NUM_THREADS environment variable or else from
+   OpenMP. Results are bitwise identical for any thread count. */
+void gauss_set_num_threads(int nthreads);
+int  gauss_get_num_threads(void);
+
+/* The kernels do not fork threads for updates of fewer elements than
+   this. */
+#define PARALLEL_MIN_WORK 16384
+
+/* The factorizations and gauss_solve_in_place return a status rather
+   than dividing by a zero pivot: 0 on success, or k+1 if the pivot of
+   step k (0-based) is exactly zero. Without pivoting (gauss_solve_in_place,
+   lu_in_place, lu_blocked_in_place) they stop there, leaving A partly
+   reduced and b unsolved. With partial pivoting (plu, plu_blocked) a
+   zero pivot means the column is zero below the diagonal; the step is
+   skipped and the factorization completed, with U singular, and the
+   first such k is reported. */
+int  gauss_solve_in_place(const int n, double A[n][n], double b[n]);
+int  lu_in_place(const int n, double A[n][n]);
+/* Cache-blocked variant of lu_in_place with panel width nb (nb <= 0
+   selects a default). Produces the same packed L\U layout. */
+int  lu_blocked_in_place(const int n, double A[n][n], int nb);
 void lu_in_place_reconstruct(int n, double A[n][n]);
-void plu(int n, double A[n][n], int P[n]);
+int  plu(int n, double A[n][n], int P[n]);
+/* Blocked (getrf-style) variant of plu with panel width nb (nb <= 0
+   selects a default). Same P convention and packed output as plu. */
+int  plu_blocked(int n, double A[n][n], int P[n], int nb);
+
+/* Variants of the above on matrices stored with an explicit leading
+   dimension lda >= n (the row stride, in elements): element (i,j) is
+   A[i][j] = (&A[0][0])[i * lda + j]. They operate in place on a
+   submatrix of a bigger matrix, a tile, or a padded allocation from
+   gauss_arena_alloc, with the same results as the n x n versions.
+   plu_lda and plu_blocked_lda factor an m x n matrix (getrf-style):
+   min(m,n) elimination steps with pivots searched among all m rows, P
+   of length m, L unit lower trapezoidal m x min(m,n) and U upper
+   trapezoidal min(m,n) x n, packed in A. */
+int gauss_solve_in_place_lda(int n, int lda, double A[][lda], double b[n]);
+int lu_in_place_lda(int n, int lda, double A[][lda]);
+int lu_blocked_in_place_lda(int n, int lda, double A[][lda], int nb);
+int plu_lda(int m, int n, int lda, double A[][lda], int P[m]);
+int plu_blocked_lda(int m, int n, int lda, double A[][lda], int P[m],
+		    int nb);
+
+/* Solve A X = B for nrhs right-hand sides at once, given the packed
+   L\U of A computed by plu (with its P) or by lu_in_place (P == NULL).
+   B is n x nrhs and is overwritten with X; LU is not modified, so it
+   can be reused for any number of solves. */
+void plu_solve(int n, const double LU[n][n], const int P[n], int nrhs,
+	       double B[n][nrhs]);
 
 #endif
@@ -9,9 +9,68 @@
 #----------------------------------------------------------------
 # A Python wrapper module around the C library libgauss.so
 
+import array
 import ctypes
+import os
+import sys
+import threading
 
-gauss_library_path = './libgauss.so'
+# Set GAUSS_LIBRARY=./libgauss_omp.so to use the threaded build
+gauss_library_path = os.environ.get('GAUSS_LIBRARY', './libgauss.so')
+
+# The compiled extension built by "make ext", if present: the same
+# factorizations on buffers with less call overhead
+try:
+    import _gauss
+except ImportError:
+    _gauss = None
+
+_lib = None
+_lib_lock = threading.Lock()
+
+def _library():
+    """ Return the library, loaded on first use with every signature
+    declared once. Calls through ctypes.CDLL release the GIL, so Python
+    threads may factor different matrices concurrently.
+    """
+    global _lib
+    if _lib is not None:
+        return _lib
+    with _lib_lock:
+        if _lib is None:
+            _lib = _load_library()
+    return _lib
+
+def _load_library():
+    c_int, c_void_p = ctypes.c_int, ctypes.c_void_p
+    p_double = ctypes.POINTER(ctypes.c_double)
+    p_int = ctypes.POINTER(ctypes.c_int)
+    lib = ctypes.CDLL(gauss_library_path)
+    lib.gauss_set_num_threads.argtypes = (c_int,)
+    lib.lu_in_place.argtypes = (c_int, p_double)
+    lib.plu.argtypes = (c_int, p_double, p_int)
+    lib.gauss_solve_in_place.argtypes = (c_int, p_double, p_double)
+    lib.gauss_cache_create.restype = c_void_p
+    lib.gauss_cache_create.argtypes = (ctypes.c_size_t,)
+    lib.gauss_cache_destroy.argtypes = (c_void_p,)
+    lib.gauss_cache_solve.argtypes = (c_void_p, ctypes.c_uint64, c_int,
+                                      p_double, c_int, p_double)
+    lib.gauss_cache_get_stats.argtypes = (c_void_p, c_void_p)
+    lib.gauss_stats_get.argtypes = (c_void_p,)
+    return lib
+
+def _check(status):
+    """ Raise ValueError for a nonzero status of lu_in_place, plu or
+    gauss_solve_in_place (k+1 for a zero pivot at step k). """
+    if status != 0:
+        raise ValueError("Singular matrix: zero pivot at step %d"
+                         % (status - 1))
+
+def set_num_threads(nthreads):
+    """ Set the number of threads used by the threaded build of the
+    library; nthreads <= 0 restores the default (GAUSS_NUM_THREADS).
+    """
+    _library().gauss_set_num_threads(nthreads)
 
 def unpack(A):
     """ Extract L and U parts from A, fill with 0's and 1's """
@@ -28,8 +87,7 @@ def lu_c(A):
     """ Accepts a list of lists A of floats and
     it returns (L, U) - the LU-decomposition as a tuple.
     """
-    # Load the shared library
-    lib = ctypes.CDLL(gauss_library_path)
+    lib = _library()
 
     # Create a 2D array in Python and flatten it
     n = len(A)
@@ -38,11 +96,8 @@ def lu_c(A):
     # Convert to a ctypes array
     c_array_2d = (ctypes.c_double * len(flat_array_2d))(*flat_array_2d)
 
-    # Define the function signature
-    lib.lu_in_place.argtypes = (ctypes.c_int, ctypes.POINTER(ctypes.c_double))
-
     # Modify the array in C (e.g., add 10 to each element)
-    lib.lu_in_place(n, c_array_2d)
+    _check(lib.lu_in_place(n, c_array_2d))
 
     # Convert back to a 2D Python list of lists
     modified_array_2d = [
@@ -98,7 +153,7 @@ def plu_python(A):
 
 def plu_c(A):
     """C implementation of PA=LU decomposition."""
-    lib = ctypes.CDLL(gauss_library_path)
+    lib = _library()
     n = len(A)
     flat_array_2d = [item for row in A for item in row]
     c_array_2d = (ctypes.c_double * len(flat_array_2d))(*flat_array_2d)
@@ -106,11 +161,8 @@ def plu_c(A):
     # Create an array for the permutation vector P
     P = (ctypes.c_int * n)()
 
-    # Define the function signature
-    lib.plu.argtypes = (ctypes.c_int, ctypes.POINTER(ctypes.c_double), ctypes.POINTER(ctypes.c_int))
-    
     # Call the C function
-    lib.plu(n, c_array_2d, P)
+    _check(lib.plu(n, c_array_2d, P))
     
     # Convert the modified A matrix and P array back to Python structures
     modified_array_2d = [[c_array_2d[i * n + j] for j in range(n)] for i in range(n)]
@@ -126,6 +178,163 @@ def plu(A, use_c=False):
     else:
         return plu_python(A)
 
+class PackedLower:
+    """ Read-only view of the unit lower triangle L stored in a packed
+    L\\U buffer; nothing is copied. L[i, j] and L[i][j] both work.
+    """
+    def __init__(self, flat, n):
+        self.flat, self.n = flat, n
+
+    def __len__(self):
+        return self.n
+
+    def __getitem__(self, index):
+        if isinstance(index, tuple):
+            i, j = index
+            return self.flat[i * self.n + j] if j < i else float(i == j)
+        return [self[index, j] for j in range(self.n)]
+
+    def tolist(self):
+        return [self[i] for i in range(self.n)]
+
+class PackedUpper(PackedLower):
+    """ Read-only view of the upper triangle U of a packed L\\U buffer. """
+    def __getitem__(self, index):
+        if isinstance(index, tuple):
+            i, j = index
+            return self.flat[i * self.n + j] if j >= i else 0.0
+        return [self[index, j] for j in range(self.n)]
+
+def _format(mv):
+    """ The struct format of mv without a native byte order prefix. """
+    native = '@=' + ('<' if sys.byteorder == 'little' else '>')
+    fmt = mv.format
+    return fmt[1:] if fmt[:1] and fmt[0] in native else fmt
+
+def _as_flat(A):
+    """ Return (flat float64 memoryview, n) for a writable C-contiguous
+    n x n (or flat n*n) float64 buffer. """
+    mv = memoryview(A)
+    if _format(mv) != 'd' or not mv.c_contiguous or mv.readonly:
+        raise TypeError("need a writable C-contiguous float64 buffer")
+    flat = mv.cast('B').cast('d')
+    if mv.ndim == 2 and mv.shape[0] == mv.shape[1]:
+        n = mv.shape[0]
+    else:
+        n = int(round(len(flat) ** 0.5))
+    if n * n != len(flat):
+        raise ValueError("buffer does not hold a square matrix")
+    return flat, n
+
+def _pointer(flat, ctype=ctypes.c_double):
+    """ ctypes pointer to the memory of flat, without a copy. """
+    return (ctype * len(flat)).from_buffer(flat)
+
+def lu_buffer(A):
+    """ LU-decomposition in place of a C-contiguous float64 buffer A
+    (NumPy array, array.array('d') or memoryview) without copying it.
+    Returns (L, U) as views into A.
+    """
+    flat, n = _as_flat(A)
+    if _gauss:
+        _gauss.lu_in_place(flat)
+    else:
+        _check(_library().lu_in_place(n, _pointer(flat)))
+    return PackedLower(flat, n), PackedUpper(flat, n)
+
+def plu_buffer(A, P=None):
+    """ PA=LU in place of a C-contiguous float64 buffer A without copying
+    it. P, if given, is a writable int32 buffer of length n that receives
+    the permutation; otherwise an array.array('i') is returned.
+    Returns (P, L, U) with L and U views into A.
+    """
+    flat, n = _as_flat(A)
+    if P is None:
+        P = array.array('i', bytes(n * ctypes.sizeof(ctypes.c_int)))
+    p = memoryview(P)
+    if (_format(p) != 'i' or p.itemsize != ctypes.sizeof(ctypes.c_int)
+            or not p.c_contiguous or p.readonly):
+        raise TypeError("P must be a writable C-contiguous int32 buffer")
+    p = p.cast('B').cast('i')
+    if len(p) != n:
+        raise ValueError("P must have length n")
+    if _gauss:
+        _gauss.plu(flat, p)
+    else:
+        _check(_library().plu(n, _pointer(flat), _pointer(p, ctypes.c_int)))
+    return P, PackedLower(flat, n), PackedUpper(flat, n)
+
+class FactorCache:
+    """ An LRU cache of PLU factorizations held by the C library, for
+    callers that solve with the same matrices again and again.
+    """
+    def __init__(self, max_bytes=64 << 20):
+        self.lib = _library()
+        self.cache = self.lib.gauss_cache_create(max_bytes)
+        if not self.cache:
+            raise MemoryError("gauss_cache_create failed")
+
+    def __del__(self):
+        if getattr(self, 'cache', None):
+            self.lib.gauss_cache_destroy(self.cache)
+            self.cache = None
+
+    def solve(self, A, b, key=0):
+        """ Solve A x = b and return x as a list. key = 0 identifies A by
+        a hash of its contents; any other key is trusted to always come
+        with the same A.
+        """
+        n = len(A)
+        c_A = (ctypes.c_double * (n * n))(*[a for row in A for a in row])
+        c_b = (ctypes.c_double * n)(*b)
+        status = self.lib.gauss_cache_solve(self.cache, key, n, c_A, 1, c_b)
+        if status == -1:
+            raise MemoryError("gauss_cache_solve failed")
+        if status < -1:
+            raise ValueError("Singular matrix: zero pivot at step %d"
+                             % (-2 - status))
+        return list(c_b)
+
+    def stats(self):
+        """ Return the counters as a dict. """
+        class Stats(ctypes.Structure):
+            _fields_ = [('hits', ctypes.c_long), ('misses', ctypes.c_long),
+                        ('evictions', ctypes.c_long),
+                        ('entries', ctypes.c_long), ('bytes', ctypes.c_size_t)]
+        s = Stats()
+        self.lib.gauss_cache_get_stats(self.cache, ctypes.byref(s))
+        return {name: getattr(s, name) for name, _ in Stats._fields_}
+
+_PHASES = ('pivot', 'swap', 'update', 'solve')
+
+class _Stats(ctypes.Structure):
+    _fields_ = [('calls', ctypes.c_longlong),
+                ('seconds', ctypes.c_double * len(_PHASES)),
+                ('flops', ctypes.c_double), ('have_counters', ctypes.c_int),
+                ('cycles', ctypes.c_longlong),
+                ('instructions', ctypes.c_longlong),
+                ('llc_misses', ctypes.c_longlong)]
+
+def stats():
+    """ Totals recorded by a library built with make INSTRUMENT=1, as a
+    dict with the seconds per phase under 'seconds', or None for a
+    library built without instrumentation. The hardware counters are
+    None when they could not be read.
+    """
+    s = _Stats()
+    if _library().gauss_stats_get(ctypes.byref(s)) != 0:
+        return None
+    counters = ('cycles', 'instructions', 'llc_misses')
+    d = {'calls': s.calls, 'flops': s.flops,
+         'seconds': dict(zip(_PHASES, s.seconds))}
+    for name in counters:
+        d[name] = getattr(s, name) if s.have_counters else None
+    return d
+
+def reset_stats():
+    """ Zero the totals returned by stats(). """
+    _library().gauss_stats_reset()
+
 if __name__ == "__main__":
 
     def get_A():
@@ -147,3 +356,65 @@ if __name__ == "__main__":
     L, U = lu(A, use_c=True)
     print(L)
     print(U)
+
+    set_num_threads(2)
+    P, L, U = plu(get_A(), use_c=True)
+    assert (P, L, U) == plu(get_A(), use_c=False)
+    set_num_threads(0)
+
+    cache = FactorCache()
+    for _ in range(2):
+        x = cache.solve(get_A(), [1.0, 2.0, 3.0])
+    r = [sum(a * xj for a, xj in zip(row, x)) for row in get_A()]
+    assert max(abs(ri - bi) for ri, bi in zip(r, [1.0, 2.0, 3.0])) < 1e-12
+    assert cache.stats()['hits'] == 1 and cache.stats()['misses'] == 1
+
+    # Zero-copy path on a flat buffer; results agree with the list path
+    buf = array.array('d', [a for row in get_A() for a in row])
+    P, L, U = plu_buffer(buf)
+    assert (list(P), L.tolist(), U.tolist()) == plu(get_A(), use_c=True)
+    buf = array.array('d', [a for row in get_A() for a in row])
+    L, U = lu_buffer(memoryview(buf))
+    assert (L.tolist(), U.tolist()) == lu(get_A(), use_c=True)
+
+    # P must be an int32 buffer; a zero pivot raises on every path
+    buf = array.array('d', [a for row in get_A() for a in row])
+    for bad in (array.array('f', [0.0] * 3), array.array('i', [0] * 4)):
+        try:
+            plu_buffer(buf, bad)
+            assert False
+        except (TypeError, ValueError):
+            pass
+    S = [[0.0, 1.0, 2.0], [0.0, 3.0, 4.0], [0.0, 5.0, 7.0]]
+    for f in (lambda: plu([row[:] for row in S], use_c=True),
+              lambda: lu([row[:] for row in S], use_c=True),
+              lambda: plu_buffer(array.array('d', sum(S, []))),
+              lambda: lu_buffer(array.array('d', sum(S, [])))):
+        try:
+            f()
+            assert False
+        except ValueError as e:
+            assert 'step 0' in str(e)
+
+    # Factor several matrices from concurrent threads
+    bufs = [array.array('d', [a + t for row in get_A() for a in row])
+            for t in range(4)]
+    results = [None] * len(bufs)
+    def work(t):
+        P, L, U = plu_buffer(bufs[t])
+        results[t] = (list(P), L.tolist(), U.tolist())
+    threads = [threading.Thread(target=work, args=(t,)) for t in range(4)]
+    for th in threads:
+        th.start()
+    for th in threads:
+        th.join()
+    for t in range(4):
+        A = [[a + t for a in row] for row in get_A()]
+        assert results[t] == plu(A, use_c=True)
+
+    # Instrumentation, if the library was built with it
+    reset_stats()
+    plu([[float((3 * i + j) % 11) + (i == j) * 20 for j in range(20)]
+         for i in range(20)], use_c=True)
+    s = stats()
+    assert s is None or (s['calls'] == 1 and s['flops'] > 0)
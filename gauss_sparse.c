@@ -0,0 +1,657 @@
+/*----------------------------------------------------------------
+* File:     gauss_sparse.c
+*----------------------------------------------------------------*/
+/* Sparse LU. The column ordering is computed from the pattern alone;
+   the numeric factorization is left-looking, one column at a time:
+   column k of L and U is the solution of a sparse triangular system
+   with the first k columns of L, whose nonzero pattern is found by a
+   depth-first search in the graph of L (Gilbert and Peierls), so the
+   work is proportional to the arithmetic. */
+
+#include <limits.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "gauss_sparse.h"
+
+struct gauss_sparse_symbolic {
+  int n, nnz;
+  int *Q;			/* Column k of A Q is column Q[k] of A */
+};
+
+struct gauss_sparse_numeric {
+  int n;
+  double tol;
+  int *Lp, *Li;			/* L by columns, unit diagonal first */
+  double *Lx;
+  int *Up, *Ui;			/* U by columns, sorted, diagonal last */
+  double *Ux;
+  int *pinv;			/* Row i of A is row pinv[i] of P A */
+  int *P;			/* The inverse of pinv */
+  double *x;			/* Dense work vector of refactor, kept zero */
+};
+
+gauss_sparse *gauss_sparse_create(int n, int nnz)
+{
+  gauss_sparse *A = calloc(1, sizeof(*A));
+  if(!A) {
+    return NULL;
+  }
+  A->n = n;
+  A->nnz = nnz;
+  A->ptr = calloc(n + 1, sizeof(int));
+  A->ind = malloc(((size_t)nnz + 1) * sizeof(int));
+  A->val = malloc(((size_t)nnz + 1) * sizeof(double));
+  if(!A->ptr || !A->ind || !A->val) {
+    gauss_sparse_destroy(A);
+    return NULL;
+  }
+  return A;
+}
+
+void gauss_sparse_destroy(gauss_sparse *A)
+{
+  if(A) {
+    free(A->ptr);
+    free(A->ind);
+    free(A->val);
+    free(A);
+  }
+}
+
+gauss_sparse *gauss_sparse_from_dense(int n, const double A[n][n])
+{
+  int nnz = 0;
+  for(int i = 0; i < n; ++i) {
+    for(int j = 0; j < n; ++j) {
+      nnz += A[i][j] != 0;
+    }
+  }
+  gauss_sparse *S = gauss_sparse_create(n, nnz);
+  if(!S) {
+    return NULL;
+  }
+  int p = 0;
+  for(int j = 0; j < n; ++j) {
+    S->ptr[j] = p;
+    for(int i = 0; i < n; ++i) {
+      if(A[i][j] != 0) {
+	S->ind[p] = i;
+	S->val[p++] = A[i][j];
+      }
+    }
+  }
+  S->ptr[n] = p;
+  return S;
+}
+
+/* Transpose of the n x n compressed matrix (p, i, x) into (tp, ti,
+   tx); tx may be NULL for the pattern only. The output indices come
+   out sorted. */
+static void csc_transpose(int n, const int *p, const int *i, const double *x,
+			  int *tp, int *ti, double *tx)
+{
+  /* Count row r into tp[r+2], so that after the prefix sum tp[r+1] is
+     the start of row r and serves as its insertion point; once filled,
+     tp[r+1] is the end of row r, as required. */
+  memset(tp, 0, (n + 1) * sizeof(int));
+  for(int q = 0; q < p[n]; ++q) {
+    if(i[q] + 2 <= n) {
+      ++tp[i[q] + 2];
+    }
+  }
+  for(int r = 2; r <= n; ++r) {
+    tp[r] += tp[r-1];
+  }
+  for(int c = 0; c < n; ++c) {
+    for(int q = p[c]; q < p[c+1]; ++q) {
+      const int dst = tp[i[q] + 1]++;
+      ti[dst] = c;
+      if(tx) {
+	tx[dst] = x[q];
+      }
+    }
+  }
+}
+
+gauss_sparse *gauss_sparse_transpose(const gauss_sparse *A)
+{
+  gauss_sparse *T = gauss_sparse_create(A->n, A->nnz);
+  if(T) {
+    csc_transpose(A->n, A->ptr, A->ind, A->val, T->ptr, T->ind, T->val);
+  }
+  return T;
+}
+
+void gauss_sparse_matvec(const gauss_sparse *A, const double x[], double y[])
+{
+  for(int i = 0; i < A->n; ++i) {
+    y[i] = 0;
+  }
+  for(int j = 0; j < A->n; ++j) {
+    for(int p = A->ptr[j]; p < A->ptr[j+1]; ++p) {
+      y[A->ind[p]] += A->val[p] * x[j];
+    }
+  }
+}
+
+/* Minimum degree ordering of the graph of A + A^T, on the explicit
+   elimination graph: eliminating a node joins its neighbours into a
+   clique. This is the greedy rule of AMD without its quotient graph
+   and approximate degrees, which only matter for speed on very large
+   problems. */
+static int mindeg_order(const gauss_sparse *A, int Q[])
+{
+  const int n = A->n;
+  int *tp = malloc((n + 1) * sizeof(int));
+  int *ti = malloc(((size_t)A->nnz + 1) * sizeof(int));
+  int **adj = calloc(n, sizeof(int *));
+  int *len = calloc(n, sizeof(int)), *cap = calloc(n, sizeof(int));
+  int *mark = malloc(n * sizeof(int)), *nbr = malloc(n * sizeof(int));
+  int *head = malloc(n * sizeof(int)), *next = malloc(n * sizeof(int));
+  int *prev = malloc(n * sizeof(int));
+  char *elim = calloc(n, 1);
+  int status = -1;
+  if(!tp || !ti || !adj || !len || !cap || !mark || !nbr || !head || !next
+     || !prev || !elim) {
+    goto out;
+  }
+  csc_transpose(n, A->ptr, A->ind, NULL, tp, ti, NULL);
+
+  int stamp = 0;
+  for(int v = 0; v < n; ++v) {
+    mark[v] = -1;
+  }
+  for(int v = 0; v < n; ++v) {
+    const int na = A->ptr[v+1] - A->ptr[v], nt = tp[v+1] - tp[v];
+    cap[v] = na + nt > 0 ? na + nt : 1;
+    if(!(adj[v] = malloc(cap[v] * sizeof(int)))) {
+      goto out;
+    }
+    mark[v] = ++stamp;
+    for(int p = A->ptr[v]; p < A->ptr[v+1]; ++p) {
+      const int u = A->ind[p];
+      if(mark[u] != stamp) {
+	mark[u] = stamp;
+	adj[v][len[v]++] = u;
+      }
+    }
+    for(int p = tp[v]; p < tp[v+1]; ++p) {
+      const int u = ti[p];
+      if(mark[u] != stamp) {
+	mark[u] = stamp;
+	adj[v][len[v]++] = u;
+      }
+    }
+  }
+
+  /* Buckets of nodes by degree, as doubly linked lists. */
+  for(int d = 0; d < n; ++d) {
+    head[d] = -1;
+  }
+#define BUCKET_INSERT(v) do {					\
+    const int d_ = len[v];					\
+    prev[v] = -1;						\
+    next[v] = head[d_];						\
+    if(head[d_] >= 0) {						\
+      prev[head[d_]] = v;					\
+    }								\
+    head[d_] = v;						\
+  } while(0)
+#define BUCKET_REMOVE(v) do {					\
+    if(prev[v] >= 0) {						\
+      next[prev[v]] = next[v];					\
+    } else {							\
+      head[len[v]] = next[v];					\
+    }								\
+    if(next[v] >= 0) {						\
+      prev[next[v]] = prev[v];					\
+    }								\
+  } while(0)
+  for(int v = 0; v < n; ++v) {
+    BUCKET_INSERT(v);
+  }
+
+  int mindeg = 0;
+  for(int k = 0; k < n; ++k) {
+    while(head[mindeg] < 0) {
+      ++mindeg;
+    }
+    const int v = head[mindeg];
+    BUCKET_REMOVE(v);
+    elim[v] = 1;
+    Q[k] = v;
+
+    int nn = 0;
+    for(int p = 0; p < len[v]; ++p) {
+      if(!elim[adj[v][p]]) {
+	nbr[nn++] = adj[v][p];
+      }
+    }
+    for(int s = 0; s < nn; ++s) {
+      const int u = nbr[s];
+      BUCKET_REMOVE(u);
+      mark[u] = ++stamp;
+      int l = 0;
+      for(int p = 0; p < len[u]; ++p) {
+	const int w = adj[u][p];
+	if(!elim[w] && mark[w] != stamp) {
+	  mark[w] = stamp;
+	  adj[u][l++] = w;
+	}
+      }
+      for(int t = 0; t < nn; ++t) {
+	const int w = nbr[t];
+	if(mark[w] == stamp) {
+	  continue;
+	}
+	mark[w] = stamp;
+	if(l == cap[u]) {
+	  int *a = realloc(adj[u], 2 * cap[u] * sizeof(int));
+	  if(!a) {
+	    goto out;
+	  }
+	  adj[u] = a;
+	  cap[u] *= 2;
+	}
+	adj[u][l++] = w;
+      }
+      len[u] = l;
+      BUCKET_INSERT(u);
+      if(l < mindeg) {
+	mindeg = l;
+      }
+    }
+    free(adj[v]);
+    adj[v] = NULL;
+  }
+#undef BUCKET_INSERT
+#undef BUCKET_REMOVE
+  status = 0;
+
+ out:
+  if(adj) {
+    for(int v = 0; v < n; ++v) {
+      free(adj[v]);
+    }
+  }
+  free(adj);
+  free(len);
+  free(cap);
+  free(mark);
+  free(nbr);
+  free(head);
+  free(next);
+  free(prev);
+  free(elim);
+  free(tp);
+  free(ti);
+  return status;
+}
+
+gauss_sparse_symbolic *gauss_sparse_analyze(const gauss_sparse *A, int order)
+{
+  gauss_sparse_symbolic *S = calloc(1, sizeof(*S));
+  if(!S) {
+    return NULL;
+  }
+  S->n = A->n;
+  S->nnz = A->nnz;
+  S->Q = malloc((A->n + 1) * sizeof(int));
+  if(!S->Q) {
+    free(S);
+    return NULL;
+  }
+  if(order == SPARSE_ORDER_MINDEG) {
+    if(mindeg_order(A, S->Q) < 0) {
+      gauss_sparse_symbolic_free(S);
+      return NULL;
+    }
+  } else {
+    for(int k = 0; k < A->n; ++k) {
+      S->Q[k] = k;
+    }
+  }
+  return S;
+}
+
+void gauss_sparse_symbolic_free(gauss_sparse_symbolic *S)
+{
+  if(S) {
+    free(S->Q);
+    free(S);
+  }
+}
+
+void gauss_sparse_numeric_free(gauss_sparse_numeric *N)
+{
+  if(N) {
+    free(N->Lp);
+    free(N->Li);
+    free(N->Lx);
+    free(N->Up);
+    free(N->Ui);
+    free(N->Ux);
+    free(N->pinv);
+    free(N->P);
+    free(N->x);
+    free(N);
+  }
+}
+
+/* Make room for need entries in the pair of arrays (*i, *x). The
+   entries of L and U are indexed by int (Lp, Up), so there can be at
+   most INT_MAX of each; beyond that, or if the size in bytes does not
+   fit, it fails. */
+static int grow(int **i, double **x, size_t *cap, size_t need)
+{
+  if(need <= *cap) {
+    return 0;
+  }
+  if(need > INT_MAX) {
+    return -1;
+  }
+  size_t c = *cap;
+  while(c < need) {
+    c = c <= INT_MAX / 2 ? 2 * c : INT_MAX;
+  }
+  if(c > SIZE_MAX / sizeof(double)) {
+    return -1;
+  }
+  int *ni = realloc(*i, c * sizeof(int));
+  if(!ni) {
+    return -1;
+  }
+  *i = ni;
+  double *nx = realloc(*x, c * sizeof(double));
+  if(!nx) {
+    return -1;
+  }
+  *x = nx;
+  *cap = c;
+  return 0;
+}
+
+/* Depth-first search from row j in the graph of the L computed so far
+   (an edge i -> r for every entry r of the column of L pivoted at row
+   i). Finished nodes are pushed on xi[top..n-1], so that the result is
+   in topological order; xi[0..] is the recursion stack and pstack holds
+   the position reached in each column. */
+static int dfs(int j, const int *Lp, const int *Li, const int *pinv,
+	       int top, int *xi, int *pstack, int *mark, int stamp)
+{
+  int head = 0;
+  xi[0] = j;
+  while(head >= 0) {
+    j = xi[head];
+    const int J = pinv[j];
+    if(mark[j] != stamp) {
+      mark[j] = stamp;
+      pstack[head] = J < 0 ? 0 : Lp[J];
+    }
+    const int end = J < 0 ? 0 : Lp[J+1];
+    int done = 1;
+    for(int p = pstack[head]; p < end; ++p) {
+      const int i = Li[p];
+      if(mark[i] != stamp) {
+	pstack[head] = p;
+	xi[++head] = i;
+	done = 0;
+	break;
+      }
+    }
+    if(done) {
+      --head;
+      xi[--top] = j;
+    }
+  }
+  return top;
+}
+
+gauss_sparse_numeric *gauss_sparse_factor(const gauss_sparse *A,
+					  const gauss_sparse_symbolic *S,
+					  double tol)
+{
+  const int n = A->n;
+  if(tol <= 0) {
+    tol = SPARSE_DEFAULT_TOL;
+  }
+  gauss_sparse_numeric *N = calloc(1, sizeof(*N));
+  if(!N) {
+    return NULL;
+  }
+  N->n = n;
+  N->tol = tol;
+  size_t lcap = 4 * (size_t)A->nnz + n + 1;
+  if(lcap > INT_MAX) {
+    lcap = INT_MAX;
+  }
+  size_t ucap = lcap;
+  const int n1 = n > 0 ? n : 1;
+  N->Lp = malloc((n + 1) * sizeof(int));
+  N->Up = malloc((n + 1) * sizeof(int));
+  N->Li = malloc(lcap * sizeof(int));
+  N->Lx = malloc(lcap * sizeof(double));
+  N->Ui = malloc(ucap * sizeof(int));
+  N->Ux = malloc(ucap * sizeof(double));
+  N->pinv = malloc(n1 * sizeof(int));
+  N->P = malloc(n1 * sizeof(int));
+  N->x = calloc(n1, sizeof(double));
+  int *xi = malloc(2 * n1 * sizeof(int)), *mark = malloc(n1 * sizeof(int));
+  if(!N->Lp || !N->Up || !N->Li || !N->Lx || !N->Ui || !N->Ux || !N->pinv
+     || !N->P || !N->x || !xi || !mark) {
+    goto fail;
+  }
+  double *x = N->x;
+  for(int i = 0; i < n; ++i) {
+    N->pinv[i] = -1;
+    mark[i] = -1;
+  }
+
+  int lnz = 0, unz = 0;
+  for(int k = 0; k < n; ++k) {
+    if(grow(&N->Li, &N->Lx, &lcap, (size_t)lnz + n)
+       || grow(&N->Ui, &N->Ux, &ucap, (size_t)unz + n)) {
+      goto fail;
+    }
+    int *Li = N->Li, *Ui = N->Ui, *pinv = N->pinv;
+    double *Lx = N->Lx, *Ux = N->Ux;
+    N->Lp[k] = lnz;
+    N->Up[k] = unz;
+    const int col = S->Q[k];
+
+    /* Pattern of x = L \ A(:,col), then its values. */
+    int top = n;
+    for(int p = A->ptr[col]; p < A->ptr[col+1]; ++p) {
+      if(mark[A->ind[p]] != k) {
+	top = dfs(A->ind[p], N->Lp, Li, pinv, top, xi, xi + n, mark, k);
+      }
+    }
+    for(int p = A->ptr[col]; p < A->ptr[col+1]; ++p) {
+      x[A->ind[p]] = A->val[p];
+    }
+    for(int q = top; q < n; ++q) {
+      const int j = xi[q], J = pinv[j];
+      if(J < 0) {
+	continue;
+      }
+      const double xj = x[j];
+      for(int p = N->Lp[J] + 1; p < N->Lp[J+1]; ++p) {
+	x[Li[p]] -= Lx[p] * xj;
+      }
+    }
+
+    /* Rows already pivoted go to U; the largest of the others is the
+       pivot candidate. */
+    int ipiv = -1;
+    double amax = -1;
+    for(int q = top; q < n; ++q) {
+      const int i = xi[q];
+      if(pinv[i] < 0) {
+	if(fabs(x[i]) > amax) {
+	  amax = fabs(x[i]);
+	  ipiv = i;
+	}
+      } else {
+	Ui[unz] = pinv[i];
+	Ux[unz++] = x[i];
+      }
+    }
+    if(ipiv < 0 || !(amax > 0)) {
+      goto fail;		/* Structurally or numerically singular */
+    }
+    if(pinv[col] < 0 && mark[col] == k && fabs(x[col]) >= tol * amax) {
+      ipiv = col;
+    }
+    const double pivot = x[ipiv];
+    Ui[unz] = k;
+    Ux[unz++] = pivot;
+    pinv[ipiv] = k;
+    Li[lnz] = ipiv;
+    Lx[lnz++] = 1;
+    for(int q = top; q < n; ++q) {
+      const int i = xi[q];
+      if(pinv[i] < 0) {
+	Li[lnz] = i;
+	Lx[lnz++] = x[i] / pivot;
+      }
+      x[i] = 0;
+    }
+  }
+  N->Lp[n] = lnz;
+  N->Up[n] = unz;
+
+  /* Row indices of L in pivot order, and U with its columns sorted
+     (by transposing it twice), as the refactorization needs them. */
+  for(int p = 0; p < lnz; ++p) {
+    N->Li[p] = N->pinv[N->Li[p]];
+  }
+  for(int i = 0; i < n; ++i) {
+    N->P[N->pinv[i]] = i;
+  }
+  {
+    int *tp = malloc((n + 1) * sizeof(int));
+    int *ti = malloc(((size_t)unz + 1) * sizeof(int));
+    double *tx = malloc(((size_t)unz + 1) * sizeof(double));
+    if(!tp || !ti || !tx) {
+      free(tp);
+      free(ti);
+      free(tx);
+      goto fail;
+    }
+    csc_transpose(n, N->Up, N->Ui, N->Ux, tp, ti, tx);
+    csc_transpose(n, tp, ti, tx, N->Up, N->Ui, N->Ux);
+    free(tp);
+    free(ti);
+    free(tx);
+  }
+
+  free(xi);
+  free(mark);
+  return N;
+
+ fail:
+  free(xi);
+  free(mark);
+  gauss_sparse_numeric_free(N);
+  return NULL;
+}
+
+int gauss_sparse_refactor(const gauss_sparse *A,
+			  const gauss_sparse_symbolic *S,
+			  gauss_sparse_numeric *N)
+{
+  const int n = N->n;
+  const int *Lp = N->Lp, *Li = N->Li, *Up = N->Up, *Ui = N->Ui;
+  double *Lx = N->Lx, *Ux = N->Ux, *x = N->x;
+  const double lmax = 1 / N->tol;
+  int status = 0;
+
+  for(int k = 0; k < n; ++k) {
+    const int col = S->Q[k];
+    for(int p = A->ptr[col]; p < A->ptr[col+1]; ++p) {
+      x[N->pinv[A->ind[p]]] = A->val[p];
+    }
+    /* U(:,k) in increasing row order is a valid order for the
+       triangular solve. */
+    for(int p = Up[k]; p < Up[k+1] - 1; ++p) {
+      const int j = Ui[p];
+      const double ujk = x[j];
+      Ux[p] = ujk;
+      for(int q = Lp[j] + 1; q < Lp[j+1]; ++q) {
+	x[Li[q]] -= Lx[q] * ujk;
+      }
+    }
+    const double pivot = x[k];
+    Ux[Up[k+1] - 1] = pivot;
+    if(pivot == 0) {
+      status = -1;
+    }
+    for(int q = Lp[k] + 1; q < Lp[k+1] && status >= 0; ++q) {
+      const double l = x[Li[q]] / pivot;
+      Lx[q] = l;
+      if(!(fabs(l) <= lmax)) {
+	status = 1;
+      }
+    }
+    for(int p = Up[k]; p < Up[k+1]; ++p) {
+      x[Ui[p]] = 0;
+    }
+    for(int q = Lp[k]; q < Lp[k+1]; ++q) {
+      x[Li[q]] = 0;
+    }
+    if(status < 0) {
+      break;
+    }
+  }
+  return status;
+}
+
+int gauss_sparse_solve(const gauss_sparse_symbolic *S,
+		       const gauss_sparse_numeric *N, double b[])
+{
+  const int n = N->n;
+  double *y = malloc((n + 1) * sizeof(double));
+  if(!y) {
+    return -1;
+  }
+  for(int k = 0; k < n; ++k) {
+    y[k] = b[N->P[k]];
+  }
+  for(int j = 0; j < n; ++j) {
+    for(int q = N->Lp[j] + 1; q < N->Lp[j+1]; ++q) {
+      y[N->Li[q]] -= N->Lx[q] * y[j];
+    }
+  }
+  for(int j = n-1; j >= 0; --j) {
+    y[j] /= N->Ux[N->Up[j+1] - 1];
+    for(int p = N->Up[j]; p < N->Up[j+1] - 1; ++p) {
+      y[N->Ui[p]] -= N->Ux[p] * y[j];
+    }
+  }
+  for(int k = 0; k < n; ++k) {
+    b[S->Q[k]] = y[k];
+  }
+  free(y);
+  return 0;
+}
+
+void gauss_sparse_permutations(const gauss_sparse_symbolic *S,
+			       const gauss_sparse_numeric *N, int P[], int Q[])
+{
+  if(P) {
+    memcpy(P, N->P, N->n * sizeof(int));
+  }
+  if(Q) {
+    memcpy(Q, S->Q, N->n * sizeof(int));
+  }
+}
+
+void gauss_sparse_factor_nnz(const gauss_sparse_numeric *N, long *lnz,
+			     long *unz)
+{
+  *lnz = N->Lp[N->n];
+  *unz = N->Up[N->n];
+}
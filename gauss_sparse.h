@@ -0,0 +1,84 @@
+/*----------------------------------------------------------------
+* File:     gauss_sparse.h
+*----------------------------------------------------------------*/
+
+#ifndef GAUSS_SPARSE_H
+#define GAUSS_SPARSE_H
+
+/* A sparse n x n matrix in compressed column (CSC) form: the row
+   indices and values of column j are ind[ptr[j] .. ptr[j+1]-1] and
+   val[...]. The same arrays read as compressed rows (CSR) describe the
+   transpose, so gauss_sparse_transpose converts between the two. */
+typedef struct {
+  int n, nnz;
+  int *ptr;			/* n+1 */
+  int *ind;			/* nnz */
+  double *val;			/* nnz */
+} gauss_sparse;
+
+gauss_sparse *gauss_sparse_create(int n, int nnz);
+void          gauss_sparse_destroy(gauss_sparse *A);
+/* CSC of the nonzeros of a dense matrix. */
+gauss_sparse *gauss_sparse_from_dense(int n, const double A[n][n]);
+/* CSC of A^T, i.e. the CSR of A. Row indices come out sorted. */
+gauss_sparse *gauss_sparse_transpose(const gauss_sparse *A);
+/* y = A x */
+void          gauss_sparse_matvec(const gauss_sparse *A, const double x[],
+				  double y[]);
+
+/* Column orderings for gauss_sparse_analyze. */
+#define SPARSE_ORDER_NATURAL 0
+#define SPARSE_ORDER_MINDEG  1	/* Minimum degree on A + A^T */
+
+/* Default pivot threshold: a diagonal entry is kept as the pivot when
+   it is at least this fraction of the largest candidate. */
+#define SPARSE_DEFAULT_TOL 0.1
+
+/* Result of the symbolic analysis: the column ordering Q. It depends
+   only on the sparsity pattern of A and can be shared by all matrices
+   with that pattern. */
+typedef struct gauss_sparse_symbolic gauss_sparse_symbolic;
+
+/* The factors of P A Q = L U. */
+typedef struct gauss_sparse_numeric gauss_sparse_numeric;
+
+gauss_sparse_symbolic *gauss_sparse_analyze(const gauss_sparse *A, int order);
+void gauss_sparse_symbolic_free(gauss_sparse_symbolic *S);
+
+/* Left-looking (Gilbert-Peierls) LU with threshold partial pivoting:
+   in each column the diagonal entry of A Q is the pivot if its
+   magnitude is at least tol times the largest candidate, otherwise the
+   largest candidate is (tol = 1 is plain partial pivoting; tol <= 0
+   selects SPARSE_DEFAULT_TOL). Every multiplier satisfies
+   |l| <= 1/tol. Returns NULL if A is singular, if memory runs out,
+   or if L or U would have more than INT_MAX entries. */
+gauss_sparse_numeric *gauss_sparse_factor(const gauss_sparse *A,
+					  const gauss_sparse_symbolic *S,
+					  double tol);
+void gauss_sparse_numeric_free(gauss_sparse_numeric *N);
+
+/* Recompute the factors in N for a matrix A with the same pattern as
+   the one N was computed from, keeping its pivots and the patterns of
+   L and U: no graph search and no pivot search, only the arithmetic.
+   Returns 0 on success, 1 if the factors were computed but a multiplier
+   exceeds 1/tol (the kept pivots have become a poor choice; call
+   gauss_sparse_factor), and -1 if a pivot is zero. */
+int gauss_sparse_refactor(const gauss_sparse *A,
+			  const gauss_sparse_symbolic *S,
+			  gauss_sparse_numeric *N);
+
+/* Solve A x = b; b is overwritten with x. Returns 0, or -1 if out of
+   memory (b is then untouched). */
+int gauss_sparse_solve(const gauss_sparse_symbolic *S,
+		       const gauss_sparse_numeric *N, double b[]);
+
+/* The permutations of P A Q = L U, with the convention of plu: row i
+   of P A Q is row P[i] of A, and column j is column Q[j] of A. */
+void gauss_sparse_permutations(const gauss_sparse_symbolic *S,
+			       const gauss_sparse_numeric *N, int P[], int Q[]);
+
+/* Number of nonzeros of L and of U, including their diagonals. */
+void gauss_sparse_factor_nnz(const gauss_sparse_numeric *N, long *lnz,
+			     long *unz);
+
+#endif
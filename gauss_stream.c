@@ -0,0 +1,130 @@
+/*----------------------------------------------------------------
+* File:     gauss_stream.c
+*----------------------------------------------------------------*/
+/* Row k of the reduced system is kept in the column order fixed by
+   the pivots chosen so far, so that its part right of the diagonal is
+   contiguous for the vector kernels. A column interchange touches only
+   the k rows already stored. */
+
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "gauss_solve.h"
+#include "gauss_kernels.h"
+#include "gauss_stream.h"
+
+struct gauss_stream {
+  int n, k;
+  double *U;			/* n x n; row i is reduced row i */
+  double *c;			/* Reduced right-hand sides */
+  int *perm;			/* Column j of U is column perm[j] of A */
+  double *w;			/* Row being eliminated */
+};
+
+gauss_stream *gauss_stream_create(int n)
+{
+  gauss_stream *S = calloc(1, sizeof(*S));
+  if(!S) {
+    return NULL;
+  }
+  S->n = n;
+  S->U = malloc(((size_t)n * n + 1) * sizeof(double));
+  S->c = malloc((n + 1) * sizeof(double));
+  S->perm = malloc((n + 1) * sizeof(int));
+  S->w = malloc((n + 1) * sizeof(double));
+  if(!S->U || !S->c || !S->perm || !S->w) {
+    gauss_stream_destroy(S);
+    return NULL;
+  }
+  gauss_stream_reset(S);
+  return S;
+}
+
+void gauss_stream_destroy(gauss_stream *S)
+{
+  if(S) {
+    free(S->U);
+    free(S->c);
+    free(S->perm);
+    free(S->w);
+    free(S);
+  }
+}
+
+void gauss_stream_reset(gauss_stream *S)
+{
+  S->k = 0;
+  for(int j = 0; j < S->n; ++j) {
+    S->perm[j] = j;
+  }
+}
+
+int gauss_stream_rows(const gauss_stream *S)
+{
+  return S->k;
+}
+
+int gauss_stream_push_row(gauss_stream *S, const double row[], double rhs)
+{
+  const int n = S->n, k = S->k;
+  if(k == n) {
+    return -1;
+  }
+  double (*U)[n] = (double (*)[n])S->U;
+  double *w = S->w;
+
+  double rowmax = 0;
+  for(int j = 0; j < n; ++j) {
+    w[j] = row[S->perm[j]];
+    rowmax = fmax(rowmax, fabs(w[j]));
+  }
+  for(int i = 0; i < k; ++i) {
+    const double m = w[i] / U[i][i];
+    if(m != 0) {
+      kernel_axpy(n - i - 1, -m, &U[i][i+1], &w[i+1]);
+      rhs -= m * S->c[i];
+    }
+  }
+
+  int p = k;
+  for(int j = k+1; j < n; ++j) {
+    if(fabs(w[j]) > fabs(w[p])) {
+      p = j;
+    }
+  }
+  /* What is left of the row is rounding error: it depends on the
+     rows already pushed. */
+  if(fabs(w[p]) <= n * DBL_EPSILON * rowmax) {
+    return 1;
+  }
+  if(p != k) {
+    for(int i = 0; i < k; ++i) {
+      SWAP(U[i][k], U[i][p], double);
+    }
+    SWAP(w[k], w[p], double);
+    SWAP(S->perm[k], S->perm[p], int);
+  }
+  memcpy(&U[k][k], &w[k], (n - k) * sizeof(double));
+  S->c[k] = rhs;
+  S->k = k + 1;
+  return 0;
+}
+
+int gauss_stream_solve(gauss_stream *S, double x[])
+{
+  const int n = S->n;
+  if(S->k < n) {
+    return -1;
+  }
+  const double (*U)[n] = (const double (*)[n])S->U;
+  double *z = S->w;
+  for(int i = n-1; i >= 0; --i) {
+    z[i] = (S->c[i] - kernel_dot(n - i - 1, &U[i][i+1], &z[i+1])) / U[i][i];
+  }
+  for(int j = 0; j < n; ++j) {
+    x[S->perm[j]] = z[j];
+  }
+  return 0;
+}
@@ -0,0 +1,36 @@
+/*----------------------------------------------------------------
+* File:     gauss_stream.h
+*----------------------------------------------------------------*/
+
+#ifndef GAUSS_STREAM_H
+#define GAUSS_STREAM_H
+
+/* An n x n system A x = b received one equation at a time. Each row
+   is eliminated against the rows already received as soon as it is
+   pushed, so when the last row arrives only back substitution is left.
+   Pivoting is by columns: the pivot of a new row is its entry of
+   largest magnitude among the columns not yet used, which is partial
+   pivoting on A^T and keeps the multipliers at most 1 in magnitude for
+   the transposed system. */
+typedef struct gauss_stream gauss_stream;
+
+gauss_stream *gauss_stream_create(int n);
+void          gauss_stream_destroy(gauss_stream *S);
+/* Forget the rows pushed so far. */
+void          gauss_stream_reset(gauss_stream *S);
+
+/* Add the equation row . x = rhs (row has n entries). Returns 0, 1 if
+   the row is a linear combination of the rows already pushed (it is
+   then dropped, and another row can be pushed in its place), or -1 if
+   n rows have already been pushed. */
+int gauss_stream_push_row(gauss_stream *S, const double row[], double rhs);
+
+/* Number of rows accepted so far. */
+int gauss_stream_rows(const gauss_stream *S);
+
+/* Back substitution, once n rows have been accepted. Returns 0, or -1
+   if rows are still missing. The state is kept, so solve may be called
+   again, but no more rows can be pushed until gauss_stream_reset. */
+int gauss_stream_solve(gauss_stream *S, double x[]);
+
+#endif
@@ -0,0 +1,348 @@
+/*----------------------------------------------------------------
+* File:     gauss_sym.c
+*----------------------------------------------------------------*/
+/* The kernels reach the lower triangle through the start of each of
+   its rows, so the same code runs on the packed layout and on the
+   lower triangle of a full row-major matrix. */
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "gauss_solve.h"
+#include "gauss_kernels.h"
+#include "gauss_sym.h"
+
+#define SYM_DEFAULT_NB 64
+#define SYM_TILE 32
+
+/* A lower triangle: packed if ld == 0, else rows of stride ld. */
+typedef struct {
+  double *a;
+  int ld;
+} sym_lower;
+
+static double *row(sym_lower S, int i)
+{
+  return S.a + (S.ld ? (size_t)i * S.ld : SYM_PACKED(i, 0));
+}
+
+/* Element (i,j) with j <= i. */
+#define E(S, i, j) (row(S, i)[j])
+
+void sym_pack(int n, const double A[n][n], double AP[])
+{
+  for(int i = 0; i < n; ++i) {
+    memcpy(&AP[SYM_PACKED(i, 0)], A[i], (i + 1) * sizeof(double));
+  }
+}
+
+/* Row i of L: A[i][j] := (A[i][j] - L_i . L_j) / L[j][j], for j in
+   j0..j1-1, with the rows above j0 already final. */
+static void cholesky_row(sym_lower S, int i, int j0, int j1)
+{
+  double *Li = row(S, i);
+  for(int j = j0; j < j1; ++j) {
+    const double *Lj = row(S, j);
+    Li[j] = (Li[j] - kernel_dot(j, Li, Lj)) / Lj[j];
+  }
+}
+
+static int cholesky(sym_lower S, int n, int nb, int nt)
+{
+  (void)nt;
+  for(int i0 = 0; i0 < n; i0 += nb) {
+    const int i1 = i0 + nb < n ? i0 + nb : n;
+#pragma omp parallel for schedule(static) num_threads(nt) \
+  if(nt > 1 && (size_t)(i1 - i0) * i0 * i0 > PARALLEL_MIN_WORK)
+    for(int i = i0; i < i1; ++i) {
+      cholesky_row(S, i, 0, i0);
+    }
+    for(int i = i0; i < i1; ++i) {
+      double *Li = row(S, i);
+      cholesky_row(S, i, i0, i);
+      const double d = Li[i] - kernel_sumsq(i, Li);
+      if(!(d > 0)) {
+	return i + 1;
+      }
+      Li[i] = sqrt(d);
+    }
+  }
+  return 0;
+}
+
+static void cholesky_solve(sym_lower S, int n, double b[])
+{
+  for(int i = 0; i < n; ++i) {
+    const double *Li = row(S, i);
+    b[i] = (b[i] - kernel_dot(i, Li, b)) / Li[i];
+  }
+  for(int i = n - 1; i >= 0; --i) {
+    const double *Li = row(S, i);
+    b[i] /= Li[i];
+    kernel_axpy(i, -b[i], Li, b);
+  }
+}
+
+int cholesky_packed(int n, double AP[], int nb)
+{
+  const sym_lower S = { AP, 0 };
+  return cholesky(S, n, nb > 0 ? nb : SYM_DEFAULT_NB, gauss_get_num_threads());
+}
+
+void cholesky_packed_solve(int n, const double AP[], double b[])
+{
+  const sym_lower S = { (double *)AP, 0 };
+  cholesky_solve(S, n, b);
+}
+
+/* Interchange rows and columns kk < kp of the trailing matrix from k
+   on (dsptrf: the columns of L to the left are not touched). */
+static void sym_swap(sym_lower S, int n, int k, int kk, int kp, int kstep)
+{
+  for(int i = kp + 1; i < n; ++i) {
+    SWAP(E(S, i, kk), E(S, i, kp), double);
+  }
+  for(int j = kk + 1; j < kp; ++j) {
+    SWAP(E(S, j, kk), E(S, kp, j), double);
+  }
+  SWAP(E(S, kk, kk), E(S, kp, kp), double);
+  if(kstep == 2) {
+    SWAP(E(S, k + 1, k), E(S, kp, k), double);
+  }
+}
+
+static int ldlt(sym_lower S, int n, int ipiv[], double *wk, double *wk1,
+		int nt)
+{
+  (void)nt;
+  const double alpha = (1 + sqrt(17.0)) / 8;
+  int info = 0;
+  for(int k = 0; k < n; ) {
+    int kstep = 1, kp = k, imax = k;
+    const double absakk = fabs(E(S, k, k));
+    double colmax = 0;
+    for(int i = k + 1; i < n; ++i) {
+      if(fabs(E(S, i, k)) > colmax) {
+	colmax = fabs(E(S, i, k));
+	imax = i;
+      }
+    }
+    if(absakk == 0 && colmax == 0) {
+      /* A zero column: nothing to eliminate */
+      if(info == 0) {
+	info = k + 1;
+      }
+      ipiv[k] = k;
+      ++k;
+      continue;
+    }
+    if(absakk < alpha * colmax) {
+      double rowmax = 0;
+      for(int j = k; j < imax; ++j) {
+	rowmax = fmax(rowmax, fabs(E(S, imax, j)));
+      }
+      for(int i = imax + 1; i < n; ++i) {
+	rowmax = fmax(rowmax, fabs(E(S, i, imax)));
+      }
+      if(absakk >= alpha * colmax * (colmax / rowmax)) {
+	kp = k;
+      } else if(fabs(E(S, imax, imax)) >= alpha * rowmax) {
+	kp = imax;
+      } else {
+	kp = imax;
+	kstep = 2;
+      }
+    }
+    const int kk = k + kstep - 1;
+    if(kp != kk) {
+      sym_swap(S, n, k, kk, kp, kstep);
+    }
+
+    const int j0 = k + kstep;
+    if(kstep == 1) {
+      /* A := A - a d^{-1} a^T, and the column of L is a / d */
+      const double r = 1 / E(S, k, k);
+      for(int j = j0; j < n; ++j) {
+	wk[j] = r * E(S, j, k);
+      }
+#pragma omp parallel for schedule(static) num_threads(nt) \
+  if(nt > 1 && (size_t)(n - j0) * (n - j0) / 2 > PARALLEL_MIN_WORK)
+      for(int i = j0; i < n; ++i) {
+	double *Ri = row(S, i);
+	kernel_axpy(i - j0 + 1, -Ri[k], &wk[j0], &Ri[j0]);
+      }
+      for(int j = j0; j < n; ++j) {
+	E(S, j, k) = wk[j];
+      }
+      ipiv[k] = kp;
+    } else {
+      /* The same with the 2 x 2 block D, as in dsptrf */
+      if(j0 < n) {
+	double d21 = E(S, k + 1, k);
+	const double d11 = E(S, k + 1, k + 1) / d21;
+	const double d22 = E(S, k, k) / d21;
+	const double t = 1 / (d11 * d22 - 1);
+	d21 = t / d21;
+	for(int j = j0; j < n; ++j) {
+	  wk[j] = d21 * (d11 * E(S, j, k) - E(S, j, k + 1));
+	  wk1[j] = d21 * (d22 * E(S, j, k + 1) - E(S, j, k));
+	}
+#pragma omp parallel for schedule(static) num_threads(nt) \
+  if(nt > 1 && (size_t)(n - j0) * (n - j0) > PARALLEL_MIN_WORK)
+	for(int i = j0; i < n; ++i) {
+	  double *Ri = row(S, i);
+	  kernel_axpy(i - j0 + 1, -Ri[k], &wk[j0], &Ri[j0]);
+	  kernel_axpy(i - j0 + 1, -Ri[k + 1], &wk1[j0], &Ri[j0]);
+	}
+	for(int j = j0; j < n; ++j) {
+	  E(S, j, k) = wk[j];
+	  E(S, j, k + 1) = wk1[j];
+	}
+      }
+      ipiv[k] = ipiv[k + 1] = -(kp + 1);
+    }
+    k += kstep;
+  }
+  return info;
+}
+
+/* dsptrs: L D L^T x = b, applying the interchanges as the columns of L
+   are met. */
+static void ldlt_solve(sym_lower S, int n, const int ipiv[], double b[])
+{
+  for(int k = 0; k < n; ) {
+    if(ipiv[k] >= 0) {
+      SWAP(b[k], b[ipiv[k]], double);
+      for(int i = k + 1; i < n; ++i) {
+	b[i] -= E(S, i, k) * b[k];
+      }
+      b[k] /= E(S, k, k);
+      k += 1;
+    } else {
+      const int kp = -ipiv[k] - 1;
+      SWAP(b[k + 1], b[kp], double);
+      for(int i = k + 2; i < n; ++i) {
+	b[i] -= E(S, i, k) * b[k] + E(S, i, k + 1) * b[k + 1];
+      }
+      const double akm1k = E(S, k + 1, k);
+      const double akm1 = E(S, k, k) / akm1k, ak = E(S, k + 1, k + 1) / akm1k;
+      const double denom = akm1 * ak - 1;
+      const double bkm1 = b[k] / akm1k, bk = b[k + 1] / akm1k;
+      b[k] = (ak * bkm1 - bk) / denom;
+      b[k + 1] = (akm1 * bk - bkm1) / denom;
+      k += 2;
+    }
+  }
+  for(int k = n - 1; k >= 0; ) {
+    if(ipiv[k] >= 0) {
+      for(int i = k + 1; i < n; ++i) {
+	b[k] -= E(S, i, k) * b[i];
+      }
+      SWAP(b[k], b[ipiv[k]], double);
+      k -= 1;
+    } else {
+      for(int i = k + 1; i < n; ++i) {
+	b[k] -= E(S, i, k) * b[i];
+	b[k - 1] -= E(S, i, k - 1) * b[i];
+      }
+      SWAP(b[k], b[-ipiv[k] - 1], double);
+      k -= 2;
+    }
+  }
+}
+
+int ldlt_packed(int n, double AP[], int ipiv[])
+{
+  const sym_lower S = { AP, 0 };
+  double *w = malloc((2 * (size_t)n + 1) * sizeof(double));
+  if(!w) {
+    return -1;
+  }
+  const int info = ldlt(S, n, ipiv, w, w + n, gauss_get_num_threads());
+  free(w);
+  return info;
+}
+
+void ldlt_packed_solve(int n, const double AP[], const int ipiv[],
+		       double b[])
+{
+  const sym_lower S = { (double *)AP, 0 };
+  ldlt_solve(S, n, ipiv, b);
+}
+
+int gauss_is_symmetric(int n, const double A[n][n])
+{
+  for(int i0 = 0; i0 < n; i0 += SYM_TILE) {
+    const int i1 = i0 + SYM_TILE < n ? i0 + SYM_TILE : n;
+    for(int j0 = 0; j0 <= i0; j0 += SYM_TILE) {
+      for(int i = i0; i < i1; ++i) {
+	const int j1 = j0 + SYM_TILE < i ? j0 + SYM_TILE : i;
+	for(int j = j0; j < j1; ++j) {
+	  if(A[i][j] != A[j][i]) {
+	    return 0;
+	  }
+	}
+      }
+    }
+  }
+  return 1;
+}
+
+int gauss_solve_auto_in_place(int n, double A[n][n], double b[n],
+			      int *engine)
+{
+  int *piv = malloc((n + 1) * sizeof(int));
+  double *w = malloc((2 * (size_t)n + 1) * sizeof(double));
+  if(!piv || !w) {
+    free(piv);
+    free(w);
+    return -1;
+  }
+  const int nt = gauss_get_num_threads();
+  const sym_lower S = { &A[0][0], n };
+  int e, info;
+  if(!gauss_is_symmetric(n, (const double (*)[n])A)) {
+    e = GAUSS_ENGINE_PLU;
+    info = plu(n, A, piv);
+    if(info == 0) {
+      plu_solve(n, (const double (*)[n])A, piv, 1, (double (*)[1])b);
+    }
+  } else {
+    int positive = 1;
+    for(int i = 0; i < n && positive; ++i) {
+      w[i] = A[i][i];
+      positive = A[i][i] > 0;
+    }
+    e = GAUSS_ENGINE_CHOLESKY;
+    info = positive ? cholesky(S, n, SYM_DEFAULT_NB, nt) : 1;
+    if(info == 0) {
+      cholesky_solve(S, n, b);
+    } else {
+      /* Not positive definite: restore the lower triangle from the
+	 diagonal saved in w and the untouched upper triangle. */
+      if(positive) {
+	for(int i = 0; i < n; ++i) {
+	  A[i][i] = w[i];
+	  for(int j = 0; j < i; ++j) {
+	    A[i][j] = A[j][i];
+	  }
+	}
+      }
+      e = GAUSS_ENGINE_LDLT;
+      info = ldlt(S, n, piv, w, w + n, nt);
+      if(info == 0) {
+	ldlt_solve(S, n, piv, b);
+      }
+    }
+  }
+  if(engine) {
+    *engine = e;
+  }
+  free(piv);
+  free(w);
+  return info;
+}
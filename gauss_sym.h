@@ -0,0 +1,63 @@
+/*----------------------------------------------------------------
+* File:     gauss_sym.h
+*----------------------------------------------------------------*/
+
+#ifndef GAUSS_SYM_H
+#define GAUSS_SYM_H
+
+#include <stddef.h>
+
+/* Symmetric matrices, of which only the lower triangle is stored and
+   used, packed by rows: element (i,j), j <= i, is AP[SYM_PACKED(i, j)],
+   so each row of the triangle is contiguous and the matrix takes
+   n(n+1)/2 doubles. */
+#define SYM_PACKED(i, j) ((size_t)(i) * ((i) + 1) / 2 + (j))
+
+/* Copy the lower triangle of A into AP. */
+void sym_pack(int n, const double A[n][n], double AP[]);
+
+/* Cholesky factorization A = L L^T of a symmetric positive-definite
+   matrix, in place: AP receives L. Blocked by rows: each block of nb
+   rows (nb <= 0 selects a default) is first reduced by all the rows
+   above it, the rows of the block in parallel with
+   gauss_get_num_threads() threads, and then by its own rows. Returns
+   0, or k+1 if the leading k+1 x k+1 minor is not positive definite;
+   AP is then partly overwritten. */
+int  cholesky_packed(int n, double AP[], int nb);
+void cholesky_packed_solve(int n, const double AP[], double b[]);
+
+/* LDL^T factorization of a symmetric, possibly indefinite, matrix with
+   Bunch-Kaufman pivoting (LAPACK's dsptrf), in place: D is block
+   diagonal with 1 x 1 and 2 x 2 blocks. ipiv records the pivots as in
+   LAPACK, 0-based: ipiv[k] = p >= 0 if rows and columns k and p were
+   interchanged and D[k][k] is a 1 x 1 block, or ipiv[k] = ipiv[k+1] =
+   -(p+1) if k+1 and p were interchanged and D[k..k+1][k..k+1] is a
+   2 x 2 block. The rank-1 and rank-2 updates of the trailing matrix
+   are threaded. Returns 0, or k+1 if D[k][k] is exactly zero (the
+   factorization is completed, but D is singular). */
+int  ldlt_packed(int n, double AP[], int ipiv[]);
+void ldlt_packed_solve(int n, const double AP[], const int ipiv[],
+		       double b[]);
+
+/* Whether A equals its transpose exactly, checked tile by tile, which
+   stops at the first tile that differs. */
+int gauss_is_symmetric(int n, const double A[n][n]);
+
+/* Engines of gauss_solve_auto_in_place. */
+#define GAUSS_ENGINE_PLU      0
+#define GAUSS_ENGINE_CHOLESKY 1
+#define GAUSS_ENGINE_LDLT     2
+
+/* Solve A x = b like gauss_solve_in_place, with the engine chosen from
+   A: Cholesky if A is symmetric with a positive diagonal and the
+   factorization succeeds, LDL^T if A is symmetric otherwise, and plu
+   if it is not. The symmetric engines factor the lower triangle of A
+   where it lies (the same kernels as the packed ones), keeping the
+   upper triangle as the copy from which a failed Cholesky is
+   restored. *engine (if not NULL) receives the engine used. Returns
+   the status of the factorization (b is left unchanged if it is not
+   0), or -1 if out of memory. */
+int gauss_solve_auto_in_place(int n, double A[n][n], double b[n],
+			      int *engine);
+
+#endif
@@ -0,0 +1,309 @@
+/*----------------------------------------------------------------
+* File:     gauss_tiled.c
+*----------------------------------------------------------------*/
+/* Tiled PLU scheduled as a task graph on a work-stealing pool.
+
+   The matrix is cut into nb x nb tiles; tile column k is the k-th
+   panel. For every step k there are three kinds of tasks:
+
+     PANEL(k)       partial-pivoting LU of tile column k (rows k*nb..n-1)
+     UPDATE(k,j)    apply the interchanges of PANEL(k) to tile column j
+                    and solve with L11 for tile (k,j), for j > k
+     GEMM(k,i,j)    tile (i,j) -= L(i,k) U(k,j), for i, j > k
+
+   PANEL(k) waits for the GEMM(k-1,i,k) tasks of its column, UPDATE(k,j)
+   waits for PANEL(k) and the GEMM(k-1,i,j) tasks of column j, and
+   GEMM(k,i,j) waits for UPDATE(k,j). There is no barrier between
+   steps: PANEL(k+1) starts as soon as column k+1 is up to date, while
+   the rest of the step k update is still running. Every element is
+   updated in the same order as in plu_blocked, so both produce
+   bitwise identical results. */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "gauss_solve.h"
+#include "gauss_blocks.h"
+#include "gauss_tiled.h"
+
+enum { TASK_PANEL, TASK_UPDATE, TASK_GEMM };
+
+typedef struct {
+  int kind, k, i, j;
+} tile_task;
+
+/* A double-ended queue of ready tasks. The owner pushes and pops at
+   the tail (LIFO, so the task it just enabled runs next while its data
+   is hot), thieves steal from the head. */
+typedef struct {
+  pthread_mutex_t lock;
+  tile_task *tasks;
+  long head, tail, cap;
+} task_deque;
+
+typedef struct {
+  int n, nb, nt;		/* Matrix size, tile size, tiles per side */
+  double *A;
+  int *ipiv;			/* Pivot rows, absolute, one per row */
+  int *dep_panel;		/* Unfinished predecessors of PANEL(k) */
+  int *dep_update;		/* ... of UPDATE(k,j), index k*nt+j */
+  int info;			/* Status of the first zero pivot */
+  int nworkers;
+  task_deque *deques;
+  long total, done, queued;
+  pthread_mutex_t idle_lock;
+  pthread_cond_t idle_cond;
+} tile_lu;
+
+typedef struct {
+  tile_lu *lu;
+  int id;
+} tile_worker;
+
+/* A tile has at most one GEMM ready at a time, since the next one
+   needs the UPDATE of its column, which waits for the GEMMs of the
+   whole column; a column has at most one UPDATE ready, and there is one
+   PANEL. Each deque is given room for all of them, so that pushing
+   never allocates. */
+static long deque_cap(int nt)
+{
+  return (long)nt * nt + nt + 1;
+}
+
+static void deque_push(tile_lu *lu, int id, tile_task t)
+{
+  task_deque *d = &lu->deques[id];
+  pthread_mutex_lock(&d->lock);
+  d->tasks[d->tail % d->cap] = t;
+  ++d->tail;
+  pthread_mutex_unlock(&d->lock);
+
+  pthread_mutex_lock(&lu->idle_lock);
+  __atomic_add_fetch(&lu->queued, 1, __ATOMIC_SEQ_CST);
+  pthread_cond_signal(&lu->idle_cond);
+  pthread_mutex_unlock(&lu->idle_lock);
+}
+
+/* Take a task from the tail of our own deque, or else steal one from
+   the head of another worker's deque. Returns 0 if all are empty. */
+static int deque_take(tile_lu *lu, int id, tile_task *t)
+{
+  for(int v = 0; v < lu->nworkers; ++v) {
+    const int w = (id + v) % lu->nworkers;
+    task_deque *d = &lu->deques[w];
+    int found = 0;
+    pthread_mutex_lock(&d->lock);
+    if(d->head < d->tail) {
+      if(v == 0) {
+	--d->tail;
+	*t = d->tasks[d->tail % d->cap];
+      } else {
+	*t = d->tasks[d->head % d->cap];
+	++d->head;
+      }
+      found = 1;
+    }
+    pthread_mutex_unlock(&d->lock);
+    if(found) {
+      __atomic_sub_fetch(&lu->queued, 1, __ATOMIC_SEQ_CST);
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/* Decrement a dependency counter; push the task when it reaches 0. */
+static void release(tile_lu *lu, int id, int *counter, tile_task t)
+{
+  if(__atomic_sub_fetch(counter, 1, __ATOMIC_ACQ_REL) == 0) {
+    deque_push(lu, id, t);
+  }
+}
+
+static void run_task(tile_lu *lu, int id, tile_task t)
+{
+  const int n = lu->n, nb = lu->nb, nt = lu->nt;
+  double (*A)[n] = (double (*)[n])lu->A;
+  const int k0 = t.k * nb, kb = k0 + nb < n ? nb : n - k0;
+
+  switch(t.kind) {
+  case TASK_PANEL: {
+    /* The panels run one after the other, in order. */
+    const int info = block_plu_panel(n, A, k0, kb, n, lu->ipiv + k0);
+    if(lu->info == 0) {
+      lu->info = info;
+    }
+    /* Tasks are popped LIFO: push UPDATE(k,k+1), which leads to the
+       next panel, last. */
+    for(int j = nt - 1; j > t.k; --j) {
+      tile_task u = { TASK_UPDATE, t.k, t.k, j };
+      release(lu, id, &lu->dep_update[t.k * nt + j], u);
+    }
+    break;
+  }
+
+  case TASK_UPDATE: {
+    const int j0 = t.j * nb, j1 = j0 + nb < n ? j0 + nb : n;
+    block_laswp(n, A, j0, j1, k0, kb, lu->ipiv + k0);
+    block_trsm_unit_lower(n, A, k0, kb, j0, j1, 1);
+    for(int i = nt - 1; i > t.k; --i) {
+      tile_task g = { TASK_GEMM, t.k, i, t.j };
+      deque_push(lu, id, g);
+    }
+    break;
+  }
+
+  case TASK_GEMM: {
+    const int i0 = t.i * nb, i1 = i0 + nb < n ? i0 + nb : n;
+    const int j0 = t.j * nb, j1 = j0 + nb < n ? j0 + nb : n;
+    block_gemm_update(n, A, i0, i1, j0, j1, k0, kb, 1);
+    if(t.j == t.k + 1) {
+      tile_task p = { TASK_PANEL, t.k + 1, t.k + 1, t.k + 1 };
+      release(lu, id, &lu->dep_panel[t.k + 1], p);
+    } else {
+      tile_task u = { TASK_UPDATE, t.k + 1, t.k + 1, t.j };
+      release(lu, id, &lu->dep_update[(t.k + 1) * nt + t.j], u);
+    }
+    break;
+  }
+  }
+
+  if(__atomic_add_fetch(&lu->done, 1, __ATOMIC_ACQ_REL) == lu->total) {
+    pthread_mutex_lock(&lu->idle_lock);
+    pthread_cond_broadcast(&lu->idle_cond);
+    pthread_mutex_unlock(&lu->idle_lock);
+  }
+}
+
+static void *worker_main(void *arg)
+{
+  tile_worker *w = arg;
+  tile_lu *lu = w->lu;
+  tile_task t;
+
+  while(__atomic_load_n(&lu->done, __ATOMIC_ACQUIRE) < lu->total) {
+    if(deque_take(lu, w->id, &t)) {
+      run_task(lu, w->id, t);
+      continue;
+    }
+    pthread_mutex_lock(&lu->idle_lock);
+    while(__atomic_load_n(&lu->queued, __ATOMIC_SEQ_CST) == 0
+	  && __atomic_load_n(&lu->done, __ATOMIC_ACQUIRE) < lu->total) {
+      pthread_cond_wait(&lu->idle_cond, &lu->idle_lock);
+    }
+    pthread_mutex_unlock(&lu->idle_lock);
+  }
+  return NULL;
+}
+
+int plu_tiled(int n, double A[n][n], int P[n], int nb, int nthreads)
+{
+  if(nb <= 0) {
+    nb = TILED_DEFAULT_NB;
+  }
+  if(nthreads <= 0) {
+    nthreads = gauss_get_num_threads();
+  }
+  for(int i = 0; i < n; ++i) {
+    P[i] = i;
+  }
+  if(n == 0) {
+    return 0;
+  }
+
+  tile_lu lu;
+  lu.n = n;
+  lu.nb = nb;
+  lu.nt = (n + nb - 1) / nb;
+  lu.A = &A[0][0];
+  lu.nworkers = nthreads;
+  lu.done = 0;
+  lu.queued = 0;
+  lu.info = 0;
+
+  const int nt = lu.nt;
+  lu.total = 0;
+  for(int k = 0; k < nt; ++k) {
+    lu.total += 1 + (long)(nt - k - 1) + (long)(nt - k - 1) * (nt - k - 1);
+  }
+
+  lu.ipiv = malloc(n * sizeof(int));
+  lu.dep_panel = malloc(nt * sizeof(int));
+  lu.dep_update = malloc((size_t)nt * nt * sizeof(int));
+  lu.deques = malloc(nthreads * sizeof(task_deque));
+  tile_worker *workers = malloc(nthreads * sizeof(tile_worker));
+  pthread_t *threads = malloc(nthreads * sizeof(pthread_t));
+  tile_task *tasks = malloc(nthreads * deque_cap(nt) * sizeof(tile_task));
+  if(!lu.ipiv || !lu.dep_panel || !lu.dep_update || !lu.deques
+     || !workers || !threads || !tasks) {
+    /* Out of memory: the same factorization, on this thread only. */
+    free(tasks);
+    free(threads);
+    free(workers);
+    free(lu.deques);
+    free(lu.dep_update);
+    free(lu.dep_panel);
+    free(lu.ipiv);
+    return plu_blocked(n, A, P, nb);
+  }
+
+  for(int k = 0; k < nt; ++k) {
+    lu.dep_panel[k] = k > 0 ? nt - k : 0;
+    for(int j = 0; j < nt; ++j) {
+      lu.dep_update[k * nt + j] = 1 + (k > 0 ? nt - k : 0);
+    }
+  }
+  for(int w = 0; w < nthreads; ++w) {
+    pthread_mutex_init(&lu.deques[w].lock, NULL);
+    lu.deques[w].cap = deque_cap(nt);
+    lu.deques[w].tasks = tasks + w * deque_cap(nt);
+    lu.deques[w].head = lu.deques[w].tail = 0;
+    workers[w].lu = &lu;
+    workers[w].id = w;
+  }
+  pthread_mutex_init(&lu.idle_lock, NULL);
+  pthread_cond_init(&lu.idle_cond, NULL);
+
+  tile_task first = { TASK_PANEL, 0, 0, 0 };
+  deque_push(&lu, 0, first);
+
+  /* The calling thread is worker 0. If a thread cannot be started,
+     the workers already running, or the calling thread alone, take
+     over its share: the deques of missing workers stay empty. */
+  int started = 1;
+  while(started < nthreads
+	&& pthread_create(&threads[started], NULL, worker_main,
+			  &workers[started]) == 0) {
+    ++started;
+  }
+  worker_main(&workers[0]);
+  for(int w = 1; w < started; ++w) {
+    pthread_join(threads[w], NULL);
+  }
+
+  /* The interchanges of each panel still have to be applied to the
+     columns of L to its left, and to P. */
+  for(int k0 = 0; k0 < n; k0 += nb) {
+    const int kb = k0 + nb < n ? nb : n - k0;
+    block_laswp(n, A, 0, k0, k0, kb, lu.ipiv + k0);
+    for(int k = k0; k < k0 + kb; ++k) {
+      SWAP(P[k], P[lu.ipiv[k]], int);
+    }
+  }
+
+  pthread_cond_destroy(&lu.idle_cond);
+  pthread_mutex_destroy(&lu.idle_lock);
+  for(int w = 0; w < nthreads; ++w) {
+    pthread_mutex_destroy(&lu.deques[w].lock);
+  }
+  free(tasks);
+  free(threads);
+  free(workers);
+  free(lu.deques);
+  free(lu.dep_update);
+  free(lu.dep_panel);
+  free(lu.ipiv);
+  return lu.info;
+}
@@ -0,0 +1,19 @@
+/*----------------------------------------------------------------
+* File:     gauss_tiled.h
+*----------------------------------------------------------------*/
+
+#ifndef GAUSS_TILED_H
+#define GAUSS_TILED_H
+
+/* Tile size used by plu_tiled when the caller passes nb <= 0. */
+#define TILED_DEFAULT_NB 128
+
+/* PLU of A on nb x nb tiles, scheduled as a task graph on a pool of
+   nthreads work-stealing threads (nthreads <= 0 means
+   gauss_get_num_threads()). Same P convention and packed output as
+   plu; bitwise identical to plu_blocked with the same nb, and returns
+   the same status: 0, or k+1 for the first step k whose column is
+   zero. */
+int plu_tiled(int n, double A[n][n], int P[n], int nb, int nthreads);
+
+#endif
@@ -0,0 +1,133 @@
+/*----------------------------------------------------------------
+* File:     gauss_update.c
+*----------------------------------------------------------------*/
+/* Bennett's algorithm. Step k splits L U + x y^T into the new row k
+   of U, column k of L, and L2 U2 + x' y'^T for the trailing block,
+   with x' = x2 - x_k l (the old column of L) and y' = y2 - (y_k / u_kk)
+   u (the new row of U). The rows of U and y are updated with the
+   vector kernels; the column of L is strided. */
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "gauss_solve.h"
+#include "gauss_kernels.h"
+#include "gauss_update.h"
+
+/* Bennett's update of L U to L U + x y^T, in place in LU, x and y.
+   Returns 0, or 1 if a pivot became zero or the growth bound was
+   exceeded (LU is then partly updated). */
+static int bennett(int n, double LU[n][n], double x[n], double y[n],
+		   double amax)
+{
+  for(int k = 0; k < n; ++k) {
+    const double ukk = LU[k][k] + x[k] * y[k];
+    if(ukk == 0) {
+      return 1;
+    }
+    LU[k][k] = ukk;
+    const double b = y[k] / ukk;
+    kernel_axpy(n - k - 1, x[k], &y[k+1], &LU[k][k+1]);
+    kernel_axpy(n - k - 1, -b, &LU[k][k+1], &y[k+1]);
+
+    double umax = fabs(ukk);
+    for(int j = k+1; j < n; ++j) {
+      umax = fmax(umax, fabs(LU[k][j]));
+    }
+    if(umax > PLU_UPDATE_MAX_GROWTH * amax) {
+      return 1;
+    }
+
+    for(int i = k+1; i < n; ++i) {
+      x[i] -= x[k] * LU[i][k];
+      LU[i][k] += b * x[i];
+      if(fabs(LU[i][k]) > PLU_UPDATE_MAX_GROWTH) {
+	return 1;
+      }
+    }
+  }
+  return 0;
+}
+
+int plu_update_rank1(int n, double LU[n][n], int P[n], double A[n][n],
+		     const double u[n], const double v[n])
+{
+  double *x = malloc((n + 1) * sizeof(double));
+  double *y = malloc((n + 1) * sizeof(double));
+  if(!x || !y) {
+    free(x);
+    free(y);
+    return -1;
+  }
+
+  double amax = 0;
+  for(int i = 0; i < n; ++i) {
+    if(u[i] != 0) {
+      kernel_axpy(n, u[i], v, A[i]);
+    }
+    for(int j = 0; j < n; ++j) {
+      amax = fmax(amax, fabs(A[i][j]));
+    }
+    x[i] = u[P[i]];
+  }
+  memcpy(y, v, n * sizeof(double));
+
+  int status = bennett(n, LU, x, y, amax);
+  if(status) {
+    memcpy(LU, A, sizeof(double[n][n]));
+    const int info = plu_blocked(n, LU, P, 0);
+    if(info) {
+      status = 1 + info;
+    }
+  }
+  free(x);
+  free(y);
+  return status;
+}
+
+int plu_update_row(int n, double LU[n][n], int P[n], double A[n][n], int r,
+		   const double a[n])
+{
+  double *u = calloc(n + 1, sizeof(double)), *v = malloc((n + 1) * sizeof(double));
+  if(!u || !v) {
+    free(u);
+    free(v);
+    return -1;
+  }
+  u[r] = 1;
+  for(int j = 0; j < n; ++j) {
+    v[j] = a[j] - A[r][j];
+  }
+  const int status = plu_update_rank1(n, LU, P, A, u, v);
+  if(status >= 0) {
+    memcpy(A[r], a, n * sizeof(double));
+  }
+  free(u);
+  free(v);
+  return status;
+}
+
+int plu_update_col(int n, double LU[n][n], int P[n], double A[n][n], int c,
+		   const double a[n])
+{
+  double *u = malloc((n + 1) * sizeof(double)), *v = calloc(n + 1, sizeof(double));
+  if(!u || !v) {
+    free(u);
+    free(v);
+    return -1;
+  }
+  v[c] = 1;
+  for(int i = 0; i < n; ++i) {
+    u[i] = a[i] - A[i][c];
+  }
+  const int status = plu_update_rank1(n, LU, P, A, u, v);
+  if(status >= 0) {
+    for(int i = 0; i < n; ++i) {
+      A[i][c] = a[i];
+    }
+  }
+  free(u);
+  free(v);
+  return status;
+}
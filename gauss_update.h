@@ -0,0 +1,33 @@
+/*----------------------------------------------------------------
+* File:     gauss_update.h
+*----------------------------------------------------------------*/
+
+#ifndef GAUSS_UPDATE_H
+#define GAUSS_UPDATE_H
+
+/* Bound on the multipliers of an updated factorization, and on the
+   growth max|U| / max|A|, beyond which it is recomputed with plu. The
+   factors from plu have multipliers of at most 1. */
+#define PLU_UPDATE_MAX_GROWTH 100.0
+
+/* Update the packed L\U and P of A, computed by plu or plu_blocked, to
+   those of A + u v^T in O(n^2) (Bennett's algorithm on P A + (P u)
+   v^T = L U + (P u) v^T, which keeps P). A is updated as well. A
+   downdate is the same call with -u. If a pivot of the updated U is
+   zero, or the growth exceeds PLU_UPDATE_MAX_GROWTH, LU and P are
+   instead recomputed from the updated A by plu_blocked. Returns 0 if
+   the factors were updated, 1 if they were recomputed, 1 + info if
+   they were recomputed and plu_blocked found the updated A singular
+   (info = k+1 for a zero pivot at step k; U is then singular), and -1
+   if out of memory (nothing is changed). */
+int plu_update_rank1(int n, double LU[n][n], int P[n], double A[n][n],
+		     const double u[n], const double v[n]);
+
+/* Replace row r, or column c, of A with a and update LU and P; a rank-1
+   update with u = e_r, or v = e_c. Same return values. */
+int plu_update_row(int n, double LU[n][n], int P[n], double A[n][n], int r,
+		   const double a[n]);
+int plu_update_col(int n, double LU[n][n], int P[n], double A[n][n], int c,
+		   const double a[n]);
+
+#endif
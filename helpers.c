@@ -8,62 +8,271 @@
  *
  *----------------------------------------------------------------*/
 
+#define _POSIX_C_SOURCE 200112L
+
 #include <stdio.h>
 #include <math.h>
 #include <stdlib.h>
-#include <time.h>
+#include <string.h>
+#include <stdint.h>
 
 
 #include "helpers.h"
+#include "gauss_solve.h"
+#include "gauss_kernels.h"
+#include "gauss_arena.h"
 
-void matrix_times_vector(int n, const double A[n][n], const double x[n],
-			 double y[n])
+/* Rows per partial sum of the matrix norms, and entries per partial
+   sum of the vector norms: each block is summed on its own and the
+   partials are added in a fixed order, so that the sums do not depend
+   on the number of threads. */
+#define SUM_ROWS 16
+#define SUM_CHUNK 8192
+
+/* Partial sums up to this many are kept on the stack. */
+#define SUM_STACK 256
+
+/* Pairwise summation adds up to this many terms with the kernels. */
+#define PAIRWISE_BASE 128
+
+/* The method of the calling thread. The public functions read it once
+   and pass it on, since their OpenMP workers have their own copy. */
+static __thread int summation = SUM_FAST;
+
+int set_summation(int method)
 {
-  for(int i = 0; i < n; ++i) {
-    y[i] = 0;
-    for(int j = 0; j < n; ++j)
-      y[i] += A[i][j] * x[j];
+  if(method != SUM_FAST && method != SUM_PAIRWISE && method != SUM_KAHAN) {
+    return -1;
   }
+  const int old = summation;
+  summation = method;
+  return old;
 }
 
-double norm(const int n, const double x[n])
+/* s + c += v, with the rounding error of s + v kept in c (Neumaier's
+   variant of Kahan summation, which also holds when |v| > |s|). */
+static inline void compensated_add(double *s, double *c, double v)
+{
+  const double t = *s + v;
+  *c += fabs(*s) >= fabs(v) ? (*s - t) + v : (v - t) + *s;
+  *s = t;
+}
+
+/* Compensated sum of x[j] y[j], or of (x[j] - y[j])^2 if dist, in four
+   independent lanes. */
+static double sum_kahan(int n, const double *x, const double *y, int dist)
 {
-  double S = 0;
-  for(int j = 0; j < n; ++j) {
-    S += x[j] * x[j];
+  double s[4] = {0, 0, 0, 0}, c[4] = {0, 0, 0, 0};
+  for(int j0 = 0; j0 < n; j0 += 4) {
+    const int l1 = n - j0 < 4 ? n - j0 : 4;
+    for(int l = 0; l < l1; ++l) {
+      const double d = x[j0 + l] - y[j0 + l];
+      compensated_add(&s[l], &c[l], dist ? d * d : x[j0 + l] * y[j0 + l]);
+    }
+  }
+  double S = 0, C = c[0] + c[1] + c[2] + c[3];
+  for(int l = 0; l < 4; ++l) {
+    compensated_add(&S, &C, s[l]);
   }
-  return sqrt(S);
+  return S + C;
 }
 
-double norm_dist(const int n, const double x[n], const double y[n])
+static double sum_pairwise(int n, const double *x, const double *y, int dist)
 {
-  double S = 0;
-  for(int j = 0; j < n; ++j) {
-    S += (x[j]-y[j]) * (x[j]-y[j]);
+  if(n <= PAIRWISE_BASE) {
+    return dist ? kernel_dist2(n, x, y) : kernel_dot(n, x, y);
   }
-  return sqrt(S);
+  const int h = n / 2;
+  return sum_pairwise(h, x, y, dist) + sum_pairwise(n - h, x + h, y + h, dist);
 }
 
-double frobenius_norm(const int n, const double X[n][n])
+/* x . y, or |x - y|^2 if dist, by the given method. */
+static double sum_terms(int method, int n, const double *x, const double *y,
+			int dist)
+{
+  switch(method) {
+  case SUM_KAHAN:
+    return sum_kahan(n, x, y, dist);
+  case SUM_PAIRWISE:
+    return sum_pairwise(n, x, y, dist);
+  default:
+    return dist ? kernel_dist2(n, x, y) : kernel_dot(n, x, y);
+  }
+}
+
+/* The sum of the partial sums v, in an order fixed by n alone. */
+static double sum_partials(int method, int n, const double v[])
 {
-  double S = 0;
-  for(int i = 0; i < n; ++i) {
-    for(int j = 0; j < n; ++j) {
-      S += X[i][j] * X[i][j];
+  if(method == SUM_KAHAN) {
+    double S = 0, C = 0;
+    for(int i = 0; i < n; ++i) {
+      compensated_add(&S, &C, v[i]);
     }
+    return S + C;
   }
-  return sqrt(S);
+  if(n <= 8) {
+    double S = 0;
+    for(int i = 0; i < n; ++i) {
+      S += v[i];
+    }
+    return S;
+  }
+  return sum_partials(method, n / 2, v)
+    + sum_partials(method, n - n / 2, v + n / 2);
 }
 
-double frobenius_norm_dist(const int n, const double X[n][n], const double Y[n][n])
+/* The partial sum of block k of sum_rows. */
+static double sum_row_block(int method, int k, int m, int n, int ldx,
+			    const double *X, int ldy, const double *Y,
+			    const double *b)
+{
+  const int i1 = (k + 1) * SUM_ROWS < m ? (k + 1) * SUM_ROWS : m;
+  double S = 0, C = 0;
+  for(int i = k * SUM_ROWS; i < i1; ++i) {
+    const double *Xi = X + (size_t)i * ldx;
+    double v;
+    if(b) {
+      const double r = b[i] - sum_terms(method, n, Xi, Y, 0);
+      v = r * r;
+    } else if(Y) {
+      v = sum_terms(method, n, Xi, Y + (size_t)i * ldy, 1);
+    } else {
+      v = sum_terms(method, n, Xi, Xi, 0);
+    }
+    compensated_add(&S, &C, v);
+  }
+  return method == SUM_KAHAN ? S + C : S;
+}
+
+/* The sum over rows i < m of the squares of: the row X[i] if Y is
+   NULL and b is NULL, X[i] - Y[i] if only b is NULL, and b[i] - X[i] . x
+   with x = Y (ldy unused) otherwise. Blocks of SUM_ROWS rows are summed
+   in parallel. If there is no memory for the partial sums, the blocks
+   are added one after the other on the calling thread instead. */
+static double sum_rows(int m, int n, int ldx, const double *X,
+		       int ldy, const double *Y, const double *b)
 {
-  double S = 0;
-  for(int i = 0; i < n; ++i) {
-    for(int j = 0; j < n; ++j) {
-      S += (X[i][j]-Y[i][j]) * (X[i][j]-Y[i][j]);
+  const int method = summation;
+  const int nblocks = (m + SUM_ROWS - 1) / SUM_ROWS;
+  double stack[SUM_STACK];
+  double *part = nblocks <= SUM_STACK ? stack
+    : malloc(nblocks * sizeof(double));
+  if(!part) {
+    double S = 0, C = 0;
+    for(int k = 0; k < nblocks; ++k) {
+      compensated_add(&S, &C,
+		      sum_row_block(method, k, m, n, ldx, X, ldy, Y, b));
     }
+    return S + C;
+  }
+  const int nt = gauss_get_num_threads();
+  (void)nt;
+#pragma omp parallel for schedule(static) num_threads(nt) \
+  if(nt > 1 && (size_t)m * n > PARALLEL_MIN_WORK)
+  for(int k = 0; k < nblocks; ++k) {
+    part[k] = sum_row_block(method, k, m, n, ldx, X, ldy, Y, b);
+  }
+  const double S = sum_partials(method, nblocks, part);
+  if(part != stack) {
+    free(part);
   }
-  return sqrt(S);
+  return S;
+}
+
+/* The vector counterpart: x . y, or |x - y|^2 if dist, by chunks of
+   SUM_CHUNK, with the same fallback. */
+static double sum_vector(int n, const double *x, const double *y, int dist)
+{
+  const int method = summation;
+  if(n <= SUM_CHUNK) {
+    return sum_terms(method, n, x, y, dist);
+  }
+  const int nchunks = (n + SUM_CHUNK - 1) / SUM_CHUNK;
+  double stack[SUM_STACK];
+  double *part = nchunks <= SUM_STACK ? stack
+    : malloc(nchunks * sizeof(double));
+  if(!part) {
+    double S = 0, C = 0;
+    for(int j0 = 0; j0 < n; j0 += SUM_CHUNK) {
+      const int len = n - j0 < SUM_CHUNK ? n - j0 : SUM_CHUNK;
+      compensated_add(&S, &C, sum_terms(method, len, x + j0, y + j0, dist));
+    }
+    return S + C;
+  }
+  const int nt = gauss_get_num_threads();
+  (void)nt;
+#pragma omp parallel for schedule(static) num_threads(nt) if(nt > 1)
+  for(int k = 0; k < nchunks; ++k) {
+    const int j0 = k * SUM_CHUNK, len = n - j0 < SUM_CHUNK ? n - j0 : SUM_CHUNK;
+    part[k] = sum_terms(method, len, x + j0, y + j0, dist);
+  }
+  const double S = sum_partials(method, nchunks, part);
+  if(part != stack) {
+    free(part);
+  }
+  return S;
+}
+
+void matrix_times_vector(int n, const double A[n][n], const double x[n],
+			 double y[n])
+{
+  matrix_times_vector_lda(n, n, n, A, x, y);
+}
+
+void matrix_times_vector_lda(int m, int n, int lda, const double A[][lda],
+			     const double x[n], double y[m])
+{
+  const int method = summation;
+  const int nt = gauss_get_num_threads();
+  (void)nt;
+#pragma omp parallel for schedule(static) num_threads(nt) \
+  if(nt > 1 && (size_t)m * n > PARALLEL_MIN_WORK)
+  for(int i = 0; i < m; ++i) {
+    y[i] = sum_terms(method, n, A[i], x, 0);
+  }
+}
+
+double norm(const int n, const double x[n])
+{
+  return sqrt(sum_vector(n, x, x, 0));
+}
+
+double norm_dist(const int n, const double x[n], const double y[n])
+{
+  return sqrt(sum_vector(n, x, y, 1));
+}
+
+double residual_norm(int n, const double A[n][n], const double x[n],
+		     const double b[n])
+{
+  return residual_norm_lda(n, n, n, A, x, b);
+}
+
+double residual_norm_lda(int m, int n, int lda, const double A[][lda],
+			 const double x[n], const double b[m])
+{
+  return sqrt(sum_rows(m, n, lda, &A[0][0], 0, x, b));
+}
+
+double frobenius_norm(const int n, const double X[n][n])
+{
+  return frobenius_norm_lda(n, n, n, X);
+}
+
+double frobenius_norm_lda(int m, int n, int lda, const double X[][lda])
+{
+  return sqrt(sum_rows(m, n, lda, &X[0][0], 0, NULL, NULL));
+}
+
+double frobenius_norm_dist(const int n, const double X[n][n], const double Y[n][n])
+{
+  return frobenius_norm_dist_lda(n, n, n, X, n, Y);
+}
+
+double frobenius_norm_dist_lda(int m, int n, int ldx, const double X[][ldx],
+			       int ldy, const double Y[][ldy])
+{
+  return sqrt(sum_rows(m, n, ldx, &X[0][0], ldy, &Y[0][0], NULL));
 }
 
 void print_vector(int n, double x[n])
@@ -116,25 +325,88 @@ void print_matrix(int n, double A[n][n], int flag)
 }
 
 
-// Function to generate a random square matrix of size 'n'
+/* The generator of generate_random_matrix is xoshiro256** (Blackman
+   and Vigna), one stream per row, its state drawn by splitmix64 from
+   the seed, the number of the call and the row. The rows are filled
+   in parallel, and the matrices depend on the seed and on the number
+   of previous calls only, not on the number of threads. */
+static uint64_t random_seed, random_calls;
+static int random_seeded;
+
+/* The seed when neither set_random_seed nor $GAUSS_SEED gives one, so
+   that runs are reproducible by default. */
+#define RANDOM_DEFAULT_SEED 20240922u
+
+static uint64_t mix64(uint64_t z)
+{
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+static uint64_t splitmix64(uint64_t *s)
+{
+  return mix64(*s += 0x9e3779b97f4a7c15ULL);
+}
+
+static inline uint64_t rotl(uint64_t x, int k)
+{
+  return (x << k) | (x >> (64 - k));
+}
+
+static inline uint64_t xoshiro256ss(uint64_t s[4])
+{
+  const uint64_t r = rotl(s[1] * 5, 7) * 9, t = s[1] << 17;
+  s[2] ^= s[0];
+  s[3] ^= s[1];
+  s[1] ^= s[2];
+  s[0] ^= s[3];
+  s[2] ^= t;
+  s[3] = rotl(s[3], 45);
+  return r;
+}
+
+void set_random_seed(uint64_t seed)
+{
+  random_seed = seed;
+  random_calls = 0;
+  random_seeded = 1;
+}
+
 void generate_random_matrix(int n, double matrix[n][n])
 {
-  // Seed the random number generator with the current time
-  srand(time(0));
-    
+  if(!random_seeded) {
+    const char *env = getenv("GAUSS_SEED");
+    set_random_seed(env ? strtoull(env, NULL, 0) : RANDOM_DEFAULT_SEED);
+  }
+  const uint64_t call = random_calls++;
+  const int nt = gauss_get_num_threads();
+  (void)nt;
+
   // Fill the matrix with random integers between 0 and 99
+#pragma omp parallel for schedule(static) num_threads(nt) \
+  if(nt > 1 && (size_t)n * n > PARALLEL_MIN_WORK)
   for (int i = 0; i < n; i++) {
+    uint64_t sm = mix64(mix64(random_seed + call) + (uint64_t)i), s[4];
+    for (int k = 0; k < 4; k++) {
+      s[k] = splitmix64(&sm);
+    }
     for (int j = 0; j < n; j++) {
-      matrix[i][j] = rand() % 100;
+      matrix[i][j] = (double)(((xoshiro256ss(s) >> 32) * 100) >> 32);
     }
   }
 }
 
-void create_matrix(int n, double (**matrix)[n])
+int create_matrix(int n, double (**matrix)[n])
 {
-  double *store = (double *)malloc(n * n * sizeof(double));
-  double (*A)[n] = (double (*)[n])store;
-  *matrix = A;
+  void *store = NULL;
+  if(posix_memalign(&store, ARENA_ALIGN,
+		    ((size_t)n * n + 1) * sizeof(double))) {
+    *matrix = NULL;
+    return -1;
+  }
+  *matrix = (double (*)[n])store;
+  return 0;
 }
 
 void destroy_matrix(int n, double (*matrix)[n])
@@ -145,9 +417,5 @@ void destroy_matrix(int n, double (*matrix)[n])
      
 void copy_matrix(int n, const double A[n][n], double A_copy[n][n])
 {
-  for (int i = 0; i < n; i++) {
-    for (int j = 0; j < n; j++) {
-      A_copy[i][j] = A[i][j];
-    }
-  }
+  memcpy(A_copy, A, (size_t)n * n * sizeof(double));
 }
@@ -11,20 +11,58 @@
 #ifndef PRINT_HELPERS_H
 #define PRINT_HELPERS_H
 
+#include <stdint.h>
+
 #define FLAG_WHOLE 0
 #define FLAG_LOWER_PART 1
 #define FLAG_UPPER_PART 2
 
+/* Summation methods of the norms and of matrix_times_vector, selected
+   for the calling thread with set_summation, which returns the
+   previous one, or -1 (changing nothing) for an unknown method.
+   SUM_FAST adds with the vector kernels of gauss_kernels.h in several
+   accumulators, SUM_PAIRWISE adds blocks of them pairwise, with an
+   error growing as log n, and SUM_KAHAN compensates every addition,
+   with an error independent of n, at a few times the cost. Whatever
+   the method, the results do not depend on the number of threads. */
+#define SUM_FAST     0
+#define SUM_PAIRWISE 1
+#define SUM_KAHAN    2
+
+int    set_summation(int method);
+
 void   matrix_times_vector(int n, const double A[n][n], const double x[n], double y[n]);
 double norm(const int n, const double x[n]);
 double norm_dist(const int n, const double x[n], const double y[n]);
 double frobenius_norm(const int n, const double X[n][n]);
 double frobenius_norm_dist(const int n, const double X[n][n], const double Y[n][n]);
 
+/* The same on an m x n matrix with leading dimension lda (see
+   gauss_solve.h): y = A x with x of length n and y of length m. */
+void   matrix_times_vector_lda(int m, int n, int lda, const double A[][lda],
+			       const double x[n], double y[m]);
+double frobenius_norm_lda(int m, int n, int lda, const double X[][lda]);
+double frobenius_norm_dist_lda(int m, int n, int ldx, const double X[][ldx],
+			       int ldy, const double Y[][ldy]);
+
+/* |b - A x|, in one pass over A, without forming A x. */
+double residual_norm(int n, const double A[n][n], const double x[n],
+		     const double b[n]);
+double residual_norm_lda(int m, int n, int lda, const double A[][lda],
+			 const double x[n], const double b[m]);
+
 void   print_vector(int n, double x[n]);
 void   print_matrix(int n, double A[n][n], int flag);
+/* Fill matrix with random integers 0..99: seeded by set_random_seed,
+   or else from $GAUSS_SEED or a fixed default at the first call, so a
+   run is reproducible; successive calls give different matrices. Not
+   thread-safe. */
 void   generate_random_matrix(int n, double matrix[n][n]);
-void   create_matrix(int n, double (**matrix)[n]);
+void   set_random_seed(uint64_t seed);
+/* create_matrix returns 0, or -1 (and *matrix = NULL) if out of
+   memory; the storage is ARENA_ALIGN-aligned, with row stride n. For
+   padded, reusable scratch matrices see gauss_arena.h. */
+int    create_matrix(int n, double (**matrix)[n]);
 void   destroy_matrix(int n, double (*matrix)[n]);
 void   copy_matrix(int n, const double A[n][n], double A_copy[n][n]);
 
@@ -12,15 +12,38 @@
 #define _GNU_SOURCE
 
 #include <math.h>
+#include <float.h>
 #include <string.h>
 #include <assert.h>
 #include <stdio.h>
 #include <stdlib.h>
-#include <signal.h>
-#include <fenv.h>
-#include <setjmp.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <pthread.h>
 
 #include "gauss_solve.h"
+#include "gauss_tiled.h"
+#include "gauss_kernels.h"
+#include "gauss_batched.h"
+#include "gauss_cache.h"
+#include "gauss_arena.h"
+#include "gauss_mixed.h"
+#include "gauss_band.h"
+#include "gauss_sparse.h"
+#include "gauss_ooc.h"
+#include "gauss_io.h"
+#include "gauss_stream.h"
+#include "gauss_update.h"
+#include "gauss_instrument.h"
+#include "gauss_robust.h"
+#include "gauss_recursive.h"
+#include "gauss_gpu.h"
+#include "gauss_async.h"
+#include "gauss_inverse.h"
+#include "gauss_sym.h"
+#ifdef GAUSS_MPI
+#include "gauss_mpi.h"
+#endif
 #include "helpers.h"
 
 /* Size of the matrix */
@@ -68,8 +91,8 @@ void test_gauss_solve()
   print_matrix(N, A, FLAG_LOWER_PART);
 }
 
-jmp_buf env;  // Buffer to store the state for setjmp/longjmp
-
+/* Zero pivots are reported by the return value, for the unrolled
+   sizes and the general loops alike. */
 void test_gauss_solve_with_zero_pivot()
 {
   printf("Entering function: %s\n", __func__);
@@ -82,15 +105,44 @@ void test_gauss_solve_with_zero_pivot()
 
   double b[N] = {5, 6, 3};
 
-  // Save the program state with setjmp
-  if (setjmp(env) == 0) {
-    gauss_solve_in_place(N, A, b);
-    print_matrix(N, A, FLAG_LOWER_PART);
-  } else {
-    // This block is executed when longjmp is called
-    printf("Returned to main program flow after exception\n");
+  assert(gauss_solve_in_place(N, A, b) == 1);
+
+  /* The second pivot becomes zero. */
+  const double A1[N][N] = {
+    {1, 2, 3},
+    {2, 4, 1},
+    {1, 1, 1}
+  };
+  memcpy(A, A1, sizeof(A));
+  assert(lu_in_place(N, A) == 2);
+  memcpy(A, A1, sizeof(A));
+  int P[N];
+  assert(plu(N, A, P) == 0);
+
+  enum { n = 40 };
+  double B[n][n], c[n];
+  int Pn[n];
+  for(int i = 0; i < n; ++i) {
+    for(int j = 0; j < n; ++j) {
+      B[i][j] = i == j ? n : (i + j) % 3;
+    }
+    c[i] = 1;
   }
-  
+  B[0][0] = 0;
+  assert(gauss_solve_in_place(n, B, c) == 1);
+  B[0][0] = 0;
+  assert(lu_blocked_in_place(n, B, 8) == 1);
+
+  /* Column 5 is zero, so partial pivoting skips step 5. */
+  for(int i = 0; i < n; ++i) {
+    for(int j = 0; j < n; ++j) {
+      B[i][j] = j == 5 ? 0 : i == j ? n : (i + j) % 3;
+    }
+  }
+  double Bc[n][n];
+  memcpy(Bc, B, sizeof(B));
+  assert(plu(n, B, Pn) == 6);
+  assert(plu_blocked(n, Bc, Pn, 8) == 6);
 }
 
 void test_lu_in_place()
@@ -139,13 +191,17 @@ void benchmark_test(int n)
   /* Allocate matrix on stack */
   double A0[n][n], A[n][n];
   generate_random_matrix(n, A0);
+  /* Diagonally dominant, so that lu_in_place needs no pivoting */
+  for(int i = 0; i < n; ++i) {
+    A0[i][i] += 100 * n;
+  }
   copy_matrix(n, A0, A);
 
-  lu_in_place(N, A);
-  lu_in_place_reconstruct(N, A);
+  assert(lu_in_place(n, A) == 0);
+  lu_in_place_reconstruct(n, A);
 
-  double eps = 1e-6;
-  assert(frobenius_norm_dist(N, A0, A) < eps);
+  double eps = 1e-12;
+  assert(frobenius_norm_dist(n, A0, A) < eps * frobenius_norm(n, A0));
 
 }
 
@@ -161,16 +217,17 @@ void benchmark_test_dynamic(int n)
   assert(A_copy);
 
   generate_random_matrix(n, A);
+  /* Diagonally dominant, so that lu_in_place needs no pivoting */
+  for(int i = 0; i < n; ++i) {
+    A[i][i] += 100 * n;
+  }
   copy_matrix(n, A, A_copy);
 
-  puts("Random matrix A:\n");
-  print_matrix(n, A, FLAG_WHOLE);
-
-  lu_in_place(n, A);
+  assert(lu_in_place(n, A) == 0);
   lu_in_place_reconstruct(n, A);
 
-  double eps = 1e-6;
-  assert(frobenius_norm_dist(n, A_copy, A) < eps);
+  double eps = 1e-12;
+  assert(frobenius_norm_dist(n, A_copy, A) < eps * frobenius_norm(n, A_copy));
 
   /* Ensure memory is deallocated */
   free(store);
@@ -187,14 +244,18 @@ void benchmark_test_dynamic_alt(int n)
   assert(A_copy);
 
   generate_random_matrix(n, A);
+  /* Diagonally dominant, so that lu_in_place needs no pivoting */
+  for(int i = 0; i < n; ++i) {
+    A[i][i] += 100 * n;
+  }
   copy_matrix(n, A, A_copy);
 
-  lu_in_place(n, A);
+  assert(lu_in_place(n, A) == 0);
 
   lu_in_place_reconstruct(n, A);
 
-  double eps = 1e-4, dist = frobenius_norm_dist(n, A_copy, A);
-  assert(dist < eps);
+  double eps = 1e-12, dist = frobenius_norm_dist(n, A_copy, A);
+  assert(dist < eps * frobenius_norm(n, A_copy));
 
 
   /* Ensure memory is deallocated */
@@ -202,25 +263,1791 @@ void benchmark_test_dynamic_alt(int n)
   destroy_matrix(n, A_copy);
 }
 
-void fpe_handler(int sig) {
-  printf("Entering %s...\n", __func__);
-  if(sig == SIGFPE) {
-    printf("Floating point exception occurred, ignoring...\n");
-    longjmp(env, 1);  // Jump back to where setjmp was called
+void test_lu_blocked_in_place(int n, int nb)
+{
+  printf("Entering function: %s\n", __func__);
+
+  double (*A)[n] = NULL, (*A_ref)[n] = NULL, (*A_copy)[n] = NULL;
+  create_matrix(n, &A);
+  assert(A);
+  create_matrix(n, &A_ref);
+  assert(A_ref);
+  create_matrix(n, &A_copy);
+  assert(A_copy);
+
+  /* Make A diagonally dominant so that LU without pivoting is stable
+     and the two variants can be compared. */
+  generate_random_matrix(n, A);
+  for(int i = 0; i < n; ++i) {
+    A[i][i] += 100 * n;
   }
+  copy_matrix(n, A, A_copy);
+  copy_matrix(n, A, A_ref);
+
+  /* The blocked variant must produce the same packed L\U as the
+     unblocked one. */
+  lu_in_place(n, A_ref);
+  lu_blocked_in_place(n, A, nb);
+
+  double eps = 1e-4;
+  assert(frobenius_norm_dist(n, A_ref, A) < eps);
+
+  lu_in_place_reconstruct(n, A);
+  assert(frobenius_norm_dist(n, A_copy, A) < eps);
+
+  destroy_matrix(n, A);
+  destroy_matrix(n, A_ref);
+  destroy_matrix(n, A_copy);
 }
 
-int main()
+void test_plu_blocked(int n, int nb)
+{
+  printf("Entering function: %s\n", __func__);
+
+  double (*A)[n] = NULL, (*A_ref)[n] = NULL, (*A_copy)[n] = NULL;
+  create_matrix(n, &A);
+  assert(A);
+  create_matrix(n, &A_ref);
+  assert(A_ref);
+  create_matrix(n, &A_copy);
+  assert(A_copy);
+
+  int *P = malloc(n * sizeof(int)), *P_ref = malloc(n * sizeof(int));
+  assert(P && P_ref);
+
+  generate_random_matrix(n, A);
+  copy_matrix(n, A, A_copy);
+  copy_matrix(n, A, A_ref);
+
+  plu(n, A_ref, P_ref);
+  plu_blocked(n, A, P, nb);
+
+  double eps = 1e-4;
+  assert(memcmp(P, P_ref, n * sizeof(int)) == 0);
+  assert(frobenius_norm_dist(n, A_ref, A) < eps);
+
+  /* L*U must reproduce the rows of A in the order given by P. */
+  lu_in_place_reconstruct(n, A);
+  for(int i = 0; i < n; ++i) {
+    memcpy(A_ref[i], A_copy[P[i]], n * sizeof(double));
+  }
+  assert(frobenius_norm_dist(n, A_ref, A) < eps);
+
+  free(P);
+  free(P_ref);
+  destroy_matrix(n, A);
+  destroy_matrix(n, A_ref);
+  destroy_matrix(n, A_copy);
+}
+
+void test_plu_tiled(int n, int nb, int nthreads)
+{
+  printf("Entering function: %s\n", __func__);
+
+  double (*A)[n] = NULL, (*A_ref)[n] = NULL;
+  create_matrix(n, &A);
+  assert(A);
+  create_matrix(n, &A_ref);
+  assert(A_ref);
+
+  int *P = malloc(n * sizeof(int)), *P_ref = malloc(n * sizeof(int));
+  assert(P && P_ref);
+
+  generate_random_matrix(n, A);
+  copy_matrix(n, A, A_ref);
+
+  /* The task graph runs the same updates as plu_blocked, in the same
+     order for every element, whatever the schedule. */
+  const int info = plu_blocked(n, A_ref, P_ref, nb);
+  assert(plu_tiled(n, A, P, nb, nthreads) == info);
+
+  assert(memcmp(P, P_ref, n * sizeof(int)) == 0);
+  assert(memcmp(A, A_ref, n * n * sizeof(double)) == 0);
+
+  /* A zero column gives the same status and factors. */
+  generate_random_matrix(n, A);
+  const int c = n > 40 ? 40 : n - 1;
+  for(int i = 0; i < n; ++i) {
+    A[i][c] = 0;
+  }
+  copy_matrix(n, A, A_ref);
+  assert(plu_blocked(n, A_ref, P_ref, nb) == c + 1);
+  assert(plu_tiled(n, A, P, nb, nthreads) == c + 1);
+  assert(memcmp(A, A_ref, n * n * sizeof(double)) == 0);
+
+  free(P);
+  free(P_ref);
+  destroy_matrix(n, A);
+  destroy_matrix(n, A_ref);
+}
+
+void test_kernels()
+{
+  printf("Entering function: %s (%s)\n", __func__, gauss_kernel_isa());
+
+  double x[67], y[67], z[67];
+  for(int j = 0; j < 67; ++j) {
+    x[j] = j % 7 - 3;
+    y[j] = 0.5 * j;
+  }
+
+  /* All lengths, to exercise the vector bodies and every tail. */
+  for(int n = 0; n <= 67; ++n) {
+    double S = 0;
+    for(int j = 0; j < n; ++j) {
+      S += x[j] * y[j];
+    }
+    assert(fabs(kernel_dot(n, x, y) - S) < 1e-9);
+    assert(fabs(sqrt(kernel_sumsq(n, y)) - norm(n, y)) < 1e-9);
+    S = 0;
+    for(int j = 0; j < n; ++j) {
+      S += (x[j] - y[j]) * (x[j] - y[j]);
+    }
+    assert(fabs(kernel_dist2(n, x, y) - S) < 1e-9);
+
+    memcpy(z, y, sizeof(y));
+    kernel_axpy(n, -2.0, x, z);
+    for(int j = 0; j < 67; ++j) {
+      assert(z[j] == (j < n ? y[j] - 2.0 * x[j] : y[j]));
+    }
+  }
+}
+
+void test_batched(int batch, int n)
+{
+  printf("Entering function: %s\n", __func__);
+
+  double (*A)[n][n] = malloc(batch * sizeof(*A));
+  double (*A_ref)[n][n] = malloc(batch * sizeof(*A));
+  double (*b)[n] = malloc(batch * sizeof(*b));
+  double (*b_ref)[n] = malloc(batch * sizeof(*b));
+  int (*P)[n] = malloc(batch * sizeof(*P)), P_ref[n];
+  assert(A && A_ref && b && b_ref && P);
+
+  for(int s = 0; s < batch; ++s) {
+    generate_random_matrix(n, A[s]);
+    for(int i = 0; i < n; ++i) {
+      A[s][i][i] += 100 * n;
+      b[s][i] = i - s;
+    }
+  }
+  memcpy(A_ref, A, batch * sizeof(*A));
+  memcpy(b_ref, b, batch * sizeof(*b));
+
+  /* The last system has a zero first pivot; the others are not
+     affected by it. */
+  A[batch - 1][0][0] = A_ref[batch - 1][0][0] = 0;
+
+  double eps = 1e-9;
+  int *info = malloc(batch * sizeof(int));
+  assert(info);
+  assert(gauss_solve_batched(batch, n, A, b, info) == 1);
+  for(int s = 0; s < batch; ++s) {
+    assert(info[s] == gauss_solve_in_place(n, A_ref[s], b_ref[s]));
+    assert(norm_dist(n, b[s], b_ref[s]) < eps);
+  }
+  assert(info[batch - 1] == 1);
+
+  /* The same with a zero first column, which plu skips. */
+  for(int s = 0; s < batch; ++s) {
+    generate_random_matrix(n, A[s]);
+  }
+  for(int i = 0; i < n; ++i) {
+    A[batch - 1][i][0] = 0;
+  }
+  memcpy(A_ref, A, batch * sizeof(*A));
+  assert(plu_batched(batch, n, A, P, info) == 1);
+  for(int s = 0; s < batch; ++s) {
+    assert(info[s] == plu(n, A_ref[s], P_ref));
+    assert(memcmp(P[s], P_ref, sizeof(P_ref)) == 0);
+    assert(frobenius_norm_dist(n, A[s], A_ref[s]) < eps);
+  }
+  assert(info[batch - 1] == 1);
+  free(info);
+
+  free(A);
+  free(A_ref);
+  free(b);
+  free(b_ref);
+  free(P);
+}
+
+void test_fixed_sizes()
+{
+  printf("Entering function: %s\n", __func__);
+
+  /* For n <= 16 the generic entry points run unrolled kernels; check
+     them against the blocked engines, which are never specialized. */
+  for(int n = 1; n <= 17; ++n) {
+    double A0[n][n], A[n][n], A_ref[n][n], b[n], y[n];
+    int P[n], P_ref[n];
+
+    generate_random_matrix(n, A0);
+    for(int i = 0; i < n; ++i) {
+      A0[i][i] += 100 * n;
+      b[i] = i + 1;
+    }
+
+    double eps = 1e-9;
+    memcpy(A, A0, sizeof(A));
+    memcpy(A_ref, A0, sizeof(A));
+    lu_in_place(n, A);
+    lu_blocked_in_place(n, A_ref, 0);
+    assert(frobenius_norm_dist(n, A, A_ref) < eps);
+
+    memcpy(A, A0, sizeof(A));
+    gauss_solve_in_place(n, A, b);
+    matrix_times_vector(n, A0, b, y);
+    for(int i = 0; i < n; ++i) {
+      assert(fabs(y[i] - (i + 1)) < eps);
+    }
+
+    /* A dominant cyclic permutation: nonsingular, and every step has
+       to pivot. */
+    generate_random_matrix(n, A0);
+    for(int i = 0; i < n; ++i) {
+      A0[i][(i + 1) % n] += 100 * n;
+    }
+    memcpy(A, A0, sizeof(A));
+    memcpy(A_ref, A0, sizeof(A));
+    plu(n, A, P);
+    plu_blocked(n, A_ref, P_ref, 0);
+    assert(memcmp(P, P_ref, sizeof(P)) == 0);
+    assert(frobenius_norm_dist(n, A, A_ref) < eps);
+  }
+}
+
+void test_plu_solve(int n, int nrhs)
+{
+  printf("Entering function: %s\n", __func__);
+
+  double (*A)[n] = NULL, (*A_copy)[n] = NULL;
+  create_matrix(n, &A);
+  assert(A);
+  create_matrix(n, &A_copy);
+  assert(A_copy);
+  double (*B)[nrhs] = malloc(n * sizeof(*B)), (*X)[nrhs] = malloc(n * sizeof(*X));
+  double *x = malloc(n * sizeof(double)), *y = malloc(n * sizeof(double));
+  int *P = malloc(n * sizeof(int));
+  assert(B && X && x && y && P);
+
+  for(int pivot = 0; pivot < 2; ++pivot) {
+    generate_random_matrix(n, A);
+    if(!pivot) {
+      for(int i = 0; i < n; ++i) {
+	A[i][i] += 100 * n;
+      }
+    }
+    copy_matrix(n, A, A_copy);
+    for(int i = 0; i < n; ++i) {
+      for(int j = 0; j < nrhs; ++j) {
+	B[i][j] = X[i][j] = (i * 7 + j * 3) % 11 - 5;
+      }
+    }
+
+    /* Factor once, then solve for all right-hand sides together. */
+    if(pivot) {
+      plu(n, A, P);
+    } else {
+      lu_in_place(n, A);
+    }
+    plu_solve(n, A, pivot ? P : NULL, nrhs, X);
+
+    double eps = 1e-8;
+    for(int j = 0; j < nrhs; ++j) {
+      for(int i = 0; i < n; ++i) {
+	x[i] = X[i][j];
+      }
+      matrix_times_vector(n, A_copy, x, y);
+      for(int i = 0; i < n; ++i) {
+	x[i] = B[i][j];
+      }
+      assert(norm_dist(n, x, y) < eps * norm(n, x) * n);
+    }
+  }
+
+  free(P);
+  free(x);
+  free(y);
+  free(B);
+  free(X);
+  destroy_matrix(n, A);
+  destroy_matrix(n, A_copy);
+}
+
+void test_cache()
+{
+  printf("Entering function: %s\n", __func__);
+
+  enum { n = 40, nm = 3 };
+  static double A[nm][n][n];
+  double b[n][1], x[n], y[n];
+  for(int m = 0; m < nm; ++m) {
+    generate_random_matrix(n, A[m]);
+    A[m][0][0] += m + 1;  /* Distinct even if the clock did not tick */
+  }
+
+  /* Room for two hashed entries (factors plus a copy of A) only. */
+  const size_t entry = 2 * sizeof(A[0]) + n * sizeof(int) + 256;
+  gauss_cache *cache = gauss_cache_create(2 * entry);
+  assert(cache);
+
+  const int order[] = { 0, 0, 1, 0, 2, 0, 1 };
+  const int hit[]   = { 0, 1, 0, 1, 0, 1, 0 };
+  for(int t = 0; t < 7; ++t) {
+    const int m = order[t];
+    for(int i = 0; i < n; ++i) {
+      b[i][0] = i;
+    }
+    assert(gauss_cache_solve(cache, 0, n, A[m], 1, b) == hit[t]);
+    for(int i = 0; i < n; ++i) {
+      x[i] = b[i][0];
+    }
+    matrix_times_vector(n, A[m], x, y);
+    for(int i = 0; i < n; ++i) {
+      assert(fabs(y[i] - i) < 1e-8);
+    }
+  }
+
+  gauss_cache_stats stats;
+  gauss_cache_get_stats(cache, &stats);
+  assert(stats.hits == 3 && stats.misses == 4 && stats.evictions == 2);
+  assert(stats.entries == 2 && stats.bytes <= 2 * entry);
+
+  /* Caller-supplied keys skip hashing; forget drops the entry. */
+  assert(gauss_cache_solve(cache, 42, n, A[2], 1, b) == 0);
+  assert(gauss_cache_solve(cache, 42, n, A[2], 1, b) == 1);
+  gauss_cache_forget(cache, 42);
+  assert(gauss_cache_solve(cache, 42, n, A[2], 1, b) == 0);
+
+  /* A caller key equal to the hash of A: the entry has no copy of A,
+     so a lookup by hash takes it for a miss. */
+  const uint64_t h = gauss_matrix_hash(n, A[1]);
+  gauss_cache_forget(cache, h);
+  assert(gauss_cache_solve(cache, h, n, A[1], 1, b) == 0);
+  assert(gauss_cache_solve(cache, 0, n, A[1], 1, b) == 0);
+  assert(gauss_cache_solve(cache, 0, n, A[1], 1, b) == 1);
+
+  /* Singular factors are reported, not cached; b is untouched. */
+  static double S[n][n];
+  memcpy(S, A[0], sizeof(S));
+  for(int i = 0; i < n; ++i) {
+    S[i][0] = 0;
+  }
+  for(int i = 0; i < n; ++i) {
+    b[i][0] = i;
+  }
+  assert(gauss_cache_solve(cache, 7, n, S, 1, b) == -2);
+  assert(gauss_cache_solve(cache, 7, n, S, 1, b) == -2);
+  for(int i = 0; i < n; ++i) {
+    assert(b[i][0] == i);
+  }
+
+  gauss_cache_destroy(cache);
+}
+
+void test_arena()
+{
+  printf("Entering function: %s\n", __func__);
+
+  assert(gauss_padded_lda(5) == 8);
+  assert(gauss_padded_lda(100) == 104);
+  assert(gauss_padded_lda(512) == 520);	/* Not a multiple of 512 bytes */
+
+  gauss_arena *arena = gauss_arena_create(1 << 20);
+  assert(arena);
+  int lda;
+  double *p = gauss_arena_alloc(arena, 100, 100, &lda);
+  assert(p && lda == 104 && (uintptr_t)p % ARENA_ALIGN == 0);
+  for(int i = 0; i < 100; ++i) {
+    for(int j = 0; j < 100; ++j) {
+      p[i * lda + j] = i - j;
+    }
+  }
+  gauss_arena_release(arena, p);
+
+  const size_t held = gauss_arena_cached(arena);
+  assert(held >= 100 * 104 * sizeof(double));
+
+  /* A request in the same size class reuses the buffer. */
+  double *q = gauss_arena_alloc(arena, 90, 100, &lda);
+  assert(q == p && gauss_arena_cached(arena) == 0);
+  gauss_arena_release(arena, q);
+
+  /* Buffers beyond the cap are freed, not kept. */
+  double *big = gauss_arena_alloc(arena, 1000, 1000, &lda);
+  assert(big && (uintptr_t)big % ARENA_ALIGN == 0);
+  gauss_arena_release(arena, big);
+  assert(gauss_arena_cached(arena) == held);
+  gauss_arena_trim(arena);
+  assert(gauss_arena_cached(arena) == 0);
+  gauss_arena_destroy(arena);
+
+  p = gauss_arena_alloc(NULL, 3, 3, &lda);
+  assert(p);
+  gauss_arena_release(NULL, p);
+
+  /* Solver scratch comes from the process-wide arena and is reused. */
+  p = gauss_arena_scratch(50 * 50);
+  assert(p && (uintptr_t)p % ARENA_ALIGN == 0);
+  gauss_arena_release(NULL, p);
+  q = gauss_arena_scratch(50 * 50);
+  assert(q == p);
+  gauss_arena_release(NULL, q);
+
+  double (*A)[7];
+  assert(create_matrix(7, &A) == 0 && (uintptr_t)A % ARENA_ALIGN == 0);
+  destroy_matrix(7, A);
+}
+
+/* Factor an n x n block of a bigger padded matrix in place and
+   compare with the factorization of a compact copy; the rest of the
+   bigger matrix must not change. */
+void test_lda(int n)
+{
+  printf("Entering function: %s\n", __func__);
+
+  assert(n > 0);
+  const int nbig = n + 9, r0 = 4, c0 = 3;
+  int ldm;
+  double *M = gauss_arena_alloc(NULL, nbig, nbig, &ldm);
+  assert(M);
+  double (*Mv)[ldm] = (double (*)[ldm])M;
+  double (*A)[n] = NULL, (*A_copy)[n] = NULL;
+  assert(create_matrix(n, &A) == 0 && create_matrix(n, &A_copy) == 0);
+  int *P = malloc(n * sizeof(int)), *P_ref = malloc(n * sizeof(int));
+  double *x = malloc(n * sizeof(double)), *y = malloc(n * sizeof(double));
+  double *z = malloc(n * sizeof(double));
+  assert(P && P_ref && x && y && z);
+
+  for(int i = 0; i < nbig; ++i) {
+    for(int j = 0; j < ldm; ++j) {
+      Mv[i][j] = -1;
+    }
+  }
+  generate_random_matrix(n, A);
+  for(int i = 0; i < n; ++i) {
+    memcpy(&Mv[r0 + i][c0], A[i], n * sizeof(double));
+  }
+  double (*S)[ldm] = (double (*)[ldm])&Mv[r0][c0];
+
+  for(int i = 0; i < n; ++i) {
+    x[i] = i % 7;
+  }
+  matrix_times_vector_lda(n, n, ldm, (const double (*)[ldm])S, x, y);
+  matrix_times_vector(n, A, x, z);
+  assert(memcmp(y, z, n * sizeof(double)) == 0);
+  assert(fabs(frobenius_norm_lda(n, n, ldm, (const double (*)[ldm])S)
+	      - frobenius_norm(n, A)) < 1e-9 * frobenius_norm(n, A));
+
+  copy_matrix(n, A, A_copy);
+  plu(n, A_copy, P_ref);
+  plu_lda(n, n, ldm, S, P);
+  assert(memcmp(P, P_ref, n * sizeof(int)) == 0);
+  assert(frobenius_norm_dist_lda(n, n, ldm, (const double (*)[ldm])S,
+				 n, (const double (*)[n])A_copy) == 0);
+
+  for(int i = 0; i < nbig; ++i) {
+    for(int j = 0; j < ldm; ++j) {
+      if(i < r0 || i >= r0 + n || j < c0 || j >= c0 + n) {
+	assert(Mv[i][j] == -1);
+      }
+    }
+  }
+
+  gauss_arena_release(NULL, M);
+  free(x);
+  free(y);
+  free(z);
+  free(P);
+  free(P_ref);
+  destroy_matrix(n, A);
+  destroy_matrix(n, A_copy);
+}
+
+/* PLU of an m x n matrix: plu_lda and plu_blocked_lda agree bitwise
+   and L U reproduces the permuted rows. */
+void test_plu_rect(int m, int n, int nb)
+{
+  printf("Entering function: %s\n", __func__);
+
+  const int lda = n + 3, mn = m < n ? m : n;
+  double (*A0)[lda] = malloc(sizeof(double[m][lda]));
+  double (*A)[lda] = malloc(sizeof(double[m][lda]));
+  double (*B)[lda] = malloc(sizeof(double[m][lda]));
+  int *P = malloc(m * sizeof(int)), *Q = malloc(m * sizeof(int));
+  assert(A0 && A && B && P && Q);
+
+  srand(m * 1000 + n);
+  for(int i = 0; i < m; ++i) {
+    for(int j = 0; j < lda; ++j) {
+      A0[i][j] = rand() % 100 - 50;
+    }
+  }
+  memcpy(A, A0, sizeof(double[m][lda]));
+  memcpy(B, A0, sizeof(double[m][lda]));
+  plu_lda(m, n, lda, A, P);
+  plu_blocked_lda(m, n, lda, B, Q, nb);
+  assert(memcmp(P, Q, m * sizeof(int)) == 0);
+  assert(memcmp(A, B, sizeof(double[m][lda])) == 0);
+
+  for(int i = 0; i < m; ++i) {
+    for(int j = 0; j < n; ++j) {
+      double s = 0;
+      for(int p = 0; p < mn && p <= i && p <= j; ++p) {
+	s += (p == i ? 1 : A[i][p]) * A[p][j];
+      }
+      assert(fabs(s - A0[P[i]][j]) < 1e-9 * 50 * n);
+    }
+  }
+
+  free(A0);
+  free(A);
+  free(B);
+  free(P);
+  free(Q);
+}
+
+/* Mixed precision solve of a well conditioned system must converge
+   in float to double accuracy; a Hilbert matrix, far too ill
+   conditioned for float, and an entry out of the float range must
+   take the fallback to double. */
+void test_mixed(int n)
+{
+  printf("Entering function: %s\n", __func__);
+
+  double (*A)[n] = NULL;
+  assert(create_matrix(n, &A) == 0);
+  double *b = malloc(n * sizeof(double)), *x = malloc(n * sizeof(double));
+  double *y = malloc(n * sizeof(double));
+  assert(b && x && y);
+
+  generate_random_matrix(n, A);
+  for(int i = 0; i < n; ++i) {
+    A[i][i] += 10 * n;
+    b[i] = i % 5 - 2;
+  }
+  int iters;
+  assert(gauss_solve_mixed(n, A, b, x, 0, &iters) == 0);
+  assert(iters >= 1 && iters < MIXED_MAX_ITER);
+  matrix_times_vector(n, A, x, y);
+  assert(norm_dist(n, y, b) <= 1e-12 * norm(n, b));
+
+  enum { nh = 12 };
+  double H[nh][nh], bh[nh], xh[nh], yh[nh];
+  for(int i = 0; i < nh; ++i) {
+    for(int j = 0; j < nh; ++j) {
+      H[i][j] = 1.0 / (i + j + 1);
+    }
+    bh[i] = 1;
+  }
+  assert(gauss_solve_mixed(nh, H, bh, xh, 0, NULL) == 1);
+  matrix_times_vector(nh, H, xh, yh);
+  assert(norm_dist(nh, yh, bh) < 1e-6);
+
+  A[0][0] = 1e300;
+  assert(gauss_solve_mixed(n, A, b, x, 0, &iters) == 1 && iters == 0);
+  matrix_times_vector(n, A, x, y);
+  assert(norm_dist(n, y, b) <= 1e-9 * norm(n, b));
+
+  /* A singular A is reported with the zero pivot of the fallback. */
+  for(int i = 0; i < n; ++i) {
+    A[i][0] = 0;
+  }
+  assert(gauss_solve_mixed(n, A, b, x, 0, NULL) == 2);
+
+  free(b);
+  free(x);
+  free(y);
+  destroy_matrix(n, A);
+}
+
+/* Band PLU of a random (not diagonally dominant) banded matrix, so
+   that pivoting creates fill-in, checked by the residual of the dense
+   matrix. */
+void test_band(int n, int kl, int ku)
+{
+  printf("Entering function: %s\n", __func__);
+
+  const int w = BAND_WIDTH(kl, ku);
+  double (*A)[n] = NULL;
+  assert(create_matrix(n, &A) == 0);
+  double (*AB)[w] = malloc(sizeof(double[n][w]));
+  int *ipiv = malloc(n * sizeof(int));
+  double *b = malloc(n * sizeof(double)), *x = malloc(n * sizeof(double));
+  double *y = malloc(n * sizeof(double));
+  assert(AB && ipiv && b && x && y);
+
+  srand(n + kl * 100 + ku);
+  for(int i = 0; i < n; ++i) {
+    for(int j = 0; j < n; ++j) {
+      A[i][j] = j >= i - kl && j <= i + ku ? rand() % 19 - 9 : 0;
+    }
+    A[i][i] += 0.5;		/* Keep it away from singular */
+    b[i] = i % 3;
+  }
+  int dl, du;
+  band_detect(n, A, &dl, &du);
+  assert(dl <= kl && du <= ku);
+
+  dense_to_band(n, A, kl, ku, AB);
+  assert(band_plu(n, kl, ku, AB, ipiv) == 0);
+  memcpy(x, b, n * sizeof(double));
+  band_plu_solve(n, kl, ku, (const double (*)[w])AB, ipiv, x);
+  matrix_times_vector(n, A, x, y);
+  assert(norm_dist(n, y, b) < 1e-8 * norm(n, x) * frobenius_norm(n, A));
+
+  /* A zero column is reported and skipped. */
+  for(int i = 0; i < n; ++i) {
+    A[i][n/2] = 0;
+  }
+  dense_to_band(n, A, kl, ku, AB);
+  assert(band_plu(n, kl, ku, AB, ipiv) == n/2 + 1);
+
+  free(AB);
+  free(ipiv);
+  free(b);
+  free(x);
+  free(y);
+  destroy_matrix(n, A);
+}
+
+void test_tridiagonal(int n)
+{
+  printf("Entering function: %s\n", __func__);
+
+  double *dl = malloc(n * sizeof(double)), *d = malloc(n * sizeof(double));
+  double *du = malloc(n * sizeof(double)), *b = malloc(n * sizeof(double));
+  assert(dl && d && du && b);
+
+  /* The 1D Laplacian plus a shift. */
+  for(int i = 0; i < n; ++i) {
+    dl[i] = du[i] = -1;
+    d[i] = 2.01;
+    b[i] = 1;
+  }
+  assert(tridiagonal_solve_in_place(n, dl, d, du, b) == 0);
+  for(int i = 0; i < n; ++i) {
+    double r = 2.01 * b[i];
+    r -= i > 0 ? b[i-1] : 0;
+    r -= i < n-1 ? b[i+1] : 0;
+    assert(fabs(r - 1) < 1e-10);
+  }
+
+  /* A zero first pivot stops it. */
+  d[0] = 0;
+  assert(tridiagonal_solve_in_place(n, dl, d, du, b) == 1);
+
+  free(dl);
+  free(d);
+  free(du);
+  free(b);
+}
+
+/* Sparse LU of a random nonsymmetric matrix against dense plu: with
+   the natural order and plain partial pivoting the pivots, hence P,
+   are those of plu. */
+void test_sparse_random(int n)
+{
+  printf("Entering function: %s\n", __func__);
+
+  double (*A)[n] = NULL, (*LU)[n] = NULL;
+  assert(create_matrix(n, &A) == 0 && create_matrix(n, &LU) == 0);
+  int *P = malloc(n * sizeof(int)), *Ps = malloc(n * sizeof(int));
+  int *Q = malloc(n * sizeof(int));
+  double *b = malloc(n * sizeof(double)), *x = malloc(n * sizeof(double));
+  assert(P && Ps && Q && b && x);
+
+  srand(n);
+  for(int i = 0; i < n; ++i) {
+    for(int j = 0; j < n; ++j) {
+      A[i][j] = rand() % 40 == 0 ? rand() / (RAND_MAX + 1.0) - 0.5 : 0;
+    }
+    A[i][i] += 0.1 + rand() / (RAND_MAX + 1.0);
+    b[i] = i % 4 - 1.5;
+  }
+  gauss_sparse *As = gauss_sparse_from_dense(n, A);
+  assert(As);
+
+  copy_matrix(n, A, LU);
+  plu(n, LU, P);
+  memcpy(x, b, n * sizeof(double));
+  plu_solve(n, (const double (*)[n])LU, P, 1, (double (*)[1])x);
+
+  gauss_sparse_symbolic *S = gauss_sparse_analyze(As, SPARSE_ORDER_NATURAL);
+  assert(S);
+  gauss_sparse_numeric *Nf = gauss_sparse_factor(As, S, 1);
+  assert(Nf);
+  gauss_sparse_permutations(S, Nf, Ps, Q);
+  assert(memcmp(P, Ps, n * sizeof(int)) == 0);
+  for(int j = 0; j < n; ++j) {
+    assert(Q[j] == j);
+  }
+  assert(gauss_sparse_solve(S, Nf, b) == 0);
+  assert(norm_dist(n, x, b) < 1e-8 * norm(n, x));
+
+  gauss_sparse_numeric_free(Nf);
+  gauss_sparse_symbolic_free(S);
+  gauss_sparse_destroy(As);
+  free(P);
+  free(Ps);
+  free(Q);
+  free(b);
+  free(x);
+  destroy_matrix(n, A);
+  destroy_matrix(n, LU);
+}
+
+/* Convection-diffusion on a g x g grid: the minimum degree order must
+   cut the fill of the natural (banded) order, a refactorization with
+   new values must reuse the analysis, and a zero pivot in the kept
+   order must be reported. */
+void test_sparse_grid(int g)
+{
+  printf("Entering function: %s\n", __func__);
+
+  const int n = g * g;
+  gauss_sparse *A = gauss_sparse_create(n, 5 * n);
+  double *b = malloc(n * sizeof(double)), *x = malloc(n * sizeof(double));
+  double *y = malloc(n * sizeof(double));
+  assert(A && b && x && y);
+
+  /* Columns in increasing row order; the matrix is not symmetric. */
+  int p = 0;
+  for(int j = 0; j < n; ++j) {
+    const int r = j / g, c = j % g;
+    A->ptr[j] = p;
+    const int rows[5] = { j - g, j - 1, j, j + 1, j + g };
+    const int ok[5] = { r > 0, c > 0, 1, c < g-1, r < g-1 };
+    const double v[5] = { -1.2, -1.1, 4, -0.9, -0.8 };
+    for(int t = 0; t < 5; ++t) {
+      if(ok[t]) {
+	A->ind[p] = rows[t];
+	A->val[p++] = v[t];
+      }
+    }
+  }
+  A->ptr[n] = p;
+  A->nnz = p;
+  for(int i = 0; i < n; ++i) {
+    b[i] = (i * 7) % 11 - 5;
+  }
+
+  long lnz[2], unz[2];
+  for(int order = 0; order < 2; ++order) {
+    gauss_sparse_symbolic *S = gauss_sparse_analyze(A, order);
+    gauss_sparse_numeric *Nf = gauss_sparse_factor(A, S, 0);
+    assert(S && Nf);
+    gauss_sparse_factor_nnz(Nf, &lnz[order], &unz[order]);
+    memcpy(x, b, n * sizeof(double));
+    assert(gauss_sparse_solve(S, Nf, x) == 0);
+    gauss_sparse_matvec(A, x, y);
+    assert(norm_dist(n, y, b) < 1e-10 * norm(n, b));
+
+    if(order == SPARSE_ORDER_MINDEG) {
+      /* Same pattern, new values. */
+      for(int q = 0; q < A->nnz; ++q) {
+	A->val[q] *= 1 + 0.01 * (q % 5);
+      }
+      assert(gauss_sparse_refactor(A, S, Nf) == 0);
+      memcpy(x, b, n * sizeof(double));
+      assert(gauss_sparse_solve(S, Nf, x) == 0);
+      gauss_sparse_matvec(A, x, y);
+      assert(norm_dist(n, y, b) < 1e-10 * norm(n, b));
+
+      /* Zero the first pivot. */
+      int P0[n];
+      gauss_sparse_permutations(S, Nf, P0, NULL);
+      const int col = 0, row = P0[0];
+      int Q0[n];
+      gauss_sparse_permutations(S, Nf, NULL, Q0);
+      for(int q = A->ptr[Q0[col]]; q < A->ptr[Q0[col]+1]; ++q) {
+	if(A->ind[q] == row) {
+	  A->val[q] = 0;
+	}
+      }
+      assert(gauss_sparse_refactor(A, S, Nf) == -1);
+    }
+    gauss_sparse_numeric_free(Nf);
+    gauss_sparse_symbolic_free(S);
+  }
+  assert(lnz[SPARSE_ORDER_MINDEG] + unz[SPARSE_ORDER_MINDEG]
+	 < lnz[SPARSE_ORDER_NATURAL] + unz[SPARSE_ORDER_NATURAL]);
+
+  gauss_sparse_destroy(A);
+  free(b);
+  free(x);
+  free(y);
+}
+
+/* Out-of-core PLU through a file in the working directory, with
+   panels narrower than n and a narrower last panel, against plu. */
+void test_ooc(int n, int nb)
+{
+  printf("Entering function: %s\n", __func__);
+
+  const char *path = "gauss_ooc_test.bin";
+  double (*A)[n] = NULL, (*LU)[n] = NULL;
+  assert(create_matrix(n, &A) == 0 && create_matrix(n, &LU) == 0);
+  int *P = malloc(n * sizeof(int)), *Pf = malloc(n * sizeof(int));
+  double *b = malloc(n * sizeof(double)), *x = malloc(n * sizeof(double));
+  double *y = malloc(n * sizeof(double));
+  assert(P && Pf && b && x && y);
+
+  generate_random_matrix(n, A);
+  gauss_ooc *F = gauss_ooc_create(path, n, nb);
+  assert(F);
+  for(int i = 0; i < n; ++i) {
+    gauss_ooc_set_row(F, i, A[i]);
+    b[i] = i % 7 - 3;
+  }
+  assert(gauss_ooc_plu(F, Pf) == 0);
+  gauss_ooc_close(F);
+
+  /* Reopen, to read back what was written to the file. */
+  F = gauss_ooc_open(path, n, nb);
+  assert(F && !gauss_ooc_open(path, n + 1, nb));
+  copy_matrix(n, A, LU);
+  plu(n, LU, P);
+  assert(memcmp(P, Pf, n * sizeof(int)) == 0);
+  for(int i = 0; i < n; ++i) {
+    gauss_ooc_get_row(F, i, y);
+    assert(norm_dist(n, y, LU[i]) <= 1e-10 * n * (1 + norm(n, LU[i])));
+  }
+  memcpy(x, b, n * sizeof(double));
+  assert(gauss_ooc_solve(F, Pf, x) == 0);
+  matrix_times_vector(n, A, x, y);
+  assert(norm_dist(n, y, b) <= 1e-9 * norm(n, b) * frobenius_norm(n, A));
+  gauss_ooc_close(F);
+  remove(path);
+
+  free(P);
+  free(Pf);
+  free(b);
+  free(x);
+  free(y);
+  destroy_matrix(n, A);
+  destroy_matrix(n, LU);
+}
+
+/* Store a PLU factorization, map it back and solve with it in place;
+   then a padded matrix without P, and a truncated file. */
+void test_io(int n)
+{
+  printf("Entering function: %s\n", __func__);
+
+  const char *path = "gauss_io_test.bin";
+  double (*A)[n] = NULL, (*LU)[n] = NULL;
+  assert(create_matrix(n, &A) == 0 && create_matrix(n, &LU) == 0);
+  int *P = malloc(n * sizeof(int));
+  double *b = malloc(n * sizeof(double)), *y = malloc(n * sizeof(double));
+  assert(P && b && y);
+
+  generate_random_matrix(n, A);
+  copy_matrix(n, A, LU);
+  plu(n, LU, P);
+  assert(gauss_matrix_store(path, GAUSS_IO_PLU, n, n, n, LU, P) == 0);
+
+  gauss_mapped *M = gauss_matrix_load(path, 0);
+  assert(M && M->m == n && M->n == n && M->lda == n);
+  assert(M->kind == GAUSS_IO_PLU && M->P);
+  assert((uintptr_t)M->data % GAUSS_IO_ALIGN == 0);
+  assert(memcmp(M->data, LU, n * n * sizeof(double)) == 0);
+  for(int i = 0; i < n; ++i) {
+    assert(M->P[i] == P[i]);
+    b[i] = i % 3 - 1;
+  }
+  double x[n];
+  memcpy(x, b, sizeof(x));
+  plu_solve(n, (const double (*)[n])M->data, M->P, 1, (double (*)[1])x);
+  matrix_times_vector(n, A, x, y);
+  assert(norm_dist(n, y, b) <= 1e-9 * norm(n, b) * frobenius_norm(n, A));
+  gauss_matrix_unmap(M);
+
+  int lda;
+  double *Ap = gauss_arena_alloc(NULL, n, n, &lda);
+  assert(Ap);
+  for(int i = 0; i < n; ++i) {
+    memcpy(Ap + (size_t)i * lda, A[i], n * sizeof(double));
+  }
+  assert(gauss_matrix_store(path, GAUSS_IO_MATRIX, n, n, lda,
+			    (const double (*)[lda])Ap, NULL) == 0);
+  M = gauss_matrix_load(path, 1);
+  assert(M && M->lda == lda && !M->P);
+  lu_in_place_lda(n, M->lda, (double (*)[M->lda])M->data);
+  gauss_matrix_unmap(M);
+  /* The copy-on-write mapping left the file unchanged. */
+  M = gauss_matrix_load(path, 0);
+  assert(M && M->data[1] == A[0][1]);
+  gauss_matrix_unmap(M);
+  /* A view of columns 1..n-1 ends before the padding of its last row,
+     and the file holds no more than that. */
+  assert(gauss_matrix_store(path, GAUSS_IO_MATRIX, n, n - 1, lda,
+			    (const double (*)[lda])(Ap + 1), NULL) == 0);
+  M = gauss_matrix_load(path, 0);
+  assert(M && M->n == n - 1 && M->lda == lda);
+  assert(M->bytes == GAUSS_IO_ALIGN + ((size_t)(n - 1) * lda + n - 1)
+	 * sizeof(double));
+  assert(M->data[(size_t)(n - 1) * lda + n - 2] == A[n - 1][n - 1]);
+  gauss_matrix_unmap(M);
+  gauss_arena_release(NULL, Ap);
+  assert(gauss_matrix_store(path, 3, n, n, n, LU, NULL) == -1);
+
+  /* Headers whose offsets wrap around, or a PLU without P. */
+  const uint64_t bad[][2] = {
+    { UINT64_MAX - GAUSS_IO_ALIGN + 1, 0 },
+    { GAUSS_IO_ALIGN, UINT64_MAX - GAUSS_IO_ALIGN + 1 },
+    { GAUSS_IO_ALIGN, 0 },
+  };
+  for(int t = 0; t < 3; ++t) {
+    assert(gauss_matrix_store(path, GAUSS_IO_PLU, n, n, n, LU, P) == 0);
+    gauss_io_header h;
+    FILE *f = fopen(path, "r+b");
+    assert(f && fread(&h, sizeof(h), 1, f) == 1);
+    h.data_offset = bad[t][0];
+    h.perm_offset = bad[t][1];
+    rewind(f);
+    assert(fwrite(&h, sizeof(h), 1, f) == 1 && fclose(f) == 0);
+    assert(!gauss_matrix_load(path, 0));
+  }
+  assert(gauss_matrix_store(path, GAUSS_IO_PLU, n, n, n, LU, NULL) == -1);
+
+  assert(truncate(path, 100) == 0);
+  assert(!gauss_matrix_load(path, 0));
+  remove(path);
+
+  free(P);
+  free(b);
+  free(y);
+  destroy_matrix(n, A);
+  destroy_matrix(n, LU);
+}
+
+/* Rows pushed one at a time, with a dependent row in the stream,
+   against the residual of the full system. */
+void test_stream(int n)
+{
+  printf("Entering function: %s\n", __func__);
+
+  double (*A)[n] = NULL;
+  assert(create_matrix(n, &A) == 0);
+  double *b = malloc(n * sizeof(double)), *x = malloc(n * sizeof(double));
+  double *y = malloc(n * sizeof(double)), *r = malloc(n * sizeof(double));
+  assert(b && x && y && r);
+  generate_random_matrix(n, A);
+
+  gauss_stream *S = gauss_stream_create(n);
+  assert(S);
+  for(int i = 0; i < n; ++i) {
+    b[i] = i % 4 - 1.5;
+    assert(gauss_stream_solve(S, x) == -1);
+    assert(gauss_stream_push_row(S, A[i], b[i]) == 0);
+    if(i == 1) {
+      for(int j = 0; j < n; ++j) {
+	r[j] = 2 * A[0][j] - 0.5 * A[1][j];
+      }
+      assert(gauss_stream_push_row(S, r, 2 * b[0] - 0.5 * b[1]) == 1);
+    }
+    assert(gauss_stream_rows(S) == i + 1);
+  }
+  assert(gauss_stream_push_row(S, A[0], b[0]) == -1);
+  assert(gauss_stream_solve(S, x) == 0);
+  matrix_times_vector(n, A, x, y);
+  assert(norm_dist(n, y, b) <= 1e-9 * norm(n, b) * frobenius_norm(n, A));
+
+  gauss_stream_reset(S);
+  assert(gauss_stream_rows(S) == 0);
+  for(int i = n-1; i >= 0; --i) {
+    assert(gauss_stream_push_row(S, A[i], b[i]) == 0);
+  }
+  assert(gauss_stream_solve(S, y) == 0);
+  assert(norm_dist(n, x, y) <= 1e-8 * norm(n, x));
+  gauss_stream_destroy(S);
+
+  free(b);
+  free(x);
+  free(y);
+  free(r);
+  destroy_matrix(n, A);
+}
+
+/* Residual of the solve with the factors of A. */
+static double plu_residual(int n, double A[n][n], double LU[n][n], int P[n])
+{
+  double b[n], x[n], y[n];
+  for(int i = 0; i < n; ++i) {
+    b[i] = x[i] = i % 5 - 2;
+  }
+  plu_solve(n, LU, P, 1, (double (*)[1])x);
+  matrix_times_vector(n, A, x, y);
+  return norm_dist(n, y, b) / (norm(n, b) * frobenius_norm(n, A));
+}
+
+/* Rank-1, row and column updates of a PLU factorization, one that
+   zeroes a pivot and so falls back to plu_blocked, and one that makes
+   A singular. A is a fixed, diagonally dominant matrix with no zero
+   entries, which stays nonsingular when its first pivot is zeroed. */
+void test_update(int n)
+{
+  printf("Entering function: %s\n", __func__);
+
+  double (*A)[n] = NULL, (*LU)[n] = NULL;
+  assert(create_matrix(n, &A) == 0 && create_matrix(n, &LU) == 0);
+  int P[n];
+  double u[n], v[n];
+  for(int i = 0; i < n; ++i) {
+    for(int j = 0; j < n; ++j) {
+      A[i][j] = 1 + (3 * i + j) % 11 + (i == j) * 12 * n;
+    }
+  }
+  copy_matrix(n, A, LU);
+  plu(n, LU, P);
+
+  for(int i = 0; i < n; ++i) {
+    u[i] = 0.01 * (i % 7 - 3);
+    v[i] = 0.02 * (i % 3 - 1);
+  }
+  assert(plu_update_rank1(n, LU, P, A, u, v) == 0);
+  assert(plu_residual(n, A, LU, P) < 1e-12);
+  for(int i = 0; i < n; ++i) {
+    u[i] = -u[i];
+  }
+  assert(plu_update_rank1(n, LU, P, A, u, v) == 0);
+  assert(plu_residual(n, A, LU, P) < 1e-12);
+
+  for(int j = 0; j < n; ++j) {
+    v[j] = A[n/2][j] + 0.1 * (j % 4);
+  }
+  assert(plu_update_row(n, LU, P, A, n/2, v) == 0);
+  assert(memcmp(A[n/2], v, sizeof(v)) == 0);
+  assert(plu_residual(n, A, LU, P) < 1e-12);
+  for(int i = 0; i < n; ++i) {
+    u[i] = A[i][1] - 0.05 * (i % 3);
+  }
+  assert(plu_update_col(n, LU, P, A, 1, u) == 0);
+  assert(plu_residual(n, A, LU, P) < 1e-12);
+
+  /* Make the first pivot zero. */
+  const int r = P[0];
+  memcpy(v, A[r], sizeof(v));
+  v[0] = 0;
+  assert(plu_update_row(n, LU, P, A, r, v) == 1);
+  assert(P[0] != r);
+  assert(plu_residual(n, A, LU, P) < 1e-12);
+
+  /* Zero the first column: the first pivot of U becomes exactly zero
+     and the recomputed factors are reported singular at step 0. */
+  for(int i = 0; i < n; ++i) {
+    u[i] = 0;
+  }
+  assert(plu_update_col(n, LU, P, A, 0, u) == 2);
+  for(int i = 0; i < n; ++i) {
+    assert(A[i][0] == 0);
+  }
+
+  destroy_matrix(n, A);
+  destroy_matrix(n, LU);
+}
+
+/* Instrumented calls (make INSTRUMENT=1), or the -1 of gauss_stats_get
+   in a build without instrumentation. */
+void test_instrument(int n)
+{
+  printf("Entering function: %s\n", __func__);
+
+  double (*A)[n] = NULL, (*LU)[n] = NULL;
+  assert(create_matrix(n, &A) == 0 && create_matrix(n, &LU) == 0);
+  int P[n];
+  double b[n];
+  generate_random_matrix(n, A);
+  for(int i = 0; i < n; ++i) {
+    A[i][i] += 100 * n;
+    b[i] = 1;
+  }
+
+  gauss_stats_reset();
+  copy_matrix(n, A, LU);
+  plu(n, LU, P);
+  plu_solve(n, LU, P, 1, (double (*)[1])b);
+  copy_matrix(n, A, LU);
+  lu_in_place(n, LU);
+  copy_matrix(n, A, LU);
+  gauss_solve_in_place(n, LU, b);
+
+  gauss_stats st;
+  if(gauss_stats_get(&st) == 0) {
+    const double flops = 3 * (2.0 * n * n * n / 3);
+    assert(st.calls == 4);
+    assert(st.flops > 0.9 * flops && st.flops < 1.2 * flops);
+    assert(st.seconds[GAUSS_PHASE_PIVOT] > 0
+	   && st.seconds[GAUSS_PHASE_UPDATE] > 0
+	   && st.seconds[GAUSS_PHASE_SOLVE] > 0);
+    printf("pivot %g s, swap %g s, update %g s, solve %g s",
+	   st.seconds[GAUSS_PHASE_PIVOT], st.seconds[GAUSS_PHASE_SWAP],
+	   st.seconds[GAUSS_PHASE_UPDATE], st.seconds[GAUSS_PHASE_SOLVE]);
+    if(st.have_counters) {
+      printf(", %lld cycles, %lld LLC misses", st.cycles, st.llc_misses);
+    }
+    printf("\n");
+  } else {
+    assert(st.calls == 0);
+  }
+  destroy_matrix(n, A);
+  destroy_matrix(n, LU);
+}
+
+/* The fallback chain of gauss_solve_robust: a diagonally dominant
+   matrix needs no pivoting, a zero leading entry needs partial
+   pivoting, Wilkinson's matrix (growth 2^(n-1) with partial pivoting)
+   needs complete pivoting, and a singular matrix reports its rank. */
+void test_robust(int n)
+{
+  printf("Entering function: %s\n", __func__);
+
+  double (*A)[n] = NULL;
+  assert(create_matrix(n, &A) == 0);
+  double b[n], x[n], y[n];
+  int method;
+
+  generate_random_matrix(n, A);
+  for(int i = 0; i < n; ++i) {
+    A[i][i] += 100 * n;
+    b[i] = i % 3 + 1;
+  }
+  assert(gauss_solve_robust(n, A, b, x, GAUSS_METHOD_NOPIV, &method) == 0);
+  assert(method == GAUSS_METHOD_NOPIV);
+  matrix_times_vector(n, A, x, y);
+  assert(norm_dist(n, y, b) <= 1e-12 * norm(n, b) * frobenius_norm(n, A));
+
+  A[0][0] = 0;
+  assert(gauss_solve_robust(n, A, b, x, GAUSS_METHOD_NOPIV, &method) == 0);
+  assert(method == GAUSS_METHOD_PARTIAL);
+  matrix_times_vector(n, A, x, y);
+  assert(norm_dist(n, y, b) <= 1e-12 * norm(n, b) * frobenius_norm(n, A));
+
+  for(int i = 0; i < n; ++i) {
+    for(int j = 0; j < n; ++j) {
+      A[i][j] = i == j || j == n-1 ? 1 : i > j ? -1 : 0;
+    }
+  }
+  assert(gauss_solve_robust(n, A, b, x, GAUSS_METHOD_NOPIV, &method) == 0);
+  assert(method == (n > 20 ? GAUSS_METHOD_COMPLETE : GAUSS_METHOD_NOPIV));
+  matrix_times_vector(n, A, x, y);
+  assert(norm_dist(n, y, b) <= 1e-12 * norm(n, b) * frobenius_norm(n, A));
+
+  /* Rank n-1: two equal rows get equal updates, so the elimination
+     leaves an exact zero. */
+  generate_random_matrix(n, A);
+  memcpy(A[n-1], A[0], n * sizeof(double));
+  assert(gauss_solve_robust(n, A, b, x, GAUSS_METHOD_PARTIAL, &method) == n);
+  assert(method == GAUSS_METHOD_COMPLETE);
+  destroy_matrix(n, A);
+}
+
+/* Recursive PLU against plu, square (a power of two and not) and
+   rectangular, and through lda. */
+void test_plu_recursive(int m, int n)
 {
-  // Enable trapping for specific floating-point exceptions
-  feenableexcept(FE_DIVBYZERO | FE_INVALID | FE_OVERFLOW);
-  sighandler_t old_handler = signal(SIGFPE, fpe_handler);
+  printf("Entering function: %s\n", __func__);
+
+  const int lda = n + 3;
+  double *A = malloc((size_t)m * lda * sizeof(double));
+  double *R = malloc((size_t)m * lda * sizeof(double));
+  int *P = malloc(m * sizeof(int)), *P_ref = malloc(m * sizeof(int));
+  assert(A && R && P && P_ref);
+  srand(m * 1000 + n);
+  for(int i = 0; i < m * lda; ++i) {
+    A[i] = R[i] = rand() % 100 - 50;
+  }
+
+  assert(plu_recursive_lda(m, n, lda, (double (*)[lda])A, P) == 0);
+  assert(plu_lda(m, n, lda, (double (*)[lda])R, P_ref) == 0);
+  assert(memcmp(P, P_ref, m * sizeof(int)) == 0);
+  assert(frobenius_norm_dist_lda(m, n, lda, (const double (*)[lda])A,
+				 lda, (const double (*)[lda])R)
+	 <= 1e-12 * frobenius_norm_lda(m, n, lda, (const double (*)[lda])R));
+  for(int i = 0; i < m; ++i) {
+    assert(A[(size_t)i * lda + n] == R[(size_t)i * lda + n]);
+  }
+
+  if(m == n) {
+    double (*Q)[n] = NULL;
+    assert(create_matrix(n, &Q) == 0);
+    for(int i = 0; i < n; ++i) {
+      for(int j = 0; j < n; ++j) {
+	Q[i][j] = (i * 7 + j * 3) % 23;
+      }
+    }
+    double (*Qr)[n] = NULL;
+    assert(create_matrix(n, &Qr) == 0);
+    copy_matrix(n, Q, Qr);
+    plu(n, Qr, P_ref);
+    plu_recursive(n, Q, P);
+    assert(memcmp(P, P_ref, n * sizeof(int)) == 0);
+    assert(frobenius_norm_dist(n, Q, Qr) <= 1e-12 * frobenius_norm(n, Qr));
+    destroy_matrix(n, Q);
+    destroy_matrix(n, Qr);
+  }
+  free(A);
+  free(R);
+  free(P);
+  free(P_ref);
+}
 
+/* The auto-dispatched PLU, the resident factorization and the batch
+   against the CPU kernels. With a device, the thresholds are lowered
+   so that the GPU is used even for these sizes. */
+void test_gpu_backend(int n, int batch)
+{
+  printf("Entering function: %s\n", __func__);
+
+  const int expect = gauss_gpu_available() ? GAUSS_BACKEND_GPU
+    : GAUSS_BACKEND_CPU;
+  gauss_gpu_set_thresholds(1, 1);
+
+  double (*A)[n] = NULL, (*LU)[n] = NULL;
+  assert(create_matrix(n, &A) == 0);
+  assert(create_matrix(n, &LU) == 0);
+  generate_random_matrix(n, A);
+  int *P = malloc(n * sizeof(int)), backend = -1;
+  assert(P);
+  copy_matrix(n, A, LU);
+  assert(gauss_plu_auto(n, LU, P, &backend) == 0);
+  assert(backend == expect);
+  assert(plu_residual(n, A, LU, P) < 1e-12);
+
+  /* Two solves with the same factors. */
+  int info = -1;
+  gauss_lu *F = gauss_lu_factor(n, (const double (*)[n])A, &info);
+  assert(F && info == 0 && gauss_lu_backend(F) == expect);
+  const int nrhs = 3;
+  double (*X)[nrhs] = malloc(sizeof(double[n][nrhs]));
+  assert(X);
+  for(int pass = 0; pass < 2; ++pass) {
+    for(int i = 0; i < n; ++i) {
+      for(int r = 0; r < nrhs; ++r) {
+	X[i][r] = 0;
+	for(int j = 0; j < n; ++j) {
+	  X[i][r] += A[i][j] * (j + r + pass + 1);
+	}
+      }
+    }
+    assert(gauss_lu_solve(F, nrhs, X) == 0);
+    for(int i = 0; i < n; ++i) {
+      for(int r = 0; r < nrhs; ++r) {
+	assert(fabs(X[i][r] - (i + r + pass + 1)) < 1e-8 * n);
+      }
+    }
+  }
+  gauss_lu_free(F);
+  free(X);
+
+  double (*B)[n][n] = malloc(sizeof(double[batch][n][n]));
+  double (*R)[n][n] = malloc(sizeof(double[batch][n][n]));
+  int (*Q)[n] = malloc(sizeof(int[batch][n]));
+  int (*Q_ref)[n] = malloc(sizeof(int[batch][n]));
+  assert(B && R && Q && Q_ref);
+  for(int s = 0; s < batch; ++s) {
+    generate_random_matrix(n, B[s]);
+  }
+  memset(B[0][1], 0, n * sizeof(double));
+  memcpy(R, B, sizeof(double[batch][n][n]));
+  assert(gauss_plu_batched_auto(batch, n, B, Q, &backend) == 1);
+  assert(backend == expect);
+  assert(plu_batched(batch, n, R, Q_ref, NULL) == 1);
+  for(int s = 1; s < batch; ++s) {
+    assert(memcmp(Q[s], Q_ref[s], n * sizeof(int)) == 0);
+    assert(frobenius_norm_dist(n, B[s], R[s]) <= 1e-12 * frobenius_norm(n, R[s]));
+  }
+  free(B);
+  free(R);
+  free(Q);
+  free(Q_ref);
+
+  gauss_gpu_set_thresholds(0, 0);
+  free(P);
+  destroy_matrix(n, A);
+  destroy_matrix(n, LU);
+}
+
+#ifdef GAUSS_MPI
+/* The distributed PLU against plu on rank 0: pivots, factors, the
+   status (a zero column gives a zero pivot in both), and the solution
+   on every process. */
+void test_mpi_plu(int n, int nb, int nprow, int zero_col)
+{
+  int rank;
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  if(rank == 0) {
+    printf("Entering function: %s\n", __func__);
+  }
+  gauss_grid g;
+  assert(gauss_grid_init(&g, MPI_COMM_WORLD, nprow) == 0);
+  gauss_dmatrix *D = gauss_dmatrix_create(&g, n, nb);
+  assert(D);
+
+  double (*A)[n] = NULL, (*LU)[n] = NULL;
+  double *b = malloc(n * sizeof(double));
+  int *P = malloc(n * sizeof(int)), *P_ref = malloc(n * sizeof(int));
+  assert(b && P && P_ref);
+  int info_ref = 0;
+  if(rank == 0) {
+    assert(create_matrix(n, &A) == 0);
+    assert(create_matrix(n, &LU) == 0);
+    generate_random_matrix(n, A);
+    if(zero_col >= 0) {
+      for(int i = 0; i < n; ++i) {
+	A[i][zero_col] = 0;
+      }
+    }
+    for(int i = 0; i < n; ++i) {
+      b[i] = 0;
+      for(int j = 0; j < n; ++j) {
+	b[i] += A[i][j];
+      }
+    }
+  }
+  MPI_Bcast(b, n, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+  gauss_dmatrix_scatter(D, 0, rank == 0 ? &A[0][0] : NULL);
+
+  const int info = gauss_mpi_plu(D, P);
+  if(rank == 0) {
+    copy_matrix(n, A, LU);
+    info_ref = plu(n, LU, P_ref);
+    assert(memcmp(P, P_ref, n * sizeof(int)) == 0);
+    gauss_dmatrix_gather(D, 0, &A[0][0]);
+    assert(frobenius_norm_dist(n, A, LU) <= 1e-10 * frobenius_norm(n, LU));
+  } else {
+    gauss_dmatrix_gather(D, 0, NULL);
+  }
+  MPI_Bcast(&info_ref, 1, MPI_INT, 0, MPI_COMM_WORLD);
+  assert(info == info_ref);
+  assert((info == 0) == (zero_col < 0));
+
+  if(info == 0) {
+    assert(gauss_mpi_solve(D, P, b) == 0);
+    for(int i = 0; i < n; ++i) {
+      assert(fabs(b[i] - 1) < 1e-8);
+    }
+  }
+  if(rank == 0) {
+    destroy_matrix(n, A);
+    destroy_matrix(n, LU);
+  }
+  free(b);
+  free(P);
+  free(P_ref);
+  gauss_dmatrix_free(D);
+  gauss_grid_free(&g);
+}
+#endif
+
+/* Completions counted by the callback of test_async. */
+static int async_completed = 0;
+static pthread_mutex_t async_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void async_done(int status, void *arg)
+{
+  *(int *)arg = status;
+  pthread_mutex_lock(&async_lock);
+  ++async_completed;
+  pthread_mutex_unlock(&async_lock);
+}
+
+/* Many small requests of two sizes (coalesced into batches), some of
+   medium size and one large one, waited on or released at once and
+   completed by destroying the queue; one small matrix is singular. */
+void test_async(int nworkers)
+{
+  printf("Entering function: %s\n", __func__);
+
+  enum { COUNT = 300 };
+  static const int sizes[] = { 6, 20, 100, 600 };
+  gauss_queue *Q = gauss_queue_create(nworkers);
+  assert(Q);
+  double *A[COUNT], *A0[COUNT], *b[COUNT], *b0[COUNT];
+  int n_of[COUNT], status[COUNT];
+  gauss_ticket *t[COUNT];
+  async_completed = 0;
+  for(int r = 0; r < COUNT; ++r) {
+    const int n = n_of[r] = r == COUNT - 1 ? sizes[3]
+      : r % 50 == 7 ? sizes[2] : sizes[r % 2];
+    A[r] = malloc(sizeof(double[n][n]));
+    A0[r] = malloc(sizeof(double[n][n]));
+    b[r] = malloc(n * sizeof(double));
+    b0[r] = malloc(n * sizeof(double));
+    assert(A[r] && A0[r] && b[r] && b0[r]);
+    generate_random_matrix(n, (double (*)[n])A[r]);
+    if(r == 4) {
+      for(int i = 0; i < n; ++i) {
+	A[r][i * n + 2] = 0;
+      }
+    }
+    for(int i = 0; i < n; ++i) {
+      b[r][i] = i + 1;
+    }
+    memcpy(A0[r], A[r], sizeof(double[n][n]));
+    memcpy(b0[r], b[r], n * sizeof(double));
+    status[r] = -2;
+    t[r] = gauss_solve_async(Q, n, (double (*)[n])A[r], NULL, b[r],
+			     async_done, &status[r]);
+    assert(t[r]);
+    if(r % 3 == 0) {
+      gauss_ticket_release(t[r]);
+      t[r] = NULL;
+    }
+  }
+  for(int r = 0; r < COUNT; ++r) {
+    if(t[r]) {
+      assert(gauss_ticket_wait(t[r]) == status[r]);
+      int s = -2;
+      assert(gauss_ticket_test(t[r], &s) == 1 && s == status[r]);
+      gauss_ticket_release(t[r]);
+    }
+  }
+  gauss_queue_destroy(Q);
+  assert(async_completed == COUNT);
+
+  for(int r = 0; r < COUNT; ++r) {
+    const int n = n_of[r];
+    assert(status[r] == (r == 4 ? 3 : 0));
+    for(int i = 0; i < n && status[r] == 0; ++i) {
+      double s = 0;
+      for(int j = 0; j < n; ++j) {
+	s += A0[r][i * n + j] * b[r][j];
+      }
+      assert(fabs(s - b0[r][i]) < 1e-8 * n * n);
+    }
+    free(A[r]);
+    free(A0[r]);
+    free(b[r]);
+    free(b0[r]);
+  }
+}
+
+/* det, the inverse and the condition estimate from the factors of
+   plu and of lu_in_place, against direct computations. */
+void test_inverse(int n)
+{
+  printf("Entering function: %s\n", __func__);
+
+  /* A 3 x 3 example whose pivoting swaps rows once: det = -2. */
+  double S[3][3] = { { 0, 1, 2 }, { 1, 0, 3 }, { 4, -3, 8 } };
+  int PS[3], sign;
+  assert(plu(3, S, PS) == 0);
+  assert(fabs(plu_det(3, (const double (*)[3])S, PS) + 2) < 1e-14);
+  assert(fabs(plu_logdet(3, (const double (*)[3])S, PS, &sign) - log(2))
+	 < 1e-14 && sign == -1);
+  /* The sign of P alone, with U = I: a 3-cycle and a 2-cycle, then two
+     2-cycles. */
+  double I5[5][5] = { { 0 } };
+  for(int i = 0; i < 5; ++i) {
+    I5[i][i] = 1;
+  }
+  const int P1[5] = { 1, 2, 0, 4, 3 }, P2[5] = { 1, 0, 3, 2, 4 };
+  assert(plu_det(5, (const double (*)[5])I5, P1) == -1);
+  assert(plu_det(5, (const double (*)[5])I5, P2) == 1);
+
+  double (*A)[n] = NULL, (*LU)[n] = NULL;
+  assert(create_matrix(n, &A) == 0);
+  assert(create_matrix(n, &LU) == 0);
+  int *P = malloc(n * sizeof(int));
+  assert(P);
+  /* A fixed, diagonally dominant matrix, and the same with its rows
+     reversed, which plu has to pivot back. */
+  for(int pivot = 0; pivot < 2; ++pivot) {
+    for(int i = 0; i < n; ++i) {
+      const int r = pivot ? n - 1 - i : i;
+      for(int j = 0; j < n; ++j) {
+	A[i][j] = (3 * r + j) % 11 - 5 + (r == j) * 6 * n;
+      }
+    }
+    const double anorm = gauss_norm1(n, (const double (*)[n])A);
+    copy_matrix(n, A, LU);
+    const int *p = pivot ? P : NULL;
+    assert((pivot ? plu(n, LU, P) : lu_in_place(n, LU)) == 0);
+
+    const double logdet = plu_logdet(n, (const double (*)[n])LU, p, &sign);
+    assert(sign != 0 && isfinite(logdet));
+    if(n <= 20) {
+      assert(fabs(plu_det(n, (const double (*)[n])LU, p)
+		  - sign * exp(logdet)) <= 1e-10 * exp(logdet));
+    }
+
+    /* The estimate is a lower bound, and close to ||A^{-1}||_1. */
+    const double est = plu_inv_norm1_est(n, (const double (*)[n])LU, p);
+    assert(plu_cond1_est(n, (const double (*)[n])LU, p, anorm)
+	   == anorm * est);
+    assert(plu_inverse(n, LU, p, 16) == 0);
+    const double exact = gauss_norm1(n, (const double (*)[n])LU);
+    assert(est <= exact * (1 + 1e-10) && est >= 0.1 * exact);
+
+    /* A A^{-1} = I, to within the condition number */
+    double err = 0;
+    for(int i = 0; i < n; ++i) {
+      for(int j = 0; j < n; ++j) {
+	double s = 0;
+	for(int k = 0; k < n; ++k) {
+	  s += A[i][k] * LU[k][j];
+	}
+	err = fmax(err, fabs(s - (i == j)));
+      }
+    }
+    assert(err < n * DBL_EPSILON * 100 * anorm * exact);
+  }
+
+  /* A singular U is reported and left alone. */
+  memset(A[n - 1], 0, n * sizeof(double));
+  copy_matrix(n, A, LU);
+  plu(n, LU, P);
+  assert(plu_inverse(n, LU, P, 0) == n);
+  assert(plu_inv_norm1_est(n, (const double (*)[n])LU, P) == HUGE_VAL);
+  assert(plu_det(n, (const double (*)[n])LU, P) == 0);
+  free(P);
+  destroy_matrix(n, A);
+  destroy_matrix(n, LU);
+}
+
+/* Max-norm residual of A x = b, relative to the size of x. */
+static double sym_residual(int n, double A[n][n], const double x[],
+			   const double b[])
+{
+  double r = 0, xmax = 0;
+  for(int i = 0; i < n; ++i) {
+    double s = -b[i];
+    for(int j = 0; j < n; ++j) {
+      s += A[i][j] * x[j];
+    }
+    r = fmax(r, fabs(s));
+    xmax = fmax(xmax, fabs(x[i]));
+  }
+  return r / (xmax > 0 ? xmax : 1);
+}
+
+/* Cholesky and LDL^T, packed and through gauss_solve_auto_in_place,
+   on a positive-definite matrix, an indefinite one with a positive
+   diagonal (so Cholesky is tried, fails and is undone), one with a
+   negative diagonal entry, and a matrix that is not symmetric. */
+void test_sym(int n)
+{
+  printf("Entering function: %s\n", __func__);
+
+  double (*A)[n] = NULL, (*M)[n] = NULL;
+  assert(create_matrix(n, &A) == 0);
+  assert(create_matrix(n, &M) == 0);
+  double *AP = malloc((SYM_PACKED(n, 0) + 1) * sizeof(double));
+  double *b = malloc(n * sizeof(double)), *x = malloc(n * sizeof(double));
+  int *ipiv = malloc(n * sizeof(int)), engine = -1;
+  assert(AP && b && x && ipiv);
+  for(int i = 0; i < n; ++i) {
+    b[i] = i % 7 - 3;
+  }
+
+  for(int kind = 0; kind < 4; ++kind) {
+    generate_random_matrix(n, M);
+    for(int i = 0; i < n; ++i) {
+      for(int j = 0; j <= i; ++j) {
+	A[i][j] = A[j][i] = kind == 3 ? M[i][j] : M[i][j] + M[j][i];
+      }
+      A[i][i] = kind == 0 ? 200 * n : 1;
+    }
+    if(kind == 2) {
+      A[n / 2][n / 2] = -1;
+    }
+    if(kind == 3 && n > 1) {
+      A[0][n - 1] += 1;
+    }
+    if(kind == 0) {
+      sym_pack(n, A, AP);
+      assert(cholesky_packed(n, AP, 16) == 0);
+      memcpy(x, b, n * sizeof(double));
+      cholesky_packed_solve(n, AP, x);
+      assert(sym_residual(n, A, x, b) < 1e-10);
+    }
+    if(kind < 3) {
+      sym_pack(n, A, AP);
+      assert(ldlt_packed(n, AP, ipiv) == 0);
+      if(kind == 1 && n > 2) {
+	int two = 0;		/* Bunch-Kaufman needs 2 x 2 pivots here */
+	for(int i = 0; i < n; ++i) {
+	  two |= ipiv[i] < 0;
+	}
+	assert(two);
+      }
+      memcpy(x, b, n * sizeof(double));
+      ldlt_packed_solve(n, AP, ipiv, x);
+      assert(sym_residual(n, A, x, b) < 1e-8);
+    }
+    if(kind == 1 && n > 2) {
+      sym_pack(n, A, AP);
+      assert(cholesky_packed(n, AP, 0) > 0);
+    }
+
+    copy_matrix(n, A, M);
+    memcpy(x, b, n * sizeof(double));
+    assert(gauss_is_symmetric(n, M) == (kind < 3 || n == 1));
+    assert(gauss_solve_auto_in_place(n, M, x, &engine) == 0);
+    assert(engine == (kind == 3 && n > 1 ? GAUSS_ENGINE_PLU
+		      : kind == 0 || (n == 1 && kind != 2) ? GAUSS_ENGINE_CHOLESKY
+		      : GAUSS_ENGINE_LDLT));
+    assert(sym_residual(n, A, x, b) < 1e-8);
+  }
+  free(AP);
+  free(b);
+  free(x);
+  free(ipiv);
+  destroy_matrix(n, A);
+  destroy_matrix(n, M);
+}
+
+void test_helpers(int n)
+{
+  printf("Entering function: %s\n", __func__);
+
+  double (*A)[n], (*B)[n];
+  assert(create_matrix(n, &A) == 0 && create_matrix(n, &B) == 0);
+  double *x = malloc(n * sizeof(double)), *b = malloc(n * sizeof(double));
+  double *y = malloc(n * sizeof(double));
+
+  /* The same seed gives the same matrix, with any number of threads. */
+  const int nt = gauss_get_num_threads();
+  set_random_seed(12345);
+  generate_random_matrix(n, A);
+  generate_random_matrix(n, B);
+  assert(n < 4 || memcmp(A, B, sizeof(double[n][n])) != 0);
+  set_random_seed(12345);
+  gauss_set_num_threads(1);
+  generate_random_matrix(n, B);
+  gauss_set_num_threads(nt);
+  assert(memcmp(A, B, sizeof(double[n][n])) == 0);
+  for(int i = 0; i < n; ++i) {
+    for(int j = 0; j < n; ++j) {
+      assert(A[i][j] >= 0 && A[i][j] <= 99 && A[i][j] == floor(A[i][j]));
+    }
+  }
+  generate_random_matrix(n, B);
+
+  for(int i = 0; i < n; ++i) {
+    x[i] = 1 + i % 5;
+    b[i] = i % 3;
+  }
+  const int methods[] = {SUM_FAST, SUM_PAIRWISE, SUM_KAHAN};
+  for(int k = 0; k < 3; ++k) {
+    const int old = set_summation(methods[k]);
+    double F = 0, D = 0, R = 0;
+    for(int i = 0; i < n; ++i) {
+      double s = 0;
+      for(int j = 0; j < n; ++j) {
+	F += A[i][j] * A[i][j];
+	D += (A[i][j] - B[i][j]) * (A[i][j] - B[i][j]);
+	s += A[i][j] * x[j];
+      }
+      R += (b[i] - s) * (b[i] - s);
+    }
+    /* All integers, well below 2^53: every method is exact. */
+    assert(frobenius_norm(n, A) == sqrt(F));
+    assert(frobenius_norm_dist(n, A, B) == sqrt(D));
+    assert(residual_norm(n, A, x, b) == sqrt(R));
+    matrix_times_vector(n, A, x, y);
+    assert(norm_dist(n, b, y) == sqrt(R));
+    set_summation(old);
+  }
+
+  /* 1 + 1000 * 1e-16 - 1: lost by the plain sums, kept by Kahan's. */
+  double *u = malloc(1002 * sizeof(double)), *e = malloc(1002 * sizeof(double));
+  for(int j = 0; j < 1002; ++j) {
+    u[j] = j == 0 ? 1 : j == 1001 ? -1 : 1e-16;
+    e[j] = 1;
+  }
+  const int old = set_summation(SUM_KAHAN);
+  double d;
+  matrix_times_vector_lda(1, 1002, 1002, (const double (*)[1002])u, e, &d);
+  set_summation(old);
+  assert(fabs(d - 1e-13) < 1e-16);
+  assert(set_summation(7) == -1 && set_summation(old) == old);
+
+  free(u);
+  free(e);
+  free(x);
+  free(b);
+  free(y);
+  destroy_matrix(n, A);
+  destroy_matrix(n, B);
+}
+
+int main()
+{
+#ifdef GAUSS_MPI
+  /* The MPI driver (make check_mpi) runs only the distributed tests */
+  MPI_Init(NULL, NULL);
+  test_mpi_plu(200, 16, 0, -1);
+  test_mpi_plu(101, 8, 1, -1);
+  test_mpi_plu(97, 64, 0, -1);
+  test_mpi_plu(130, 7, 0, 45);
+  MPI_Finalize();
+  exit(EXIT_SUCCESS);
+#endif
+  test_kernels();
   test_gauss_solve();
   test_lu_in_place();
   benchmark_test(5);
   benchmark_test_dynamic(5);
   benchmark_test_dynamic_alt(2000);
+  test_lu_blocked_in_place(301, 32);
+  test_lu_blocked_in_place(500, 0);
+  test_plu_blocked(301, 32);
+  test_plu_blocked(500, 0);
+  test_plu_tiled(301, 32, 4);
+  test_plu_tiled(500, 0, 0);
+  test_batched(37, 5);
+  test_batched(9, 16);
+  test_fixed_sizes();
+  test_plu_solve(3, 1);
+  test_plu_solve(200, 37);
+  test_plu_solve(301, 300);
+  test_cache();
+  test_arena();
+  test_lda(5);
+  test_lda(100);
+  test_plu_rect(150, 90, 32);
+  test_plu_rect(90, 150, 32);
+  test_plu_rect(7, 5, 3);
+  test_mixed(5);
+  test_mixed(300);
+  test_band(200, 1, 1);
+  test_band(300, 2, 2);
+  test_band(257, 5, 3);
+  test_band(6, 0, 4);
+  test_tridiagonal(1000);
+  test_sparse_random(300);
+  test_sparse_grid(40);
+  test_ooc(300, 64);
+  test_ooc(97, 97);
+  test_ooc(200, 1);
+  test_io(60);
+  test_stream(1);
+  test_stream(250);
+  test_update(2);
+  test_update(120);
+  test_instrument(150);
+  test_robust(10);
+  test_robust(60);
+  test_plu_recursive(512, 512);
+  test_plu_recursive(301, 301);
+  test_plu_recursive(300, 170);
+  test_plu_recursive(170, 300);
+  test_gpu_backend(100, 8);
+  test_gpu_backend(3, 20);
+  test_async(1);
+  test_async(4);
+  test_inverse(1);
+  test_inverse(7);
+  test_inverse(150);
+  test_sym(1);
+  test_sym(9);
+  test_sym(200);
+  test_helpers(1);
+  test_helpers(300);
   test_gauss_solve_with_zero_pivot();  
   exit(EXIT_SUCCESS);
 
@@ -295,7 +2122,7 @@ int main()
 }
 
 // Function declaration for plu
-void plu(int n, double A[n][n], int P[n]);
+int plu(int n, double A[n][n], int P[n]);
 
 // Helper function to print a permutation vector
 void print_permutation(int n, int P[n]) {